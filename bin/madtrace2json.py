@@ -0,0 +1,135 @@
+#!/usr/bin/env python
+
+#
+#  This file is part of MADNESS.
+#
+#  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; either version 2 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+#
+#  For more information please contact:
+#
+#  Robert J. Harrison
+#  Oak Ridge National Laboratory
+#  One Bethel Valley Road
+#  P.O. Box 2008, MS-6367
+#
+#  email: harrisonrj@ornl.gov
+#  tel:   865-241-3937
+#  fax:   865-572-0680
+#
+#  $Id$
+#
+
+"""Convert MADNESS event traces to Chrome trace JSON.
+
+Run a program with MAD_TRACE_NAME=<name> to have each process write
+<name>_<rank>, then
+
+    madtrace2json.py <name>_* > trace.json
+
+and load trace.json in chrome://tracing or https://ui.perfetto.dev.  Each
+process is shown as a pid and each thread as a tid.  Task runs and fences
+are spans; task spawns and messages are instant events.
+"""
+
+import json
+import struct
+import sys
+
+KINDS = ("spawn", "task_begin", "task_end", "am_send", "am_recv",
+         "huge_send", "huge_recv", "fence_begin", "fence_end")
+NONAME = 0xffffffff
+RECORD = struct.Struct("<QQIiII")
+
+
+def read_trace(filename):
+    with open(filename, "rb") as f:
+        data = f.read()
+    if data[:8] != b"MADTRACE":
+        sys.exit("%s: not a MADNESS trace" % filename)
+    version, rank, epoch = struct.unpack_from("<IiQ", data, 8)
+    if version != 1:
+        sys.exit("%s: unsupported trace version %d" % (filename, version))
+    pos = 24
+    (nname,) = struct.unpack_from("<I", data, pos)
+    pos += 4
+    names = []
+    for i in range(nname):
+        (n,) = struct.unpack_from("<I", data, pos)
+        pos += 4
+        names.append(data[pos:pos+n].decode("utf-8", "replace"))
+        pos += n
+    (nthread,) = struct.unpack_from("<I", data, pos)
+    pos += 4
+    threads = []
+    for t in range(nthread):
+        tid, nevent = struct.unpack_from("<IQ", data, pos)
+        pos += 12
+        events = [RECORD.unpack_from(data, pos + i*RECORD.size) for i in range(nevent)]
+        pos += nevent*RECORD.size
+        threads.append((tid, events))
+    return rank, epoch, names, threads
+
+
+def convert(traces):
+    out = []
+    epoch0 = min(epoch for rank, epoch, names, threads in traces)
+    for rank, epoch, names, threads in traces:
+        offset = epoch - epoch0
+        out.append({"ph": "M", "name": "process_name", "pid": rank,
+                    "args": {"name": "rank %d" % rank}})
+        for tid, events in threads:
+            out.append({"ph": "M", "name": "thread_name", "pid": rank, "tid": tid,
+                        "args": {"name": "thread %d" % tid}})
+            stack = []  # open task and fence spans
+            for time, arg, kind, peer, name, pad in events:
+                ts = (time + offset)*1e-3
+                label = names[name] if name != NONAME else KINDS[kind]
+                if kind == 7:
+                    label = "fence"
+                if kind in (1, 7):
+                    stack.append((ts, label))
+                elif kind in (2, 8):
+                    if not stack:
+                        continue  # begin was overwritten in the ring
+                    begin, label = stack.pop()
+                    event = {"ph": "X", "name": label, "pid": rank, "tid": tid,
+                             "ts": begin, "dur": ts - begin,
+                             "cat": "fence" if kind == 8 else "task"}
+                    if kind == 8:
+                        event["args"] = {"passes": arg}
+                    out.append(event)
+                else:
+                    event = {"ph": "i", "s": "t", "name": KINDS[kind], "pid": rank,
+                             "tid": tid, "ts": ts, "cat": KINDS[kind]}
+                    if kind == 0:
+                        event["args"] = {"task": label}
+                    else:
+                        event["args"] = {"bytes": arg, "peer": peer}
+                    out.append(event)
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+
+def main(argv):
+    if len(argv) < 2:
+        sys.exit("usage: madtrace2json.py trace_file [trace_file ...] > trace.json")
+    traces = [read_trace(filename) for filename in argv[1:]]
+    json.dump(convert(traces), sys.stdout)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -0,0 +1,30 @@
+AC_DEFUN([ACX_WITH_HWLOC], [
+  acx_with_hwloc=""
+  AC_ARG_WITH([hwloc],
+    [AS_HELP_STRING([--with-hwloc@<:@=Install DIR@:>@],
+      [Enables use of hwloc for NUMA-aware thread and memory placement])],
+    [
+      case $withval in
+      yes)
+        acx_with_hwloc="yes"
+      ;;
+      no)
+        acx_with_hwloc="no"
+      ;;
+      *)
+        CPPFLAGS="$CPPFLAGS -I$with_hwloc/include"
+        LIBS="$LIBS -L$with_hwloc/lib"
+        acx_with_hwloc="$withval"
+      esac
+    ],
+    [acx_with_hwloc="no"]
+  )
+  if test $acx_with_hwloc != "no"; then
+    AC_LANG_SAVE
+    AC_LANG_C
+    AC_CHECK_HEADER([hwloc.h], [], [AC_MSG_ERROR([Unable to compile with hwloc.])])
+    AC_CHECK_LIB([hwloc], [hwloc_topology_init], [LIBS="$LIBS -lhwloc"], [AC_MSG_ERROR(["Unable to link with hwloc])])
+    AC_DEFINE(HAVE_HWLOC, [1], [Define if should use hwloc for NUMA-aware placement])
+    AC_LANG_RESTORE
+  fi
+])
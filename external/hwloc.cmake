@@ -0,0 +1,10 @@
+if(ENABLE_HWLOC)
+
+  find_package(HWLOC)
+
+  # Set the output variables
+  if(HWLOC_FOUND)
+    set(HAVE_HWLOC 1)
+  endif()
+
+endif()
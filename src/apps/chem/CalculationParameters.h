@@ -77,6 +77,7 @@ struct CalculationParameters {
     bool no_compute;            ///< If true use orbitals on disk, set value to computed
     bool no_orient;             ///< If true the molecule coordinates will not be reoriented
     bool save;                  ///< If true save orbitals to disk
+    bool async_save;            ///< If true save orbitals as a checkpoint written in the background
     unsigned int maxsub;        ///< Size of iterative subspace ... set to 0 or 1 to disable
     double orbitalshift;        ///< scf orbital shift: shift the occ orbitals to lower energies
     int npt_plot;               ///< No. of points to use in each dim for plots
@@ -114,6 +115,8 @@ struct CalculationParameters {
     int nv_factor;              ///< factor to multiply number of virtual orbitals with when automatically decreasing nvirt
     int vnucextra; // load balance parameter for nuclear pot.
     int loadbalparts = 2; // was 6
+    double loadbal_imbalance;   ///< If positive rebalance with measured costs when max/mean work per process exceeds this
+    double exchange_memory;     ///< If positive the memory (MB per process) for the pair potentials of one exchange tile
     std::string pcm_data;            ///< do a PCM (solvent) calculation
 
 
@@ -138,7 +141,8 @@ struct CalculationParameters {
         ar & xc_data & protocol_data;
         ar & gopt & gtol & gtest & gval & gprec & gmaxiter & ginitial_hessian & algopt & tdksprop
         & nuclear_corrfac & psp_calc & print_dipole_matels & pure_ae & hessian & read_cphf & restart_cphf
-        & purify_hessian & vnucextra & loadbalparts & pcm_data;
+        & purify_hessian & vnucextra & loadbalparts & pcm_data & async_save & loadbal_imbalance
+        & exchange_memory;
     }
 
     CalculationParameters()
@@ -166,6 +170,7 @@ struct CalculationParameters {
     , no_compute(false)
     , no_orient(false)
     , save(true)
+    , async_save(false)
     , maxsub(5)
     , orbitalshift(0.0)
     , npt_plot(101)
@@ -201,6 +206,8 @@ struct CalculationParameters {
     , nv_factor(1)
     , vnucextra(12)
     , loadbalparts(2)
+    , loadbal_imbalance(0.0)
+    , exchange_memory(0.0)
     , pcm_data("none")
     , response(false)
     , response_freq(0.0)
@@ -226,6 +233,12 @@ struct CalculationParameters {
             else if (s == "loadbal") {
                 f >> vnucextra >> loadbalparts;
             }
+            else if (s == "loadbal_imbalance") {
+                f >> loadbal_imbalance;
+            }
+            else if (s == "exchange_memory") {
+                f >> exchange_memory;
+            }
             else if (s == "charge") {
                 f >> charge;
             }
@@ -337,6 +350,9 @@ struct CalculationParameters {
                     MADNESS_EXCEPTION("input_error", 0);
                 }
             }
+            else if (s == "async_save") {
+                async_save = true;
+            }
             else if (s == "no_compute") {
                 no_compute = true;
             }
@@ -517,8 +533,13 @@ struct CalculationParameters {
         madness::print("    restart from AOs ", restartao);
         madness::print(" number of processes ", world.size());
         madness::print("   no. of io servers ", nio);
+        madness::print("  async orbital save ", async_save);
         madness::print("   vnuc load bal fac ", vnucextra);
         madness::print("      load bal parts ", loadbalparts);
+        if (loadbal_imbalance > 0.0)
+            madness::print("  load bal imbalance ", loadbal_imbalance);
+        if (exchange_memory > 0.0)
+            madness::print(" exchange memory(MB) ", exchange_memory);
         madness::print("     simulation cube ", -L, L);
         madness::print("        total charge ", charge);
         madness::print("            smearing ", smear);
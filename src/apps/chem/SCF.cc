@@ -237,13 +237,24 @@ namespace madness {
         ar & current_energy & param.spin_restricted;
         ar & (unsigned int) (amo.size());
         ar & aeps & aocc & aset;
-        for (unsigned int i = 0; i < amo.size(); ++i)
-            ar & amo[i];
+        if (param.async_save) {
+            // Only the orbitals are large enough to be worth writing in the background
+            save_checkpoint(amo, "restartdata.amo");
+        }
+        else {
+            for (unsigned int i = 0; i < amo.size(); ++i)
+                ar & amo[i];
+        }
         if (!param.spin_restricted) {
             ar & (unsigned int) (bmo.size());
             ar & beps & bocc & bset;
-            for (unsigned int i = 0; i < bmo.size(); ++i)
-                ar & bmo[i];
+            if (param.async_save) {
+                save_checkpoint(bmo, "restartdata.bmo");
+            }
+            else {
+                for (unsigned int i = 0; i < bmo.size(); ++i)
+                    ar & bmo[i];
+            }
         }
 
         tensorT Saoamo = matrix_inner(world, ao, amo);
@@ -265,6 +276,7 @@ namespace madness {
         amo.clear();
         bmo.clear();
         
+        if (param.async_save) checkpoint_wait(world);
         archive::ParallelInputArchive ar(world, "restartdata");
         
         /*
@@ -290,9 +302,15 @@ namespace madness {
         ar & nmo;
         MADNESS_ASSERT(nmo >= unsigned(param.nmo_alpha));
         ar & aeps & aocc & aset;
-        amo.resize(nmo);
-        for (unsigned int i = 0; i < amo.size(); ++i)
-            ar & amo[i];
+        if (param.async_save) {
+            load_checkpoint(world, amo, "restartdata.amo");
+            MADNESS_ASSERT(amo.size() == nmo);
+        }
+        else {
+            amo.resize(nmo);
+            for (unsigned int i = 0; i < amo.size(); ++i)
+                ar & amo[i];
+        }
         unsigned int n_core = molecule.n_core_orb_all();
         if (nmo > unsigned(param.nmo_alpha)) {
             aset = vector<int>(aset.begin() + n_core,
@@ -330,9 +348,15 @@ namespace madness {
                 ar & nmo;
                 ar & beps & bocc & bset;
                 
-                bmo.resize(nmo);
-                for (unsigned int i = 0; i < bmo.size(); ++i)
-                    ar & bmo[i];
+                if (param.async_save) {
+                    load_checkpoint(world, bmo, "restartdata.bmo");
+                    MADNESS_ASSERT(bmo.size() == nmo);
+                }
+                else {
+                    bmo.resize(nmo);
+                    for (unsigned int i = 0; i < bmo.size(); ++i)
+                        ar & bmo[i];
+                }
                 
                 if (nmo > unsigned(param.nmo_beta)) {
                     bset = vector<int>(bset.begin() + n_core,
@@ -1373,8 +1397,10 @@ namespace madness {
         if (xc.hf_exchange_coefficient()) {
             START_TIMER(world);
 //            vecfuncT Kamo = apply_hf_exchange(world, occ, amo, amo);
-            Exchange K=Exchange(world,this,ispin).small_memory(false).same(true);
+            Exchange K=Exchange(world,this,ispin).small_memory(false).same(true)
+                    .memory_budget(param.exchange_memory);
             vecfuncT Kamo=K(amo);
+            if (world.rank() == 0) K.statistics().print();
             tensorT excv = inner(world, Kamo, amo);
             double exchf = 0.0;
             for (unsigned long i = 0; i < amo.size(); ++i) {
@@ -1881,13 +1907,22 @@ namespace madness {
         lb.add_tree(vnuc, lbcost<double, 3>(param.vnucextra * 1.0, param.vnucextra * 8.0),
                     false);
         lb.add_tree(arho, lbcost<double, 3>(1.0, 8.0), false);
+        // With measurement the work recorded since the last iteration is
+        // charged to the orbital boxes on top of the shape cost
+        const bool measured = LBCostRecorder<3>::enabled();
         for (unsigned int i = 0; i < amo.size(); ++i) {
-            lb.add_tree(amo[i], lbcost<double, 3>(1.0, 8.0), false);
+            if (measured)
+                lb.add_tree(amo[i], LBMeasuredCost<double, 3>(1.0, 8.0), false);
+            else
+                lb.add_tree(amo[i], lbcost<double, 3>(1.0, 8.0), false);
         }
         if (param.nbeta && !param.spin_restricted) {
             lb.add_tree(brho, lbcost<double, 3>(1.0, 8.0), false);
             for (unsigned int i = 0; i < bmo.size(); ++i) {
-                lb.add_tree(bmo[i], lbcost<double, 3>(1.0, 8.0), false);
+                if (measured)
+                    lb.add_tree(bmo[i], LBMeasuredCost<double, 3>(1.0, 8.0), false);
+                else
+                    lb.add_tree(bmo[i], lbcost<double, 3>(1.0, 8.0), false);
             }
         }
         world.gop.fence();
@@ -2341,6 +2376,13 @@ namespace madness {
         // Shrink subspace until stop localizing/canonicalizing
         int maxsub_save = param.maxsub;
         param.maxsub = 2;
+
+        // Measure the work per box to detect and correct imbalance
+        const bool measure = (param.loadbal_imbalance > 0.0 && world.size() > 1);
+        if (measure) {
+            LBCostRecorder<3>::clear();
+            LBCostRecorder<3>::enable();
+        }
         
         for (int iter = 0; iter < param.maxiter; ++iter) {
             if (world.rank() == 0)
@@ -2394,12 +2436,20 @@ namespace madness {
             END_TIMER(world, "Make densities");
             print_meminfo(world.rank(), "Make densities");
             
-            if (iter < 2 || (iter % 10) == 0) {
+            bool rebalance = (iter < 2 || (iter % 10) == 0);
+            if (measure && iter > 0) {
+                const double imbalance = LBCostRecorder<3>::imbalance(world);
+                if (world.rank() == 0)
+                    print("measured load imbalance", imbalance);
+                rebalance = rebalance || (imbalance > param.loadbal_imbalance);
+            }
+            if (rebalance) {
                 START_TIMER(world);
                 loadbal(world, arho, brho, arho_old, brho_old, subspace);
                 END_TIMER(world, "Load balancing");
                 print_meminfo(world.rank(), "Load balancing");
             }
+            if (measure) LBCostRecorder<3>::clear();
             double da = 0.0, db = 0.0;
             if (iter > 0) {
                 da = (arho - arho_old).norm2();
@@ -2929,7 +2979,8 @@ namespace madness {
         if(xc.hf_exchange_coefficient()){
             START_TIMER(world);
             vecfuncT Kdmo;
-            Exchange K=Exchange(world,this,ispin).small_memory(false).same(false);
+            Exchange K=Exchange(world,this,ispin).small_memory(false).same(false)
+                    .memory_budget(param.exchange_memory);
             if(ispin == 0)
                 Kdmo=K(amo); 
             if(ispin == 1)
@@ -135,6 +135,21 @@ namespace madness {
         double operator()(const coordT& x) const {
             return aobasis.eval_guess_density(molecule, x[0], x[1], x[2]);
         }
+
+        bool supports_vectorized() const {return true;}
+
+        void operator()(const Vector<double*,3>& xvals, double* fvals, int npts) const {
+            coordT lo, hi;
+            for (int d=0; d<3; ++d) {
+                lo[d] = *std::min_element(xvals[d], xvals[d]+npts);
+                hi[d] = *std::max_element(xvals[d], xvals[d]+npts);
+            }
+            aobasis.eval_guess_density(molecule, npts, xvals[0], xvals[1], xvals[2], lo.data(), hi.data(), fvals);
+        }
+
+        bool screened(const coordT& c1, const coordT& c2) const {
+            return aobasis.guess_density_negligible(molecule, c1.data(), c2.data());
+        }
         
         std::vector<coordT> special_points() const {return molecule.get_all_coords_vec();}
     };
@@ -152,6 +167,16 @@ namespace madness {
         double operator()(const coordT& x) const {
             return aofunc(x[0], x[1], x[2]);
         }
+
+        bool supports_vectorized() const {return true;}
+
+        void operator()(const Vector<double*,3>& xvals, double* fvals, int npts) const {
+            aofunc(npts, xvals[0], xvals[1], xvals[2], fvals);
+        }
+
+        bool screened(const coordT& c1, const coordT& c2) const {
+            return aofunc.is_negligible(c1.data(), c2.data());
+        }
         
         std::vector<coordT> special_points() const {
             return std::vector<coordT>(1,aofunc.get_coords_vec());
@@ -376,6 +401,7 @@ namespace madness {
             FunctionDefaults<NDIM>::set_apply_randomize(false);
             FunctionDefaults<NDIM>::set_project_randomize(false);
             FunctionDefaults<NDIM>::set_cubic_cell(-param.L, param.L);
+            if (world.rank() == 0) GaussianConvolution1DCache<double>::save();
             GaussianConvolution1DCache<double>::map.clear();
             double safety = 0.1;
             vtol = FunctionDefaults<NDIM>::get_thresh() * safety;
@@ -811,6 +837,7 @@ namespace madness {
                 }
                 
             }
+            if (calc.param.save && calc.param.async_save) checkpoint_wait(world);
             return calc.current_energy;
         }
         
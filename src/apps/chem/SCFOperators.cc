@@ -292,7 +292,7 @@ vecfuncT DNuclear::operator()(const vecfuncT& vket) const {
 
 
 Exchange::Exchange(World& world, const SCF* calc, const int ispin)
-        : world(world), small_memory_(true), same_(false) {
+        : world(world), small_memory_(true), same_(false), memory_budget_(0.0) {
     if (ispin==0) { // alpha spin
         mo_ket=calc->amo;
         occ=calc->aocc;
@@ -306,7 +306,7 @@ Exchange::Exchange(World& world, const SCF* calc, const int ispin)
 }
 
 Exchange::Exchange(World& world, const Nemo* nemo, const int ispin)
-    : world(world), small_memory_(true), same_(false) {
+    : world(world), small_memory_(true), same_(false), memory_budget_(0.0) {
 
     if (ispin==0) { // alpha spin
         mo_ket=nemo->get_calc()->amo;
@@ -333,9 +333,164 @@ void Exchange::set_parameters(const vecfuncT& bra, const vecfuncT& ket,
             CoulombOperatorPtr(world, lo, econv));
 }
 
+/// level of the boxes in which the overlap of the orbitals is measured
+static const Level exchange_screening_level=3;
+
+/// norms of the functions in the boxes at level n, row i for function v[i]
+
+/// A leaf coarser than n counts with its full norm in all boxes below it.
+/// On return nbox[i] is the number of boxes with coefficients of v[i].
+static Tensor<double> box_norms(World& world, const vecfuncT& v, const Level n,
+        std::vector<double>& nbox) {
+    const long twon=1l<<n;
+    Tensor<double> norms(long(v.size()),twon*twon*twon);
+    Tensor<double> count(long(v.size()));
+    for (std::size_t i=0; i<v.size(); ++i) {
+        const FunctionImpl<double,3>::dcT& coeffs=v[i].get_impl()->get_coeffs();
+        for (FunctionImpl<double,3>::dcT::const_iterator it=coeffs.begin(); it!=coeffs.end(); ++it) {
+            const Key<3>& key=it->first;
+            const FunctionNode<double,3>& node=it->second;
+            if (node.has_coeff()) count(i)+=1.0;
+            if (key.level()>n || (key.level()<n && node.has_children())) continue;
+
+            const int shift=n-key.level();
+            const Vector<Translation,3>& l=key.translation();
+            for (long x=l[0]<<shift; x<(l[0]+1)<<shift; ++x)
+                for (long y=l[1]<<shift; y<(l[1]+1)<<shift; ++y)
+                    for (long z=l[2]<<shift; z<(l[2]+1)<<shift; ++z)
+                        norms(i,(x*twon+y)*twon+z)=node.get_norm_tree();
+        }
+    }
+    world.gop.sum(norms.ptr(),norms.size());
+    world.gop.sum(count.ptr(),count.size());
+    nbox.assign(count.ptr(),count.ptr()+count.size());
+    return norms;
+}
+
+/// number of boxes with coefficients in all functions of v
+static double count_boxes(World& world, const vecfuncT& v) {
+    double sum=0.0;
+    for (std::size_t i=0; i<v.size(); ++i) {
+        const FunctionImpl<double,3>::dcT& coeffs=v[i].get_impl()->get_coeffs();
+        for (FunctionImpl<double,3>::dcT::const_iterator it=coeffs.begin(); it!=coeffs.end(); ++it) {
+            if (it->second.has_coeff()) sum+=1.0;
+        }
+    }
+    world.gop.sum(sum);
+    return sum;
+}
+
+void Exchange::Statistics::print() const {
+    madness::print("exchange: pairs",npair,"screened",nscreened,"tiles",ntile,
+            "boxes",nbox,"mul Gflop",flops*1e-9);
+    madness::print("exchange: wall time screen",time_screen,"mul",time_mul,
+            "apply",time_apply,"accumulate",time_acc);
+}
+
+/// A pair is kept if in any box at the screening level the product of
+/// the norms of bra_i and f_j exceeds the tolerance of mul_sparse, which
+/// would otherwise make the product zero there.
+Exchange::pairlistT Exchange::screened_pairs(const vecfuncT& vket,
+        std::vector<double>& pairsize) const {
+    const Level n=exchange_screening_level;
+    const int nocc=mo_bra.size();
+    const int nf=vket.size();
+    if (nocc==0 || nf==0) return pairlistT();
+    std::vector<double> nbra, nket;
+    const Tensor<double> bnorm=box_norms(world,mo_bra,n,nbra);
+    const Tensor<double> knorm=box_norms(world,vket,n,nket);
+    const long ncell=bnorm.dim(1);
+    const double tol=mo_bra[0].get_impl()->truncate_tol(FunctionDefaults<3>::get_thresh(),
+            Key<3>(n,Vector<Translation,3>(0)));
+
+    pairlistT pairs;
+    for (int i=0; i<nocc; ++i) {
+        const int jtop=same() ? i+1 : nf;
+        for (int j=0; j<jtop; ++j) {
+            if (occ[i]==0.0 && !(same() && occ[j]!=0.0)) continue;
+            ++stats.npair;
+
+            const double* a=&bnorm(i,0);
+            const double* b=&knorm(j,0);
+            long c=0;
+            while (c<ncell && a[c]*b[c]<tol) ++c;
+            if (c==ncell) {
+                ++stats.nscreened;
+                continue;
+            }
+            pairs.push_back(std::make_pair(i,j));
+            pairsize.push_back(std::max(nbra[i],nket[j]));
+        }
+    }
+    return pairs;
+}
+
+void Exchange::apply_tile(const vecfuncT& vket, const pairlistT& tile, vecfuncT& Kf) const {
+    const double tol = FunctionDefaults < 3 > ::get_thresh(); /// Important this is consistent with Coulomb
+    const double k=FunctionDefaults<3>::get_k();
+    const double mulflops=18.0*k*k*k*k;     // two transforms to values, product and transform back
+    ++stats.ntile;
+
+    // bra_i f_j with one sparse multiplication per orbital i
+    double start=wall_time();
+    vecfuncT psif;
+    psif.reserve(tile.size());
+    for (std::size_t p0=0, p1=0; p0<tile.size(); p0=p1) {
+        const int i=tile[p0].first;
+        vecfuncT f;
+        for (p1=p0; p1<tile.size() && tile[p1].first==i; ++p1) f.push_back(vket[tile[p1].second]);
+        vecfuncT prod=vmulXX(mo_bra[i],f,tol,false);
+        psif.insert(psif.end(),prod.begin(),prod.end());
+    }
+    world.gop.fence();
+    stats.flops+=mulflops*count_boxes(world,psif);
+    truncate(world, psif);
+    stats.nbox+=count_boxes(world,psif);
+    stats.time_mul+=wall_time()-start;
+
+    start=wall_time();
+    psif = apply(world, *poisson.get(), psif);
+    truncate(world, psif, tol);
+    reconstruct(world, psif);
+    norm_tree(world, psif);
+    stats.time_apply+=wall_time()-start;
+
+    // ket_i G(bra_i f_j) adds to K f_j, and if same ket_j G(bra_i f_j) to K f_i
+    start=wall_time();
+    vecfuncT Kpsif;
+    std::vector<std::pair<int,double> > target;     // index in Kf and occupation
+    for (std::size_t p0=0, p1=0; p0<tile.size(); p0=p1) {
+        const int i=tile[p0].first;
+        for (p1=p0; p1<tile.size() && tile[p1].first==i; ++p1)
+            target.push_back(std::make_pair(tile[p1].second,occ[i]));
+        vecfuncT pot(psif.begin()+p0,psif.begin()+p1);
+        vecfuncT prod=vmulXX(mo_ket[i],pot,tol,false);
+        Kpsif.insert(Kpsif.end(),prod.begin(),prod.end());
+    }
+    if (same()) {
+        for (std::size_t p=0; p<tile.size(); ++p) {
+            const int i=tile[p].first, j=tile[p].second;
+            if (i==j) continue;
+            Kpsif.push_back(mul_sparse(psif[p],mo_ket[j],tol,false));
+            target.push_back(std::make_pair(i,occ[j]));
+        }
+    }
+    world.gop.fence();
+    psif.clear();
+    stats.flops+=mulflops*count_boxes(world,Kpsif);
+
+    compress(world, Kpsif);
+    for (std::size_t q=0; q<Kpsif.size(); ++q) {
+        Kf[target[q].first].gaxpy(1.0, Kpsif[q], target[q].second, false);
+    }
+    world.gop.fence();
+    Kpsif.clear();
+    world.gop.fence();
+    stats.time_acc+=wall_time()-start;
+}
+
 vecfuncT Exchange::operator()(const vecfuncT& vket) const {
     const bool same = this->same();
-    int nocc = mo_bra.size();
     int nf = vket.size();
     double tol = FunctionDefaults < 3 > ::get_thresh(); /// Important this is consistent with Coulomb
     vecfuncT Kf = zero_functions_compressed<double, 3>(world, nf);
@@ -347,61 +502,34 @@ vecfuncT Exchange::operator()(const vecfuncT& vket) const {
         reconstruct(world, vket);
         norm_tree(world, vket);
     }
-
-    if (small_memory_) {     // Smaller memory algorithm ... possible 2x saving using i-j sym
-        for(int i=0; i<nocc; ++i){
-            if(occ[i] > 0.0){
-                vecfuncT psif = mul_sparse(world, mo_bra[i], vket, tol); /// was vtol
-                truncate(world, psif);
-                psif = apply(world, *poisson.get(), psif);
-                truncate(world, psif);
-                psif = mul_sparse(world, mo_ket[i], psif, tol); /// was vtol
-                gaxpy(world, 1.0, Kf, occ[i], psif);
-            }
+    MADNESS_ASSERT(!same || nf==int(mo_ket.size()));
+
+    stats=Statistics();
+    double start=wall_time();
+    std::vector<double> pairsize;
+    const pairlistT pairs=screened_pairs(vket,pairsize);
+    stats.time_screen=wall_time()-start;
+
+    // a tile holds the pairs of one orbital i (small_memory), all pairs,
+    // or as many as fit into the budget with the product, its potential
+    // and ket_i times the potential as large as the larger of bra_i and f_j
+    const double k=FunctionDefaults<3>::get_k();
+    const double budget=memory_budget_*1024.0*1024.0;
+    pairlistT tile;
+    double tilesize=0.0;
+    for (std::size_t p=0; p<pairs.size(); ++p) {
+        const double size=3.0*8.0*k*k*k*pairsize[p]/world.size();
+        if (tile.size() && ((budget>0.0) ? (tilesize+size>budget)
+                : (small_memory_ && tile.back().first!=pairs[p].first))) {
+            apply_tile(vket,tile,Kf);
+            tile.clear();
+            tilesize=0.0;
         }
-    } else {    // Larger memory algorithm ... use i-j sym if psi==f
-        vecfuncT psif;
-        for (int i = 0; i < nocc; ++i) {
-            int jtop = nf;
-            if (same)
-                jtop = i + 1;
-            for (int j = 0; j < jtop; ++j) {
-                psif.push_back(mul_sparse(mo_bra[i], vket[j], tol, false));
-            }
-        }
-
-        world.gop.fence();
-        truncate(world, psif);
-        psif = apply(world, *poisson.get(), psif);
-        truncate(world, psif, tol);
-        reconstruct(world, psif);
-        norm_tree(world, psif);
-        vecfuncT psipsif = zero_functions<double, 3>(world, nf * nocc);
-        int ij = 0;
-        for (int i = 0; i < nocc; ++i) {
-            int jtop = nf;
-            if (same)
-                jtop = i + 1;
-            for (int j = 0; j < jtop; ++j, ++ij) {
-                psipsif[i * nf + j] = mul_sparse(psif[ij], mo_ket[i], false);
-                if (same && i != j) {
-                    psipsif[j * nf + i] = mul_sparse(psif[ij], mo_ket[j], false);
-                }
-            }
-        }
-        world.gop.fence();
-        psif.clear();
-        world.gop.fence();
-        compress(world, psipsif);
-        for (int i = 0; i < nocc; ++i) {
-            for (int j = 0; j < nf; ++j) {
-                Kf[j].gaxpy(1.0, psipsif[i * nf + j], occ[i], false);
-            }
-        }
-        world.gop.fence();
-        psipsif.clear();
-        world.gop.fence();
+        tile.push_back(pairs[p]);
+        tilesize+=size;
     }
+    if (tile.size()) apply_tile(vket,tile,Kf);
+
     truncate(world, Kf, tol);
     return Kf;
 
@@ -328,11 +328,34 @@ private:
 
 };
 
+/// the exchange operator K f_j = \sum_i occ_i ket_i G(bra_i f_j)
+
+/// The pair products bra_i f_j are formed, screened and passed to the
+/// Poisson operator in tiles: with small_memory one tile per orbital i,
+/// otherwise all pairs at once, or as many pairs as fit into the
+/// memory_budget if one is given.  Pairs whose trees do not overlap
+/// are skipped, and if same is set only the pairs i>=j are computed.
 class Exchange {
 public:
 
+    /// work done by the last application of the operator
+    struct Statistics {
+        long npair;             ///< number of orbital pairs (i>=j if same)
+        long nscreened;         ///< pairs skipped because bra_i and f_j do not overlap
+        long ntile;             ///< number of batches of Poisson applies
+        double nbox;            ///< number of boxes of the pair products given to the Poisson operator
+        double flops;           ///< estimated flops of the multiplications
+        double time_screen, time_mul, time_apply, time_acc;   ///< wall times
+
+        Statistics() : npair(0), nscreened(0), ntile(0), nbox(0.0), flops(0.0),
+                time_screen(0.0), time_mul(0.0), time_apply(0.0), time_acc(0.0) {}
+
+        void print() const;
+    };
+
     /// default ctor
-    Exchange(World& world) : world(world), small_memory_(true), same_(false) {};
+    Exchange(World& world) : world(world), small_memory_(true), same_(false),
+            memory_budget_(0.0) {};
 
     /// ctor with a conventional calculation
     Exchange(World& world, const SCF* calc, const int ispin);
@@ -389,11 +412,32 @@ public:
         return *this;
     }
 
+    /// memory (MB per process) for the pair potentials of one tile, 0 to tile by small_memory
+    double& memory_budget() {return memory_budget_;}
+    double memory_budget() const {return memory_budget_;}
+    Exchange& memory_budget(const double mbytes) {
+        memory_budget_=mbytes;
+        return *this;
+    }
+
+    /// statistics of the last application of the operator
+    const Statistics& statistics() const {return stats;}
+
 private:
 
+    typedef std::vector<std::pair<int,int> > pairlistT;
+
+    /// return the pairs (i,j) whose products bra_i f_j are not negligible
+    pairlistT screened_pairs(const vecfuncT& vket, std::vector<double>& pairsize) const;
+
+    /// add the contribution of the pairs in a tile to Kf
+    void apply_tile(const vecfuncT& vket, const pairlistT& tile, vecfuncT& Kf) const;
+
     World& world;
     bool small_memory_;
     bool same_;
+    double memory_budget_;
+    mutable Statistics stats;
     vecfuncT mo_bra, mo_ket;    ///< MOs for bra and ket
     Tensor<double> occ;
     std::shared_ptr<real_convolution_3d> poisson;
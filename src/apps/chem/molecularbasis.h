@@ -47,6 +47,20 @@
 #include <cstdio>
 
 namespace madness {
+
+/// Returns the square of the distance from (x,y,z) to the box lo..hi (zero if inside)
+inline double distance_sq_to_box(double x, double y, double z, const double* lo, const double* hi) {
+    const double c[3] = {x, y, z};
+    double rsq = 0.0;
+    for (int i=0; i<3; ++i) {
+        double d = 0.0;
+        if (c[i] < lo[i]) d = lo[i] - c[i];
+        else if (c[i] > hi[i]) d = c[i] - hi[i];
+        rsq += d*d;
+    }
+    return rsq;
+}
+
 /// Represents a single shell of contracted, Cartesian, Gaussian primitives
 class ContractedGaussianShell {
     int type;  ///< Angular momentum = 0, 1, 2, ...
@@ -117,6 +131,38 @@ public:
     }
 
 
+    /// Evaluates the radial part of the contracted function at npt points, R[i] = eval_radial(rsq[i])
+
+    /// The loops over points have no branches so the compiler may
+    /// vectorize them including the exponentials.
+    void eval_radial(long npt, const double* rsq, double* R) const {
+        for (long p=0; p<npt; ++p) R[p] = 0.0;
+        for (unsigned int i=0; i<coeff.size(); ++i) {
+            const double c = coeff[i], e = expnt[i];
+            for (long p=0; p<npt; ++p) {
+                const double ersq = e*rsq[p];
+                R[p] += (ersq < 27.6) ? c*exp(-ersq) : 0.0; // 27.6 = log(1e12)
+            }
+        }
+        for (long p=0; p<npt; ++p) {
+            if (rsq[p] > rsqmax) R[p] = 0.0;
+        }
+    }
+
+
+    /// Returns the powers of x, y and z of basis function ibf in the shell
+    void get_powers(int ibf, int& lx, int& ly, int& lz) const {
+        MADNESS_ASSERT(ibf<numbf && ibf >= 0);
+        // same order as in eval(): xx, xy, xz, yy, yz, zz, ...
+        for (lx=type; lx>=0; --lx) {
+            for (ly=type-lx; ly>=0; --ly) {
+                lz = type-lx-ly;
+                if (ibf-- == 0) return;
+            }
+        }
+    }
+
+
     /// Evaluates the entire shell returning the incremented result pointer
     double* eval(double rsq, double x, double y, double z, double* bf) const {
         double R = eval_radial(rsq);
@@ -279,6 +325,11 @@ public:
         return bf;
     }
 
+    /// Returns square of the distance beyond which all functions on the center are negligible
+    double rangesq() const {
+        return rmaxsq;
+    }
+
     /// Evaluates the guess atomic density at point x, y, z relative to atomic center
     double eval_guess_density(double x, double y, double z, bool pspat) const {
         MADNESS_ASSERT(has_guess_info());
@@ -421,6 +472,34 @@ public:
         return bf[ibf];
     }
 
+    /// Evaluates the function at npt points, f[i] = (*this)(x[i],y[i],z[i])
+    void operator()(long npt, const double* x, const double* y, const double* z, double* f) const {
+        int lx, ly, lz;
+        shell.get_powers(ibf, lx, ly, lz);
+        std::vector<double> rsq(npt);
+        for (long p=0; p<npt; ++p) {
+            const double dx=x[p]-xx, dy=y[p]-yy, dz=z[p]-zz;
+            rsq[p] = dx*dx + dy*dy + dz*dz;
+        }
+        shell.eval_radial(npt, rsq.data(), f);
+        for (long p=0; p<npt; ++p) {
+            if (fabs(f[p]) < 1e-12) {
+                f[p] = 0.0;
+            }
+            else {
+                const double dx=x[p]-xx, dy=y[p]-yy, dz=z[p]-zz;
+                for (int i=0; i<lx; ++i) f[p] *= dx;
+                for (int i=0; i<ly; ++i) f[p] *= dy;
+                for (int i=0; i<lz; ++i) f[p] *= dz;
+            }
+        }
+    }
+
+    /// Returns true if the function is zero at all points in the box lo..hi
+    bool is_negligible(const double* lo, const double* hi) const {
+        return distance_sq_to_box(xx, yy, zz, lo, hi) > shell.rangesq();
+    }
+
     void print_me(std::ostream& s) const;
 
     const ContractedGaussianShell& get_shell() const {
@@ -594,6 +673,29 @@ public:
         return sum;
     }
 
+    /// Evaluates the guess density at npt points within the box lo..hi, skipping atoms out of range
+    void eval_guess_density(const Molecule& molecule, long npt, const double* x, const double* y, const double* z,
+                            const double* lo, const double* hi, double* f) const {
+        for (long p=0; p<npt; ++p) f[p] = 0.0;
+        for (int i=0; i<molecule.natom(); ++i) {
+            const Atom& atom = molecule.get_atom(i);
+            const AtomicBasis& basis = ag[atom.atomic_number];
+            if (distance_sq_to_box(atom.x, atom.y, atom.z, lo, hi) > basis.rangesq()) continue;
+            for (long p=0; p<npt; ++p) {
+                f[p] += basis.eval_guess_density(x[p]-atom.x, y[p]-atom.y, z[p]-atom.z, atom.pseudo_atom);
+            }
+        }
+    }
+
+    /// Returns true if the guess density is zero at all points in the box lo..hi
+    bool guess_density_negligible(const Molecule& molecule, const double* lo, const double* hi) const {
+        for (int i=0; i<molecule.natom(); ++i) {
+            const Atom& atom = molecule.get_atom(i);
+            if (distance_sq_to_box(atom.x, atom.y, atom.z, lo, hi) <= ag[atom.atomic_number].rangesq()) return false;
+        }
+        return true;
+    }
+
     bool is_supported(int atomic_number) const {
         return ag[atomic_number].nbf() > 0;
     }
@@ -773,6 +773,22 @@ double Molecule::nuclear_attraction_potential(double x, double y, double z) cons
     return sum;
 }
 
+void Molecule::nuclear_attraction_potential(long npt, const double* x, const double* y, const double* z,
+                                            double* v) const {
+    // Same operations in the same order as the pointwise version, but
+    // with the loop over points innermost
+    for (long p=0; p<npt; ++p) v[p] = 0.0;
+    for (unsigned int i=0; i<atoms.size(); ++i) {
+        if (atoms[i].pseudo_atom) continue;
+        const double q = atoms[i].q, rc = rcut[i];
+        for (long p=0; p<npt; ++p) {
+            double r = distance(atoms[i].x, atoms[i].y, atoms[i].z, x[p], y[p], z[p]);
+            v[p] -= q * smoothed_potential(r*rc)*rc;
+        }
+    }
+    for (long p=0; p<npt; ++p) v[p] += field[0] * x[p] + field[1] * y[p] + field[2] * z[p];
+}
+
 double Molecule::atomic_attraction_potential(int iatom, double x, double y,
         double z) const {
 
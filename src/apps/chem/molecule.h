@@ -305,6 +305,9 @@ public:
     /// nuclear attraction potential for the whole molecule
     double nuclear_attraction_potential(double x, double y, double z) const;
 
+    /// nuclear attraction potential for the whole molecule at npt points
+    void nuclear_attraction_potential(long npt, const double* x, const double* y, const double* z, double* v) const;
+
     /// nuclear attraction potential for a specific atom in the molecule
     double atomic_attraction_potential(int iatom, double x, double y, double z) const;
 
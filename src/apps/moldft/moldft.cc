@@ -206,6 +206,7 @@ END_TIMER(world, "initialize");
       // Nearly all memory will be freed at this point
       world.gop.fence();
       world.gop.fence();
+      if (world.rank() == 0) GaussianConvolution1DCache<double>::save();
       print_stats(world);
     } // world is dead -- ready to finalize
     finalize();
@@ -0,0 +1,182 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file mra/checkpoint.cc
+/// \brief Background writer for asynchronous checkpoints
+
+#include <madness/mra/checkpoint.h>
+#include <cstdio>
+#include <fstream>
+#include <list>
+#include <utility>
+
+namespace madness {
+    namespace detail {
+
+        namespace {
+
+            /// The thread that writes queued files in order
+            class WriterThread : public ThreadBase {
+                typedef std::pair< std::string, std::vector<unsigned char> > itemT;
+
+                PthreadConditionVariable cv; // Protects all below
+                std::list<itemT> queue;
+                int npending;                // Queued or being written
+                bool ok;                     // False if a write failed
+
+                static bool write(const itemT& item) {
+                    const std::string tmp = item.first + ".tmp";
+                    {
+                        std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+                        if (!out) return false;
+                        if (item.second.size())
+                            out.write(reinterpret_cast<const char*>(&item.second[0]), item.second.size());
+                        out.close();
+                        if (!out) return false;
+                    }
+                    return std::rename(tmp.c_str(), item.first.c_str()) == 0;
+                }
+
+                void run() {
+                    cv.lock();
+                    while (true) {
+                        while (queue.empty()) cv.wait();
+                        itemT item;
+                        std::swap(item, queue.front());
+                        queue.pop_front();
+                        cv.unlock();
+
+                        const bool status = write(item);
+                        if (!status)
+                            print("CheckpointWriter: failed to write", item.first);
+                        item.second = std::vector<unsigned char>(); // Release the memory now
+
+                        cv.lock();
+                        ok = ok && status;
+                        --npending;
+                        cv.broadcast();
+                    }
+                }
+
+            public:
+                WriterThread() : npending(0), ok(true) {
+                    start();
+                }
+
+                void submit(const std::string& filename, std::vector<unsigned char>& data) {
+                    cv.lock();
+                    queue.push_back(itemT(filename, std::vector<unsigned char>()));
+                    queue.back().second.swap(data);
+                    ++npending;
+                    cv.broadcast();
+                    cv.unlock();
+                }
+
+                bool wait() {
+                    cv.lock();
+                    while (npending) cv.wait();
+                    const bool status = ok;
+                    ok = true;
+                    cv.unlock();
+                    return status;
+                }
+            };
+
+            // Started on first use and never destroyed since it cannot be joined
+            WriterThread& writer() {
+                static WriterThread* w = new WriterThread;
+                return *w;
+            }
+
+        } // namespace
+
+        void CheckpointWriter::submit(const std::string& filename, std::vector<unsigned char>& data) {
+            writer().submit(filename, data);
+        }
+
+        bool CheckpointWriter::wait() {
+            return writer().wait();
+        }
+
+        bool CheckpointWriter::read(const std::string& filename, std::vector<unsigned char>& data) {
+            std::ifstream in(filename.c_str(), std::ios::binary | std::ios::ate);
+            if (!in) return false;
+            const std::streamoff size = in.tellg();
+            in.seekg(0);
+            data.resize(size);
+            if (size) in.read(reinterpret_cast<char*>(&data[0]), size);
+            return bool(in);
+        }
+
+        std::string checkpoint_shard_name(const std::string& name, ProcessID p) {
+            char buf[16];
+            sprintf(buf, ".%5.5d", p);
+            return name + buf;
+        }
+
+        std::string checkpoint_index_name(const std::string& name) {
+            return name + ".index";
+        }
+
+    } // namespace detail
+
+    void checkpoint_wait(World& world) {
+        int failed = detail::CheckpointWriter::wait() ? 0 : 1;
+        world.gop.sum(failed);
+        if (failed) MADNESS_EXCEPTION("checkpoint_wait: checkpoint not written by some processes", failed);
+    }
+
+    bool checkpoint_exists(World& world, const std::string& name) {
+        int exists = 0;
+        if (world.rank() == 0) {
+            std::vector<unsigned char> index;
+            if (detail::CheckpointWriter::read(detail::checkpoint_index_name(name), index)) {
+                archive::VectorInputArchive ar(index);
+                long magic = 0l, id = 0l, ndim = 0l;
+                unsigned long ckid = 0;
+                std::vector<long> sizes;
+                ar & magic;
+                if (magic == detail::CHECKPOINT_MAGIC) {
+                    ar & id & ndim & ckid & sizes;
+                    exists = 1;
+                    for (std::size_t p=0; p<sizes.size() && exists; ++p) {
+                        std::ifstream in(detail::checkpoint_shard_name(name, p).c_str(),
+                                         std::ios::binary | std::ios::ate);
+                        exists = in && (in.tellg() == std::streamoff(sizes[p]));
+                    }
+                }
+            }
+        }
+        world.gop.broadcast(exists);
+        return exists;
+    }
+
+} // namespace madness
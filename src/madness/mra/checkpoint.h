@@ -0,0 +1,222 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_MRA_CHECKPOINT_H__INCLUDED
+#define MADNESS_MRA_CHECKPOINT_H__INCLUDED
+
+/*!
+	\file checkpoint.h
+	\brief Asynchronous, striped checkpoint and restart of vectors of Functions
+	\ingroup mra
+
+	save_function() in vmra.h funnels all coefficients through the I/O
+	nodes of a ParallelOutputArchive and blocks until they are on disk.
+	save_checkpoint() instead has every process serialize its own
+	coefficients into memory and then returns, while a background thread
+	writes them to a shard owned by that process, \c name.NNNNN.  Process
+	zero also writes the global index, \c name.index, holding the
+	parameters of each function and the size of every shard.
+
+	load_checkpoint() reads the shards round-robin and re-inserts the
+	nodes through the process map of the new functions, so a checkpoint
+	may be restarted on a different number of processes.
+
+	\code
+	save_checkpoint(orbitals, "orbitals");   // returns once in memory
+	// ... carry on computing ...
+	checkpoint_wait(world);                  // all shards on disk
+
+	load_checkpoint(world, orbitals, "orbitals");
+	\endcode
+*/
+
+#include <madness/mra/mra.h>
+#include <madness/world/vector_archive.h>
+#include <string>
+#include <vector>
+
+namespace madness {
+
+    namespace detail {
+
+        /// Writes files on a background thread, one per process
+        class CheckpointWriter {
+        public:
+            /// Queues data to be written to a file
+
+            /// The contents of \c data are taken by the writer, leaving it
+            /// empty.  The data is written to \c filename.tmp which is
+            /// then renamed so that a complete file replaces the old one.
+            static void submit(const std::string& filename, std::vector<unsigned char>& data);
+
+            /// Waits until all data queued by this process is written
+
+            /// Must not be called from a task.
+            /// \return False if any write failed since the last call.
+            static bool wait();
+
+            /// Reads a whole file into data
+            static bool read(const std::string& filename, std::vector<unsigned char>& data);
+        };
+
+        /// Returns the name of the shard written by process p
+        std::string checkpoint_shard_name(const std::string& name, ProcessID p);
+
+        /// Returns the name of the global index
+        std::string checkpoint_index_name(const std::string& name);
+
+        static const long CHECKPOINT_MAGIC = 7776769;
+    }
+
+    /// Waits until the checkpoints of all processes are written ... collective
+
+    /// Throws if any process failed to write its shard.
+    void checkpoint_wait(World& world);
+
+    /// Returns true if a complete checkpoint exists ... collective
+    bool checkpoint_exists(World& world, const std::string& name);
+
+    /// Saves a vector of functions, writing the files in the background ... collective
+
+    /// Returns once the coefficients have been copied into memory, so
+    /// the functions may then be freely modified.  A previous
+    /// checkpoint still being written by this process is waited for
+    /// first, so at most one copy is held in memory.
+    template <typename T, std::size_t NDIM>
+    void save_checkpoint(const std::vector< Function<T,NDIM> >& f, const std::string& name) {
+        PROFILE_BLOCK(Vsave_checkpoint);
+        MADNESS_ASSERT(f.size() > 0);
+        World& world = f.front().world();
+        for (std::size_t i=0; i<f.size(); ++i) f[i].verify();
+
+        if (!detail::CheckpointWriter::wait())
+            print("save_checkpoint: a previous checkpoint was not written by process", world.rank());
+        world.gop.fence();
+
+        // Identifies the shards belonging to this index
+        unsigned long id = 0;
+        if (world.rank() == 0) id = static_cast<unsigned long>(wall_time()*1e6);
+        world.gop.broadcast(id);
+
+        std::vector<unsigned char> shard;
+        {
+            archive::VectorOutputArchive ar(shard);
+            ar & id & long(f.size());
+            for (std::size_t i=0; i<f.size(); ++i) {
+                const typename FunctionImpl<T,NDIM>::dcT& coeffs = f[i].get_impl()->get_coeffs();
+                ar & coeffs.size();
+                for (auto it=coeffs.begin(); it!=coeffs.end(); ++it) {
+                    ar & it->first & it->second;
+                }
+            }
+        }
+
+        std::vector<long> sizes(world.size(), 0l);
+        sizes[world.rank()] = shard.size();
+        world.gop.sum(&sizes[0], sizes.size());
+
+        if (world.rank() == 0) {
+            std::vector<unsigned char> index;
+            archive::VectorOutputArchive ar(index);
+            ar & detail::CHECKPOINT_MAGIC & long(TensorTypeData<T>::id) & long(NDIM)
+               & id & sizes & long(f.size());
+            for (std::size_t i=0; i<f.size(); ++i) {
+                ar & f[i].k();
+                f[i].get_impl()->store_parameters(ar);
+            }
+            detail::CheckpointWriter::submit(detail::checkpoint_index_name(name), index);
+        }
+        detail::CheckpointWriter::submit(detail::checkpoint_shard_name(name, world.rank()), shard);
+    }
+
+    /// Loads a vector of functions saved by save_checkpoint() ... collective
+
+    /// The functions are distributed with the default process map,
+    /// whatever the number of processes that wrote the checkpoint.
+    template <typename T, std::size_t NDIM>
+    void load_checkpoint(World& world, std::vector< Function<T,NDIM> >& f, const std::string& name) {
+        PROFILE_BLOCK(Vload_checkpoint);
+        typedef FunctionImpl<T,NDIM> implT;
+
+        // Every process reads the small index
+        std::vector<unsigned char> index;
+        if (!detail::CheckpointWriter::read(detail::checkpoint_index_name(name), index))
+            MADNESS_EXCEPTION("load_checkpoint: cannot read index", world.rank());
+        archive::VectorInputArchive ar(index);
+        long magic = 0l, id = 0l, ndim = 0l, nfunc = 0l;
+        unsigned long ckid = 0;
+        std::vector<long> sizes;
+        ar & magic & id & ndim & ckid & sizes & nfunc;
+        MADNESS_ASSERT(magic == detail::CHECKPOINT_MAGIC);
+        MADNESS_ASSERT(id == TensorTypeData<T>::id);
+        MADNESS_ASSERT(ndim == NDIM);
+
+        f.resize(nfunc);
+        for (long i=0; i<nfunc; ++i) {
+            int k = 0;
+            ar & k;
+            f[i] = FunctionFactory<T,NDIM>(world).k(k).empty();
+            f[i].get_impl()->load_parameters(ar);
+        }
+
+        // Shards are shared round-robin and their nodes sent to the owners
+        for (std::size_t p=world.rank(); p<sizes.size(); p+=world.size()) {
+            std::vector<unsigned char> shard;
+            if (!detail::CheckpointWriter::read(detail::checkpoint_shard_name(name, p), shard))
+                MADNESS_EXCEPTION("load_checkpoint: cannot read shard", p);
+            if (long(shard.size()) != sizes[p])
+                MADNESS_EXCEPTION("load_checkpoint: shard is incomplete", p);
+
+            archive::VectorInputArchive sar(shard);
+            unsigned long shardid = 0;
+            long shardnfunc = 0;
+            sar & shardid & shardnfunc;
+            if (shardid != ckid || shardnfunc != nfunc)
+                MADNESS_EXCEPTION("load_checkpoint: shard is from another checkpoint", p);
+
+            for (long i=0; i<nfunc; ++i) {
+                typename implT::dcT& coeffs = f[i].get_impl()->get_coeffs();
+                std::size_t nnode = 0;
+                sar & nnode;
+                for (std::size_t j=0; j<nnode; ++j) {
+                    Key<NDIM> key;
+                    typename implT::nodeT node;
+                    sar & key & node;
+                    coeffs.replace(key, node);
+                }
+            }
+        }
+        world.gop.fence();
+    }
+
+}
+
+#endif // MADNESS_MRA_CHECKPOINT_H__INCLUDED
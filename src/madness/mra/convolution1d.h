@@ -37,11 +37,14 @@
 #include <limits.h>
 #include <madness/tensor/tensor.h>
 #include <madness/mra/simplecache.h>
+#include <madness/mra/convolutioncache.h>
 #include <madness/mra/adquad.h>
 #include <madness/mra/twoscale.h>
 #include <madness/tensor/aligned.h>
 #include <madness/tensor/tensor_lapack.h>
 #include <algorithm>
+#include <cstdio>
+#include <set>
 
 /// \file mra/convolution1d.h
 /// \brief Compuates most matrix elements over 1D operators (including Gaussians)
@@ -171,6 +174,10 @@ namespace madness {
         // norms for modified NS form
         double N_up, N_diff, N_F;               ///< the norms according to Beylkin 2008, Eq. (21) ff
 
+        /// ctor for data read from the on-disk cache
+        ConvolutionData1D() : Rnorm(0.0), Tnorm(0.0), Rnormf(0.0), Tnormf(0.0), NSnormf(0.0),
+                N_up(0.0), N_diff(0.0), N_F(0.0) {}
+
 
         /// ctor for NS form
         /// make the operator matrices r^n and \uparrow r^(n-1)
@@ -248,6 +255,74 @@ namespace madness {
         }
     };
 
+    namespace detail {
+
+        template <typename T>
+        void cache_put(std::vector<unsigned char>& buf, const Tensor<T>& t) {
+            const int64_t ndim = t.ndim();
+            cache_put(buf, &ndim, sizeof(ndim));
+            for (long d=0; d<t.ndim(); ++d) {
+                const int64_t dim = t.dim(d);
+                cache_put(buf, &dim, sizeof(dim));
+            }
+            if (t.size()) {
+                const Tensor<T> c = t.iscontiguous() ? t : copy(t);
+                cache_put(buf, c.ptr(), c.size()*sizeof(T));
+            }
+        }
+
+        template <typename T>
+        const unsigned char* cache_get(const unsigned char* p, Tensor<T>& t) {
+            int64_t ndim;
+            p = cache_get(p, &ndim, sizeof(ndim));
+            if (ndim < 0) {
+                t = Tensor<T>();
+                return p;
+            }
+            std::vector<long> dims(ndim);
+            for (int64_t d=0; d<ndim; ++d) {
+                int64_t dim;
+                p = cache_get(p, &dim, sizeof(dim));
+                dims[d] = dim;
+            }
+            t = Tensor<T>(dims, false);
+            if (t.size()) p = cache_get(p, t.ptr(), t.size()*sizeof(T));
+            return p;
+        }
+
+        template <typename Q>
+        void cache_put(std::vector<unsigned char>& buf, const ConvolutionData1D<Q>& c) {
+            cache_put(buf, c.R);
+            cache_put(buf, c.T);
+            cache_put(buf, c.RU);
+            cache_put(buf, c.RVT);
+            cache_put(buf, c.TU);
+            cache_put(buf, c.TVT);
+            cache_put(buf, c.Rs);
+            cache_put(buf, c.Ts);
+            const double norms[8] = {c.Rnorm, c.Tnorm, c.Rnormf, c.Tnormf, c.NSnormf, c.N_up, c.N_diff, c.N_F};
+            cache_put(buf, norms, sizeof(norms));
+        }
+
+        template <typename Q>
+        const unsigned char* cache_get(const unsigned char* p, ConvolutionData1D<Q>& c) {
+            p = cache_get(p, c.R);
+            p = cache_get(p, c.T);
+            p = cache_get(p, c.RU);
+            p = cache_get(p, c.RVT);
+            p = cache_get(p, c.TU);
+            p = cache_get(p, c.TVT);
+            p = cache_get(p, c.Rs);
+            p = cache_get(p, c.Ts);
+            double norms[8];
+            p = cache_get(p, norms, sizeof(norms));
+            c.Rnorm = norms[0]; c.Tnorm = norms[1]; c.Rnormf = norms[2]; c.Tnormf = norms[3];
+            c.NSnormf = norms[4]; c.N_up = norms[5]; c.N_diff = norms[6]; c.N_F = norms[7];
+            return p;
+        }
+
+    } // namespace detail
+
     /// Provides the common functionality/interface of all 1D convolutions
 
     /// interface for 1 term and for 1 dimension;
@@ -267,13 +342,102 @@ namespace madness {
         Tensor<double> hgT2k;
         double arg;
 
-        mutable SimpleCache<Tensor<Q>, 1> rnlp_cache;
-        mutable SimpleCache<Tensor<Q>, 1> rnlij_cache;
-        mutable SimpleCache<ConvolutionData1D<Q>, 1> ns_cache;
+        mutable DenseCache<Tensor<Q>, 1> rnlp_cache;
+        mutable DenseCache<Tensor<Q>, 1> rnlij_cache;
+        mutable DenseCache<ConvolutionData1D<Q>, 1> ns_cache;
         mutable SimpleCache<ConvolutionData1D<Q>, 2> mod_ns_cache;
 
+    private:
+        std::string disk_name;      ///< Name in the on-disk cache, empty if not cached
+        std::shared_ptr<const detail::ConvolutionCacheFile> disk;  ///< Blocks from the on-disk cache
+
+        /// If the block is in the on-disk cache copy it to value and return true
+        template <typename T>
+        bool disk_find(int kind, Level n, Translation l0, Translation l1, T& value) const {
+            if (!disk) return false;
+            std::size_t size;
+            const unsigned char* p = disk->find(kind, n, l0, l1, size);
+            if (!p) return false;
+            detail::cache_get(p, value);
+            return true;
+        }
+
+        /// Encodes the blocks of a cache for the on-disk cache
+        template <typename cacheT>
+        void disk_add(int kind, const cacheT& cache,
+                      std::vector<detail::ConvolutionCacheFile::Record>& records,
+                      std::vector< std::vector<unsigned char> >& data) const {
+            cache.for_each([&](const auto& key, const auto& value) {
+                const std::size_t D = key.translation().size();
+                detail::ConvolutionCacheFile::Record r;
+                r.kind = kind;
+                r.n = key.level();
+                r.l[0] = key.translation()[0];
+                r.l[1] = (D > 1) ? key.translation()[D-1] : 0;
+                data.push_back(std::vector<unsigned char>());
+                detail::cache_put(data.back(), value);
+                r.nbyte = data.back().size();
+                records.push_back(r);
+            });
+        }
+
+    protected:
+        /// Attaches the blocks of the operator in the on-disk cache
+
+        /// Call at the end of the constructor of a derived class
+        /// whose blocks depend only on the name
+        void attach_disk_cache(const std::string& name) {
+            if (!ConvolutionDiskCache::enabled()) return;
+            disk_name = name;
+            disk.reset(new detail::ConvolutionCacheFile(name, TensorTypeData<Q>::id, k,
+                                                        ConvolutionDiskCache::get_mmap()));
+        }
+
+    public:
         virtual ~Convolution1D() {};
 
+        /// Adds the blocks computed by this process to the on-disk cache
+
+        /// Blocks already in the file are kept and the file is
+        /// rewritten only if this process has any new blocks.
+        void save_disk_cache() const {
+            if (disk_name.empty() || !ConvolutionDiskCache::enabled()) return;
+            typedef detail::ConvolutionCacheFile fileT;
+
+            std::vector<fileT::Record> records;
+            std::vector< std::vector<unsigned char> > mine;
+            disk_add(fileT::RNLP, rnlp_cache, records, mine);
+            disk_add(fileT::NS, ns_cache, records, mine);
+            disk_add(fileT::MOD_NS, mod_ns_cache, records, mine);
+
+            // Merge with the file as it is now (another job may have added to it)
+            const fileT current(disk_name, TensorTypeData<Q>::id, k, false);
+            std::vector<const unsigned char*> data;
+            std::size_t nnew = 0;
+            for (std::size_t i=0; i<records.size(); ++i) {
+                std::size_t size;
+                const fileT::Record& r = records[i];
+                if (!current.find(r.kind, r.n, r.l[0], r.l[1], size)) ++nnew;
+                data.push_back(&mine[i][0]);
+            }
+            if (nnew == 0) return;
+
+            std::set< std::vector<int64_t> > have;
+            for (std::size_t i=0; i<records.size(); ++i) {
+                const fileT::Record& r = records[i];
+                have.insert(std::vector<int64_t>{r.kind, r.n, r.l[0], r.l[1]});
+            }
+            std::vector<fileT::Record> merged(records);
+            for (std::size_t i=0; i<current.records().size(); ++i) {
+                const fileT::Record& r = current.records()[i];
+                if (!have.count(std::vector<int64_t>{r.kind, r.n, r.l[0], r.l[1]})) {
+                    merged.push_back(r);
+                    data.push_back(current.data(r));
+                }
+            }
+            fileT::write(disk_name, TensorTypeData<Q>::id, k, merged, data);
+        }
+
         Convolution1D(int k, int npt, int maxR, double arg = 0.0)
                 : k(k)
                 , npt(npt)
@@ -368,6 +532,12 @@ namespace madness {
             const ConvolutionData1D<Q>* p = mod_ns_cache.getptr(cache_key);
             if (p) return p;
 
+            ConvolutionData1D<Q> data;
+            if (disk_find(detail::ConvolutionCacheFile::MOD_NS, n, lx, s_off, data)) {
+                mod_ns_cache.set(cache_key,data);
+                return mod_ns_cache.getptr(cache_key);
+            }
+
             // for paranoid me
             MADNESS_ASSERT(sx>=0 and tx>=0);
 
@@ -425,6 +595,12 @@ namespace madness {
             const ConvolutionData1D<Q>* p = ns_cache.getptr(n,lx);
             if (p) return p;
 
+            ConvolutionData1D<Q> data;
+            if (disk_find(detail::ConvolutionCacheFile::NS, n, lx, 0, data)) {
+                ns_cache.set(n,lx,data);
+                return ns_cache.getptr(n,lx);
+            }
+
             // PROFILE_MEMBER_FUNC(Convolution1D); // Too fine grain for routine profiling
 
             Tensor<Q> R, T;
@@ -502,7 +678,10 @@ namespace madness {
             long twok = 2*k;
             Tensor<Q> r;
 
-            if (get_issmall(n, lx)) {
+            if (disk_find(detail::ConvolutionCacheFile::RNLP, n, lx, 0, r)) {
+                ;
+            }
+            else if (get_issmall(n, lx)) {
                 r = Tensor<Q>(twok);
             }
             else if (n < natural_level()) {
@@ -703,6 +882,7 @@ namespace madness {
             , m(m)
         {
             MADNESS_ASSERT(m>=0 && m<=2);
+            this->attach_disk_cache(cache_name(k, coeff, expnt, m, periodic, arg));
             // std::cout << "GC expnt=" << expnt << " coeff="  << coeff << " natlev=" << natlev << " maxR=" << maxR(periodic,expnt) << std::endl;
             // for (Level n=0; n<5; n++) {
             //     for (Translation l=0; l<(1<<n); l++) {
@@ -714,6 +894,16 @@ namespace madness {
 
         virtual ~GaussianConvolution1D() {}
 
+        /// Returns the name of the operator in the on-disk cache (exact hex values of the parameters)
+        static std::string cache_name(int k, Q coeff, double expnt, int m, bool periodic, double arg) {
+            const std::complex<double> c(coeff);
+            char buf[256];
+            snprintf(buf, sizeof(buf), "gauss-%s-k%d-m%d-p%d-c%a,%a-e%a-a%a",
+                     (TensorTypeData<Q>::iscomplex ? "z" : "d"), k, m, int(periodic),
+                     c.real(), c.imag(), expnt, arg);
+            return std::string(buf);
+        }
+
         virtual Level natural_level() const {
             return natlev;
         }
@@ -870,6 +1060,13 @@ namespace madness {
             }
             return it->second;
         }
+
+        /// Adds the blocks computed by this process for all operators to the on-disk cache
+        static void save() {
+            for (iterator it=map.begin(); it!=map.end(); ++it) {
+                it->second->save_disk_cache();
+            }
+        }
     };
 }
 
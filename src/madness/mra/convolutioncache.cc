@@ -0,0 +1,167 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file mra/convolutioncache.cc
+/// \brief Reading and writing the files of the on-disk cache of 1D convolutions
+
+#include <madness/mra/convolutioncache.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace madness {
+
+    static std::string getenv_string(const char* var) {
+        const char* value = getenv(var);
+        return value ? std::string(value) : std::string();
+    }
+
+    std::string ConvolutionDiskCache::dir = getenv_string("MAD_OPERATOR_CACHE");
+    bool ConvolutionDiskCache::use_mmap = getenv("MAD_OPERATOR_CACHE_MMAP") != 0;
+
+    namespace detail {
+
+        /// Leading part of a cache file
+        struct ConvolutionCacheHeader {
+            char magic[8];          ///< "MADOPC"
+            int64_t version;
+            int64_t type;           ///< TensorTypeData<Q>::id
+            int64_t k;
+            int64_t nrecord;
+            char name[256];         ///< Name of the operator
+        };
+
+        static void make_header(ConvolutionCacheHeader& h, const std::string& name,
+                                int64_t type, int64_t k, int64_t nrecord) {
+            memset(&h, 0, sizeof(h));
+            strncpy(h.magic, "MADOPC", sizeof(h.magic));
+            h.version = ConvolutionDiskCache::version;
+            h.type = type;
+            h.k = k;
+            h.nrecord = nrecord;
+            strncpy(h.name, name.c_str(), sizeof(h.name)-1);
+        }
+
+        ConvolutionCacheFile::ConvolutionCacheFile(const std::string& name, int64_t type, int64_t k, bool mmap)
+            : p(0)
+        {
+            const std::string filename = ConvolutionDiskCache::filename(name);
+            struct stat st;
+            if (stat(filename.c_str(), &st) != 0) return;
+
+            std::size_t size = st.st_size;
+            if (mmap) {
+                mapped.reset(new MappedFile(filename));
+                p = mapped->data();
+                size = mapped->size();
+            }
+            else {
+                std::ifstream f(filename.c_str(), std::ios::binary);
+                buffer.resize(size);
+                if (size && !f.read(reinterpret_cast<char*>(&buffer[0]), size)) return;
+                p = size ? &buffer[0] : 0;
+            }
+
+            // Anything not written by this version for this operator is ignored
+            ConvolutionCacheHeader h, expected;
+            make_header(expected, name, type, k, 0);
+            if (size < sizeof(h)) return;
+            memcpy(&h, p, sizeof(h));
+            if (memcmp(h.magic, expected.magic, sizeof(h.magic)) || h.version != expected.version ||
+                h.type != type || h.k != k || memcmp(h.name, expected.name, sizeof(h.name))) return;
+            if (h.nrecord < 0 || size < sizeof(h) + h.nrecord*sizeof(Record)) return;
+
+            rec.resize(h.nrecord);
+            if (h.nrecord) memcpy(&rec[0], p + sizeof(h), h.nrecord*sizeof(Record));
+            for (std::size_t i=0; i<rec.size(); ++i) {
+                const Record& r = rec[i];
+                if (r.offset < 0 || r.nbyte < 0 || std::size_t(r.offset + r.nbyte) > size) {
+                    rec.clear();
+                    index.clear();
+                    return;
+                }
+                index[keyT(std::make_pair(r.kind,r.n),std::make_pair(r.l[0],r.l[1]))] = i;
+            }
+        }
+
+        const unsigned char* ConvolutionCacheFile::find(int kind, int n, int64_t l0, int64_t l1, std::size_t& size) const {
+            std::map<keyT,std::size_t>::const_iterator it =
+                index.find(keyT(std::make_pair(kind,n),std::make_pair(l0,l1)));
+            if (it == index.end()) return 0;
+            const Record& r = rec[it->second];
+            size = r.nbyte;
+            return p + r.offset;
+        }
+
+        void ConvolutionCacheFile::write(const std::string& name, int64_t type, int64_t k,
+                                         const std::vector<Record>& records,
+                                         const std::vector<const unsigned char*>& data) {
+            const std::string& dir = ConvolutionDiskCache::get_directory();
+            mkdir(dir.c_str(), 0777); // Fails harmlessly if it exists
+
+            ConvolutionCacheHeader h;
+            make_header(h, name, type, k, records.size());
+            std::vector<Record> index(records);
+            int64_t offset = sizeof(h) + records.size()*sizeof(Record);
+            for (std::size_t i=0; i<index.size(); ++i) {
+                index[i].offset = offset;
+                offset += index[i].nbyte;
+            }
+
+            // Write a private file and rename it so readers never see a partial file
+            char host[256] = "";
+            gethostname(host, sizeof(host)-1);
+            std::ostringstream tmp;
+            tmp << ConvolutionDiskCache::filename(name) << "." << host << "." << getpid() << ".tmp";
+            {
+                std::ofstream f(tmp.str().c_str(), std::ios::binary);
+                f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+                if (index.size())
+                    f.write(reinterpret_cast<const char*>(&index[0]), index.size()*sizeof(Record));
+                for (std::size_t i=0; i<index.size(); ++i)
+                    f.write(reinterpret_cast<const char*>(data[i]), index[i].nbyte);
+                if (!f) {
+                    f.close();
+                    remove(tmp.str().c_str());
+                    return;
+                }
+            }
+            if (rename(tmp.str().c_str(), ConvolutionDiskCache::filename(name).c_str()) != 0)
+                remove(tmp.str().c_str());
+        }
+
+    } // namespace detail
+} // namespace madness
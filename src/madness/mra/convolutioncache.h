@@ -0,0 +1,154 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_MRA_CONVOLUTIONCACHE_H__INCLUDED
+#define MADNESS_MRA_CONVOLUTIONCACHE_H__INCLUDED
+
+/*!
+	\file convolutioncache.h
+	\brief Persistent on-disk cache of the matrix elements of 1D convolutions
+	\ingroup mra
+
+	Each Gaussian 1D convolution keeps its blocks (rnlp, and the
+	nonstandard and modified nonstandard forms with their SVDs) in one
+	file of the cache directory, named by the wavelet order, the
+	coefficient, the exponent, the derivative order and the
+	periodicity.  An operator attaches its file when it is constructed
+	and takes blocks from it instead of computing them.
+	GaussianConvolution1DCache::save() adds the blocks computed since
+	to the files, so later jobs with the same operators start warm.
+
+	The cache is off unless a directory is given with
+	ConvolutionDiskCache::set_directory() or the environment variable
+	\c MAD_OPERATOR_CACHE.  Files are read into memory or, with
+	ConvolutionDiskCache::set_mmap(true) or \c MAD_OPERATOR_CACHE_MMAP,
+	mapped so that only the blocks used are read.  A file written by a
+	different version of the format is ignored and replaced on the
+	next save.  Files are replaced atomically, so concurrent jobs (or
+	processes) may share a directory; a block computed by two of them
+	is kept once and a block may be lost, never corrupted.
+*/
+
+#include <madness/mra/mappedfile.h>
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace madness {
+
+    /// Settings of the on-disk cache of 1D convolution matrix elements
+    class ConvolutionDiskCache {
+        static std::string dir;         ///< Directory of the cache files, empty if off
+        static bool use_mmap;           ///< If true map the files instead of reading them
+
+    public:
+        static const int64_t version = 1;   ///< Version of the file format
+
+        /// Sets the directory of the cache files (empty to turn the cache off)
+        static void set_directory(const std::string& directory) {dir = directory;}
+
+        static const std::string& get_directory() {return dir;}
+
+        /// If true the cache files are mapped into memory instead of read
+        static void set_mmap(bool value) {use_mmap = value;}
+
+        static bool get_mmap() {return use_mmap;}
+
+        static bool enabled() {return !dir.empty();}
+
+        /// Returns the name of the file of the operator with the given name
+        static std::string filename(const std::string& name) {return dir + "/" + name + ".opcache";}
+    };
+
+    namespace detail {
+
+        /// A cache file of one operator with the index of its blocks
+        class ConvolutionCacheFile {
+        public:
+            enum Kind {RNLP=0, NS=1, MOD_NS=2};
+
+            /// One entry of the index
+            struct Record {
+                int32_t kind;
+                int32_t n;
+                int64_t l[2];
+                int64_t offset;     ///< Offset of the data from the start of the file
+                int64_t nbyte;
+            };
+
+            /// Opens the cache file of an operator (empty if missing or not valid for the operator)
+            ConvolutionCacheFile(const std::string& name, int64_t type, int64_t k, bool mmap);
+
+            bool empty() const {return index.empty();}
+
+            /// Returns the data of a block and its size or a null pointer if not in the file
+            const unsigned char* find(int kind, int n, int64_t l0, int64_t l1, std::size_t& size) const;
+
+            /// Returns the index in file order
+            const std::vector<Record>& records() const {return rec;}
+
+            /// Returns the data of a record
+            const unsigned char* data(const Record& r) const {return p + r.offset;}
+
+            /// Replaces the cache file of an operator with the given blocks
+            static void write(const std::string& name, int64_t type, int64_t k,
+                              const std::vector<Record>& records,
+                              const std::vector<const unsigned char*>& data);
+
+        private:
+            typedef std::pair<std::pair<int,int>, std::pair<int64_t,int64_t> > keyT;
+
+            std::shared_ptr<MappedFile> mapped;
+            std::vector<unsigned char> buffer;
+            const unsigned char* p;
+            std::vector<Record> rec;
+            std::map<keyT,std::size_t> index;   ///< Position of each block in rec
+        };
+
+        /// Appends raw bytes to a block being encoded
+        inline void cache_put(std::vector<unsigned char>& buf, const void* v, std::size_t n) {
+            const unsigned char* c = static_cast<const unsigned char*>(v);
+            buf.insert(buf.end(), c, c+n);
+        }
+
+        /// Reads raw bytes of a block being decoded
+        inline const unsigned char* cache_get(const unsigned char* p, void* v, std::size_t n) {
+            std::copy(p, p+n, static_cast<unsigned char*>(v));
+            return p+n;
+        }
+
+    } // namespace detail
+} // namespace madness
+
+#endif // MADNESS_MRA_CONVOLUTIONCACHE_H__INCLUDED
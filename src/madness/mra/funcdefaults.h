@@ -185,6 +185,12 @@ namespace madness {
         static bool truncate_on_project; ///< If true initial projection inserts at n-1 not n
         static bool apply_randomize;   ///< If true use randomization for load balancing in apply integral operator
         static bool project_randomize; ///< If true use randomization for load balancing in project/refine
+        static bool apply_batched;     ///< If true apply integral operators to all displacements of a box in one batch
+        static bool inner_tiled;       ///< If true matrix_inner uses one matrix multiply per box instead of a dot product per pair
+        static bool fused_traversal;   ///< If true vector compress, reconstruct, truncate and norm_tree walk all trees in one traversal
+        static double pack_tol;        ///< Error of packed coefficients relative to the truncation threshold of their node
+        static bool pack_scaled;       ///< If true packing may use block-scaled integers, otherwise only single precision
+        static bool apply_mixed_precision; ///< If true integral operators apply terms that allow it in single precision
         static BoundaryConditions<NDIM> bc; ///< Default boundary conditions
         static Tensor<double> cell ;   ///< cell[NDIM][2] Simulation cell, cell(0,0)=xlo, cell(0,1)=xhi, ...
         static Tensor<double> cell_width;///< Width of simulation cell in each dimension
@@ -346,6 +352,66 @@ namespace madness {
             apply_randomize=value;
         }
 
+        /// Gets the batched application of integral operators flag
+        static bool get_apply_batched() {
+            return apply_batched;
+        }
+
+        /// Sets the batched application of integral operators flag
+        static void set_apply_batched(bool value) {
+            apply_batched=value;
+        }
+
+        /// Gets the tiled matrix inner product flag
+        static bool get_inner_tiled() {
+            return inner_tiled;
+        }
+
+        /// Sets the tiled matrix inner product flag
+        static void set_inner_tiled(bool value) {
+            inner_tiled=value;
+        }
+
+        /// Gets the fused traversal of vectors of functions flag
+        static bool get_fused_traversal() {
+            return fused_traversal;
+        }
+
+        /// Sets the fused traversal of vectors of functions flag
+        static void set_fused_traversal(bool value) {
+            fused_traversal=value;
+        }
+
+        /// Gets the error of packed coefficients relative to the truncation threshold
+        static double get_pack_tol() {
+            return pack_tol;
+        }
+
+        /// Sets the error of packed coefficients relative to the truncation threshold
+        static void set_pack_tol(double value) {
+            pack_tol=value;
+        }
+
+        /// Gets the block-scaled integer packing flag
+        static bool get_pack_scaled() {
+            return pack_scaled;
+        }
+
+        /// Sets the block-scaled integer packing flag
+        static void set_pack_scaled(bool value) {
+            pack_scaled=value;
+        }
+
+        /// Gets the mixed precision apply flag
+        static bool get_apply_mixed_precision() {
+            return apply_mixed_precision;
+        }
+
+        /// Sets the mixed precision apply flag
+        static void set_apply_mixed_precision(bool value) {
+            apply_mixed_precision=value;
+        }
+
 
         /// Gets the random load balancing for projection flag
         static bool get_project_randomize() {
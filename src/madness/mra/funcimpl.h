@@ -35,7 +35,9 @@
 /// \file funcimpl.h
 /// \brief Provides FunctionCommonData, FunctionImpl and FunctionFactory
 
+#include <atomic>
 #include <iostream>
+#include <memory>
 #include <type_traits>
 #include <madness/world/MADworld.h>
 #include <madness/world/print.h>
@@ -48,6 +50,8 @@
 #include <madness/mra/key.h>
 #include <madness/mra/funcdefaults.h>
 #include <madness/mra/function_factory.h>
+#include <madness/mra/lbdeux.h>
+#include <madness/mra/packedtensor.h>
 
 #include "leafop.h"
 
@@ -89,6 +93,10 @@ namespace madness {
         SimplePmap(World& world) : nproc(world.nproc()), me(world.rank())
         { }
 
+        /// Maps onto nproc processes (e.g., to model other process counts)
+        SimplePmap(int nproc) : nproc(nproc), me(0)
+        { }
+
         ProcessID owner(const keyT& key) const {
             if (key.level() == 0)
                 return 0;
@@ -107,6 +115,9 @@ namespace madness {
 
         LevelPmap(World& world) : nproc(world.nproc()) {}
 
+        /// Maps onto nproc processes (e.g., to model other process counts)
+        LevelPmap(int nproc) : nproc(nproc) {}
+
         /// Find the owner of a given key
         ProcessID owner(const keyT& key) const {
             Level n = key.level();
@@ -130,16 +141,44 @@ namespace madness {
         // be no need to set as volatile since the container internally
         // stores the entire entry as volatile
 
+        enum {PLAIN, PACKED, WIDENING}; ///< States of the coefficients
+
         coeffT _coeffs; ///< The coefficients, if any
         double _norm_tree; ///< After norm_tree will contain norm of coefficients summed up tree
         bool _has_children; ///< True if there are children
+        mutable std::atomic<int> _state; ///< PACKED if the coefficients are in _packed
+        std::shared_ptr<const detail::PackedTensor<T> > _packed; ///< Reduced-precision coefficients, if packed
         coeffT buffer; ///< The coefficients, if any
 
+        /// Replaces the packed coefficients by full precision ones
+
+        /// The first thread to get here unpacks, others wait for it
+        void widen() const {
+            int expected = PACKED;
+            if (_state.compare_exchange_strong(expected, WIDENING, std::memory_order_acquire)) {
+                FunctionNode<T,NDIM>* self = const_cast<FunctionNode<T,NDIM>*>(this);
+                self->_coeffs = coeffT(_packed->unpack(), -1.0, TT_FULL);
+                self->_packed.reset();
+                _state.store(PLAIN, std::memory_order_release);
+            }
+            else {
+                while (_state.load(std::memory_order_acquire) != PLAIN) cpu_relax();
+            }
+        }
+
+        /// Drops the packed coefficients before they are overwritten
+        void discard_packed() {
+            if (_state.load(std::memory_order_acquire) != PLAIN) {
+                _packed.reset();
+                _state.store(PLAIN, std::memory_order_release);
+            }
+        }
+
     public:
         typedef WorldContainer<Key<NDIM> , FunctionNode<T, NDIM> > dcT; ///< Type of container holding the nodes
         /// Default constructor makes node without coeff or children
         FunctionNode() :
-            _coeffs(), _norm_tree(1e300), _has_children(false) {
+            _coeffs(), _norm_tree(1e300), _has_children(false), _state(PLAIN) {
         }
 
         /// Constructor from given coefficients with optional children
@@ -149,22 +188,31 @@ namespace madness {
         /// take ownership.
         explicit
         FunctionNode(const coeffT& coeff, bool has_children = false) :
-            _coeffs(coeff), _norm_tree(1e300), _has_children(has_children) {
+            _coeffs(coeff), _norm_tree(1e300), _has_children(has_children), _state(PLAIN) {
         }
 
         explicit
         FunctionNode(const coeffT& coeff, double norm_tree, bool has_children) :
-            _coeffs(coeff), _norm_tree(norm_tree), _has_children(has_children) {
+            _coeffs(coeff), _norm_tree(norm_tree), _has_children(has_children), _state(PLAIN) {
         }
 
-        FunctionNode(const FunctionNode<T, NDIM>& other) {
+        FunctionNode(const FunctionNode<T, NDIM>& other) : _state(PLAIN) {
             *this = other;
         }
 
+        /// Deep copy of the coefficients ... packed coefficients are shared since they are not modified
         FunctionNode<T, NDIM>&
         operator=(const FunctionNode<T, NDIM>& other) {
             if (this != &other) {
-                coeff() = copy(other.coeff());
+                if (other.is_packed()) {
+                    _coeffs = coeffT();
+                    _packed = other._packed;
+                    _state.store(PACKED, std::memory_order_release);
+                }
+                else {
+                    discard_packed();
+                    coeff() = copy(other.coeff());
+                }
                 _norm_tree = other._norm_tree;
                 _has_children = other._has_children;
             }
@@ -184,7 +232,35 @@ namespace madness {
         /// Returns true if there are coefficients in this node
         bool
         has_coeff() const {
-            return _coeffs.has_data();
+            return is_packed() || _coeffs.has_data();
+        }
+
+        /// Returns true if the coefficients are held in reduced precision
+        bool
+        is_packed() const {
+            return _state.load(std::memory_order_acquire) != PLAIN;
+        }
+
+        /// Replaces full-rank coefficients by a reduced-precision copy with error at most tol
+
+        /// Nothing changes if no packed format is accurate enough or
+        /// if it would save less than a quarter of the memory (e.g. for
+        /// the small nodes of 1D functions).  Not thread safe against
+        /// other access to this node.
+        void pack(double tol, bool scaled) {
+            if (is_packed() || !_coeffs.has_data() || _coeffs.tensor_type() != TT_FULL) return;
+            std::shared_ptr<detail::PackedTensor<T> > p(
+                new detail::PackedTensor<T>(_coeffs.full_tensor(), tol, scaled));
+            if (p->get_format() == detail::PackedTensor<T>::FULL) return;
+            if (4*p->real_size() > 3*_coeffs.size()*sizeof(T)) return;
+            _packed = p;
+            _coeffs = coeffT();
+            _state.store(PACKED, std::memory_order_release);
+        }
+
+        /// Widens packed coefficients to full precision
+        void unpack() {
+            if (is_packed()) widen();
         }
 
 
@@ -209,8 +285,10 @@ namespace madness {
         /// Returns a non-const reference to the tensor containing the coeffs
 
         /// Returns an empty tensor if there are no coefficients.
+        /// Packed coefficients are widened first.
         coeffT&
         coeff() {
+            if (_state.load(std::memory_order_acquire) != PLAIN) widen();
             MADNESS_ASSERT(_coeffs.ndim() == -1 || (_coeffs.dim(0) <= 2
                                                     * MAXK && _coeffs.dim(0) >= 0));
             return const_cast<coeffT&>(_coeffs);
@@ -219,21 +297,33 @@ namespace madness {
         /// Returns a const reference to the tensor containing the coeffs
 
         /// Returns an empty tensor if there are no coefficeints.
+        /// Packed coefficients are widened first.
         const coeffT&
         coeff() const {
+            if (_state.load(std::memory_order_acquire) != PLAIN) widen();
             return const_cast<const coeffT&>(_coeffs);
         }
 
         /// Returns the number of coefficients in this node
         size_t size() const {
-            return _coeffs.size();
+            return is_packed() ? _packed->size() : _coeffs.size();
+        }
+
+        /// Returns the memory used by the coefficients in this node in the units of coeffT::real_size()
+        size_t real_size() const {
+#if HAVE_GENTENSOR
+            if (is_packed()) return _packed->real_size();
+#else
+            if (is_packed()) return (_packed->real_size()+sizeof(T)-1)/sizeof(T);
+#endif
+            return _coeffs.has_data() ? _coeffs.real_size() : 0;
         }
 
     public:
 
         /// reduces the rank of the coefficients (if applicable)
         void reduceRank(const double& eps) {
-            _coeffs.reduce_rank(eps);
+            coeff().reduce_rank(eps);
         }
 
         /// Sets \c has_children attribute to value of \c flag.
@@ -269,6 +359,7 @@ namespace madness {
 
         /// Takes a \em shallow copy of the coeff --- same as \c this->coeff()=coeff
         void set_coeff(const coeffT& coeffs) {
+            discard_packed();
             coeff() = coeffs;
             if ((_coeffs.has_data()) and ((_coeffs.dim(0) < 0) || (_coeffs.dim(0)>2*MAXK))) {
                 print("set_coeff: may have a problem");
@@ -279,13 +370,14 @@ namespace madness {
 
         /// Clears the coefficients (has_coeff() will subsequently return false)
         void clear_coeff() {
+            discard_packed();
             coeff()=coeffT();
         }
 
         /// Scale the coefficients of this node
         template <typename Q>
         void scale(Q a) {
-            _coeffs.scale(a);
+            coeff().scale(a);
         }
 
         /// Sets the value of norm_tree
@@ -401,12 +493,40 @@ namespace madness {
         }
 
         T trace_conj(const FunctionNode<T,NDIM>& rhs) const {
-            return this->_coeffs.trace_conj((rhs._coeffs));
+            return this->coeff().trace_conj((rhs.coeff()));
         }
 
+        /// Packed coefficients stay packed in archives
+
+        /// They are flagged in the second bit of the has_children
+        /// byte, so archives of unpacked nodes keep their old format.
         template <typename Archive>
         void serialize(Archive& ar) {
-            ar & coeff() & _has_children & _norm_tree;
+            if (Archive::is_output_archive) {
+                const bool packed = is_packed();
+                unsigned char flags = (_has_children ? 1 : 0) | (packed ? 2 : 0);
+                if (packed) {
+                    coeffT empty;
+                    ar & empty & flags & _norm_tree & *_packed;
+                }
+                else {
+                    ar & _coeffs & flags & _norm_tree;
+                }
+            }
+            else {
+                unsigned char flags = 0;
+                ar & _coeffs & flags & _norm_tree;
+                _has_children = (flags & 1);
+                if (flags & 2) {
+                    std::shared_ptr<detail::PackedTensor<T> > p(new detail::PackedTensor<T>);
+                    ar & *p;
+                    _packed = p;
+                    _state.store(PACKED, std::memory_order_release);
+                }
+                else {
+                    discard_packed();
+                }
+            }
         }
 
     };
@@ -879,6 +999,8 @@ namespace madness {
 
         dcT coeffs; ///< The coefficients
 
+        ConcurrentHashMap<keyT,tensorT> level_sums; ///< Sum coefficients exchanged by compress_by_level and reconstruct_by_level
+
         // Disable the default copy constructor
         FunctionImpl(const FunctionImpl<T,NDIM>& p);
 
@@ -1090,6 +1212,24 @@ namespace madness {
         // @param[in] ar   the archive where the function impl is stored
         template <typename Archive>
         void load(Archive& ar) {
+            load_parameters(ar);
+            ar & coeffs;
+            world.gop.fence();
+        }
+
+        // saves a function impl to persistence
+        // @param[in] ar   the archive where the function impl is to be stored
+        template <typename Archive>
+        void store(Archive& ar) {
+            store_parameters(ar);
+            ar & coeffs;
+            world.gop.fence();
+        }
+
+        // loads the parameters but not the coefficients of a function impl
+        // @param[in] ar   the archive where the parameters are stored
+        template <typename Archive>
+        void load_parameters(Archive& ar) {
             // WE RELY ON K BEING STORED FIRST
             int kk = 0;
             ar & kk;
@@ -1099,23 +1239,17 @@ namespace madness {
             // note that functor should not be (re)stored
             ar & thresh & initial_level & max_refine_level & truncate_mode
                 & autorefine & truncate_on_project & nonstandard & compressed ; //& bc;
-
-            ar & coeffs;
-            world.gop.fence();
         }
 
-        // saves a function impl to persistence
-        // @param[in] ar   the archive where the function impl is to be stored
+        // saves the parameters but not the coefficients of a function impl
+        // @param[in] ar   the archive where the parameters are to be stored
         template <typename Archive>
-        void store(Archive& ar) {
+        void store_parameters(Archive& ar) const {
             // WE RELY ON K BEING STORED FIRST
 
             // note that functor should not be (re)stored
             ar & k & thresh & initial_level & max_refine_level & truncate_mode
                 & autorefine & truncate_on_project & nonstandard & compressed ; //& bc;
-
-            ar & coeffs;
-            world.gop.fence();
         }
 
         /// Returns true if the function is compressed.
@@ -2302,6 +2436,36 @@ namespace madness {
             template <typename Archive> void serialize(const Archive& ar) {}
         };
 
+        /// Packs the coefficients of a node with error a fraction of its truncation threshold
+        struct do_pack {
+            typedef Range<typename dcT::iterator> rangeT;
+
+            const implT* impl;
+            double fac;
+            bool scaled;
+
+            do_pack() {}
+            do_pack(const implT* impl, double fac, bool scaled) : impl(impl), fac(fac), scaled(scaled) {}
+
+            bool operator()(typename rangeT::iterator& it) const {
+                const keyT& key = it->first;
+                it->second.pack(fac*impl->truncate_tol(impl->get_thresh(), key), scaled);
+                return true;
+            }
+            template <typename Archive> void serialize(const Archive& ar) {}
+        };
+
+        /// Widens packed coefficients of a node
+        struct do_unpack {
+            typedef Range<typename dcT::iterator> rangeT;
+
+            bool operator()(typename rangeT::iterator& it) const {
+                it->second.unpack();
+                return true;
+            }
+            template <typename Archive> void serialize(const Archive& ar) {}
+        };
+
         struct do_consolidate_buffer {
             typedef Range<typename dcT::iterator> rangeT;
 
@@ -2644,6 +2808,7 @@ namespace madness {
                     const FunctionImpl<L,NDIM>* left, const Tensor<L>& lcin,
                     const FunctionImpl<R,NDIM>* right,const Tensor<R>& rcin,
                     double tol) {
+            LBCostTimer<NDIM> lbtimer(key);
             typedef typename FunctionImpl<L,NDIM>::dcT::const_iterator literT;
             typedef typename FunctionImpl<R,NDIM>::dcT::const_iterator riterT;
 
@@ -3924,6 +4089,15 @@ namespace madness {
         /// @param[in]  targs   target tensor arguments (threshold and full/low rank)
         void reduce_rank(const TensorArgs& targs, bool fence);
 
+        /// Stores the coefficients in reduced precision where the error allows it
+
+        /// @param[in]  fac     the error of a node is at most fac times its truncation threshold
+        /// @param[in]  scaled  if true block-scaled integer formats are used, otherwise only single precision
+        void pack(double fac, bool scaled, bool fence);
+
+        /// Widens all packed coefficients to full precision
+        void unpack(bool fence);
+
         T eval_cube(Level n, coordT& x, const tensorT& c) const;
 
         /// Transform sum coefficients at level n to sums+differences at level n-1
@@ -4072,6 +4246,40 @@ namespace madness {
         // Invoked on node where key is local
         Future<coeffT > compress_spawn(const keyT& key, bool nonstandard, bool keepleaves, bool redundant);
 
+        /// compress one level of the tree at a time, cf compress
+
+        /// Each process filters its interior nodes of a level in batches
+        /// with vtransform() and sends the sum coefficients of all its nodes
+        /// to the owners of their parents in one message per process, then
+        /// all processes fence before the next level.  This replaces the
+        /// task and futures per node of compress_spawn by one fence per
+        /// level, which pays off for wide and shallow trees.  Invoked on all
+        /// processes and always fences.
+        /// @param[in] nonstandard	keep sum coeffs at all other levels, except leaves
+        /// @param[in] keepleaves	keep sum coeffs (but no diff coeffs) at leaves
+        void compress_by_level(bool nonstandard, bool keepleaves);
+
+        /// filter a batch of local nodes of one level
+
+        /// @param[in] keys     the nodes, all of the same level
+        /// @return             the sum coefficients of each node for its parent
+        std::vector< std::pair<keyT,tensorT> > compress_level_op(const std::vector<keyT>& keys, bool nonstandard, bool keepleaves);
+
+        /// add the sum coefficients of children into the blocks of their parents, cf compress_by_level
+        void accumulate_child_sums(const std::vector< std::pair<keyT,tensorT> >& batch);
+
+        /// reconstruct one level of the tree at a time, cf reconstruct and compress_by_level
+        void reconstruct_by_level();
+
+        /// unfilter a batch of local nodes of one level
+
+        /// @param[in] nodes    the nodes with the sum coefficients from their parents
+        /// @return             the sum coefficients of each child
+        std::vector< std::pair<keyT,tensorT> > reconstruct_level_op(const std::vector< std::pair<keyT,tensorT> >& nodes);
+
+        /// store the sum coefficients sent by parents, cf reconstruct_by_level
+        void store_parent_sums(const std::vector< std::pair<keyT,tensorT> >& batch);
+
         /// convert this to redundant, i.e. have sum coefficients on all levels
         void make_redundant(const bool fence);
 
@@ -4113,6 +4321,61 @@ namespace madness {
         /// @return         the sum coefficients
         coeffT make_redundant_op(const keyT& key, const std::vector< Future<coeffT > >& v);
 
+        /// Applies the same separable transform to the coefficients of several functions in one pass
+
+        /// The tensors are interleaved so that each of the NDIM steps of
+        /// the transform is one matrix multiply over all functions.
+        /// @param[in] d    tensors of the same shape n^NDIM (full rank)
+        /// @param[in] c    the n by n transformation matrix
+        /// @return         transform(d[i],c) for each i
+        std::vector<tensorT> vtransform(const std::vector<tensorT>& d, const Tensor<double>& c) const;
+
+        /// Compresses several functions in one traversal of the union of their trees
+
+        /// All functions must be reconstructed, full rank, share this's
+        /// process map and wavelet order.  One task handles a box for all
+        /// functions with the box and filters their coefficients with
+        /// vtransform().  Invoked on all processes; this is any of them.
+        void vcompress(const std::vector<implT*>& v, bool fence);
+
+        /// Invoked on node where key is local; all functions in v have a node at key
+        Future< std::vector<coeffT> > vcompress_spawn(const std::vector<implT*>& v, const keyT& key);
+
+        /// Filters the sum coefficients of the children of all interior functions in v
+
+        /// @param[in] v        the functions with a node at key
+        /// @param[in] s        sum coefficients of the functions that are leaves at key
+        /// @param[in] children sum coefficients of each child for the interior functions (in order)
+        /// @return             the sum coefficients of all functions in v
+        std::vector<coeffT> vcompress_op(const std::vector<implT*>& v, const keyT& key, const std::vector<coeffT>& s,
+                                         const std::vector< Future< std::vector<coeffT> > >& children);
+
+        /// Reconstructs several standard compressed functions in one traversal, cf vcompress
+        void vreconstruct(const std::vector<implT*>& v, bool fence);
+
+        /// Invoked on node where key is local; s are the sum coefficients from the parents, cf reconstruct_op
+        void vreconstruct_op(const std::vector<implT*>& v, const keyT& key, const std::vector<coeffT>& s);
+
+        /// Computes the norm tree of several reconstructed functions in one traversal, cf vcompress
+        void vnorm_tree(const std::vector<implT*>& v, bool fence);
+
+        Future< std::vector<double> > vnorm_tree_spawn(const std::vector<implT*>& v, const keyT& key);
+
+        std::vector<double> vnorm_tree_op(const std::vector<implT*>& v, const keyT& key, const std::vector<double>& norms,
+                                          const std::vector< Future< std::vector<double> > >& children);
+
+        /// Truncates several compressed functions in one traversal, cf vcompress and truncate
+
+        /// If tol<=0 the threshold of each function is used
+        void vtruncate(const std::vector<implT*>& v, double tol, bool fence);
+
+        /// Returns for each function in v whether after truncation its node at key has coefficients, cf truncate_spawn
+        Future< std::vector<bool> > vtruncate_spawn(const std::vector<implT*>& v, const keyT& key, double tol);
+
+        std::vector<bool> vtruncate_op(const std::vector<implT*>& v, const keyT& key, double tol,
+                                       const std::vector<bool>& hascoeff,
+                                       const std::vector< Future< std::vector<bool> > >& children);
+
         /// Changes non-standard compressed form to standard compressed form
         void standard(bool fence);
 
@@ -4281,6 +4544,7 @@ namespace madness {
         template <typename opT, typename R>
         void do_apply(const opT* op, const keyT& key, const Tensor<R>& c) {
             PROFILE_MEMBER_FUNC(FunctionImpl);
+            LBCostTimer<NDIM> lbtimer(key);
 
 	    // working assumption here WAS that the operator is
 	    // isotropic and montonically decreasing with distance
@@ -4316,6 +4580,13 @@ namespace madness {
             //previously fac=10.0 selected empirically constrained by qmprop
 
             double cnorm = c.normf();
+            double tol = truncate_tol(thresh, key);
+
+            // In batched mode the significant displacements are gathered
+            // first and then applied and sent together
+            const bool batched = FunctionDefaults<NDIM>::get_apply_batched();
+            std::vector<opkeyT> shifts;
+            std::vector<keyT> dests;
 
             const std::vector<opkeyT>& disp = op->get_disp(key.level()); // list of displacements sorted in orer of increasing distance
             const std::vector<bool> is_periodic(NDIM,false); // Periodic sum is already done when making rnlp
@@ -4343,10 +4614,14 @@ namespace madness {
                 keyT dest = neighbor(key, d, is_periodic);
                 if (dest.is_valid()) {
                     double opnorm = op->norm(key.level(), *it, source);
-                    double tol = truncate_tol(thresh, key);
 
                     if (cnorm*opnorm> tol/fac) {
 		        ndone++;
+                        if (batched) {
+                            shifts.push_back(*it);
+                            dests.push_back(dest);
+                            continue;
+                        }
 		        tensorT result = op->apply(source, *it, c, tol/fac/cnorm);
 			if (result.normf() > 0.3*tol/fac) {
 			      // Switched back to send in order to get rid of a zillion small tasks and to preserve
@@ -4356,6 +4631,40 @@ namespace madness {
                     }
                 }
             }
+
+            if (shifts.empty()) return;
+
+            // One pass over all displacements reusing the operator work space,
+            // then one message per remote owner rather than one per result
+            const std::vector< Tensor<TENSOR_RESULT_TYPE(R,typename opT::opT)> > results =
+                op->apply_batch(source, shifts, c, tol/fac/cnorm);
+            std::map< ProcessID, std::vector< std::pair<keyT,tensorT> > > remote;
+            for (std::size_t i=0; i<results.size(); ++i) {
+                if (results[i].normf() > 0.3*tol/fac) {
+                    const ProcessID owner = coeffs.owner(dests[i]);
+                    if (owner == world.rank())
+                        coeffs.send(dests[i], &nodeT::accumulate2, tensorT(results[i]), coeffs, dests[i]);
+                    else
+                        remote[owner].push_back(std::make_pair(dests[i], tensorT(results[i])));
+                }
+            }
+            for (typename std::map< ProcessID, std::vector< std::pair<keyT,tensorT> > >::const_iterator it=remote.begin();
+                 it!=remote.end(); ++it) {
+                if (it->second.size() == 1)
+                    coeffs.send(it->second[0].first, &nodeT::accumulate2, it->second[0].second, coeffs, it->second[0].first);
+                else
+                    woT::send(it->first, &implT::accumulate_batch, it->second);
+            }
+        }
+
+
+        /// accumulate the results of a batched apply sent by another process
+
+        /// @param[in] batch	the destination keys and the coefficients to add to them
+        void accumulate_batch(const std::vector< std::pair<keyT,tensorT> >& batch) {
+            for (typename std::vector< std::pair<keyT,tensorT> >::const_iterator it=batch.begin(); it!=batch.end(); ++it) {
+                coeffs.send(it->first, &nodeT::accumulate2, it->second, coeffs, it->first);
+            }
         }
 
 
@@ -4400,7 +4709,7 @@ namespace madness {
         double do_apply_directed_screening(const opT* op, const keyT& key, const coeffT& coeff,
                                            const bool& do_kernel) {
             PROFILE_MEMBER_FUNC(FunctionImpl);
-            // insert timer here
+            LBCostTimer<NDIM> lbtimer(key);
             typedef typename opT::keyT opkeyT;
 
             // screening: contains all displacement keys that had small result norms
@@ -4990,15 +5299,43 @@ namespace madness {
         }
 
 
+        /// Packs the full coefficients of a box as rows of a matrix, conjugated if requested
+
+        /// Returns false if any of the coefficients are not full rank
+        /// tensors, in which case a dot product per pair must be used.
+        template <typename Q, typename resultT>
+        static bool pack_coeffs(const std::vector< std::pair<int,const GenTensor<Q>*> >& v,
+                                bool conjugate, long size, Tensor<resultT>& panel) {
+            const long dims[2] = {long(v.size()), size};
+            panel = Tensor<resultT>(2, dims, false);
+            resultT* MADNESS_RESTRICT p = panel.ptr();
+            for (std::size_t i=0; i<v.size(); ++i, p+=size) {
+                if (v[i].second->tensor_type() != TT_FULL) return false;
+                const Tensor<Q>& t = v[i].second->full_tensor();
+                if (t.size() != size || !t.iscontiguous()) return false;
+                const Q* MADNESS_RESTRICT q = t.ptr();
+                if (conjugate) {
+                    for (long k=0; k<size; ++k) p[k] = conj(q[k]);
+                }
+                else {
+                    for (long k=0; k<size; ++k) p[k] = q[k];
+                }
+            }
+            return true;
+        }
+
         template <typename R>
         static void do_inner_localX(const typename mapT::iterator lstart,
                                     const typename mapT::iterator lend,
                                     typename FunctionImpl<R,NDIM>::mapT* rmap_ptr,
                                     const bool sym,
+                                    const bool tiled,
                                     Tensor< TENSOR_RESULT_TYPE(T,R) >* result_ptr,
                                     Mutex* mutex) {
-            Tensor< TENSOR_RESULT_TYPE(T,R) >& result = *result_ptr;
-            Tensor< TENSOR_RESULT_TYPE(T,R) > r(result.dim(0),result.dim(1));
+            typedef TENSOR_RESULT_TYPE(T,R) resultT;
+            Tensor<resultT>& result = *result_ptr;
+            Tensor<resultT> r(result.dim(0),result.dim(1));
+            Tensor<resultT> lpanel, rpanel;
             for (typename mapT::iterator lit=lstart; lit!=lend; ++lit) {
                 const keyT& key = lit->first;
                 typename FunctionImpl<R,NDIM>::mapT::iterator rit=rmap_ptr->find(key);
@@ -5008,6 +5345,25 @@ namespace madness {
                     const int nleft = leftv.size();
                     const int nright= rightv.size();
 
+                    // All pairs of the box in one matrix multiply, c(iv,jv) = sum(k) conj(a(iv,k))*b(jv,k)
+                    if (tiled && nleft*nright > 1) {
+                        const long size = leftv[0].second->size();
+                        if (pack_coeffs(leftv, true, size, lpanel) && pack_coeffs(rightv, false, size, rpanel)) {
+                            Tensor<resultT> c(nleft, nright);
+                            const resultT one = 1.0;
+                            cblas::gemm(cblas::Trans, cblas::NoTrans, nright, nleft, size, one,
+                                        rpanel.ptr(), size, lpanel.ptr(), size, one, c.ptr(), nright);
+                            for (int iv=0; iv<nleft; iv++) {
+                                const int i = leftv[iv].first;
+                                for (int jv=0; jv<nright; jv++) {
+                                    const int j = rightv[jv].first;
+                                    if (!sym || i<=j) r(i,j) += c(iv,jv);
+                                }
+                            }
+                            continue;
+                        }
+                    }
+
                     for (int iv=0; iv<nleft; iv++) {
                         const int i = leftv[iv].first;
                         const GenTensor<T>* iptr = leftv[iv].second;
@@ -5056,6 +5412,9 @@ namespace madness {
             //          do j in jtile
             //             do k in ktile
             //                Rij += Aki*Bkj
+            //
+            // With inner_tiled the coefficients of all functions in a box
+            // are packed into panels and multiplied with a single GEMM.
 
             mapT lmap = make_key_vec_map(left);
             typename FunctionImpl<R,NDIM>::mapT rmap;
@@ -5074,7 +5433,8 @@ namespace madness {
             while (lstart != lmap.end()) {
                 typename mapT::iterator lend = lstart;
                 advance(lend,chunk);
-                left[0]->world.taskq.add(&FunctionImpl<T,NDIM>::do_inner_localX<R>, lstart, lend, rmap_ptr, sym, &r, &mutex);
+                left[0]->world.taskq.add(&FunctionImpl<T,NDIM>::do_inner_localX<R>, lstart, lend, rmap_ptr, sym,
+                                         FunctionDefaults<NDIM>::get_inner_tiled(), &r, &mutex);
                 lstart = lend;
             }
             left[0]->world.taskq.fence();
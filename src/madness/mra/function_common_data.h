@@ -77,6 +77,15 @@ namespace madness {
             }
             key0 = Key<NDIM> (0, Vector<Translation, NDIM> (0));
 
+            // Coefficient tensors are almost all k^NDIM or (2k)^NDIM
+            std::size_t nk = sizeof(T), n2k = sizeof(T);
+            for (std::size_t i = 0; i < NDIM; ++i) {
+                nk *= k;
+                n2k *= 2 * k;
+            }
+            SlabAllocator::register_size(nk);
+            SlabAllocator::register_size(n2k);
+
             _init_twoscale();
             _init_quadrature(k, npt, quad_x, quad_w, quad_phi, quad_phiw,
                              quad_phit);
@@ -179,6 +179,14 @@ namespace madness {
       return self();
     }
 
+    /// Projects f, evaluating whole boxes of quadrature points with vf
+    FunctionFactory&
+    f(T (*f)(const coordT&), void (*vf)(const Vector<double*,NDIM>&, T*, int)) {
+      functor(std::shared_ptr<FunctionFunctorInterface<T, NDIM> > (
+	  new ElementaryInterface<T,NDIM>(f,vf)));
+      return self();
+    }
+
     virtual FunctionFactory& k(int k) {
       _k = k;
       return self();
@@ -230,11 +230,20 @@ namespace madness {
         typedef GenTensor<T> coeffT;
 
 		T (*f)(const coordT&);
+		void (*vf)(const Vector<double*,NDIM>&, T*, int); ///< Optional version of f for many points
 
-		ElementaryInterface(T (*f)(const coordT&)) : f(f) {}
+		ElementaryInterface(T (*f)(const coordT&), void (*vf)(const Vector<double*,NDIM>&, T*, int)=0)
+			: f(f), vf(vf) {}
 
 		T operator()(const coordT& x) const {return f(x);}
 
+		bool supports_vectorized() const {return vf != 0;}
+
+		/// Evaluates vf at all quadrature points of a box (fcube uses this if vf is given)
+		void operator()(const Vector<double*,NDIM>& xvals, T* fvals, int npts) const {
+			vf(xvals, fvals, npts);
+		}
+
 		coeffT values(const Key<NDIM>& key, const Tensor<double>& quad_x) const {
 	        typedef Tensor<T> tensorT;
             tensorT fval=madness::fcube(key,f,quad_x);
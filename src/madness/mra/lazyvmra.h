@@ -0,0 +1,359 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_MRA_LAZYVMRA_H__INCLUDED
+#define MADNESS_MRA_LAZYVMRA_H__INCLUDED
+
+/*!
+	\file lazyvmra.h
+	\brief Deferred evaluation of arithmetic on vectors of Functions
+	\ingroup mra
+
+	Each call in vmra.h walks every tree and usually fences before it
+	returns.  A LazyVector instead records the operations into a graph
+	that evaluate() runs in stages, each stage doing all operations
+	whose arguments are ready:
+
+	- linear combinations (+, -, scaling, gaxpy) are folded into a single
+	  node of the graph, so the intermediate vectors are never made and
+	  each result is one compressed sum;
+	- multiplications by the same function, truncations with the same
+	  tolerance and applications of the same operator are done in one
+	  call on the concatenated vectors;
+	- intermediates are released as soon as the last operation using
+	  them has run, unless a LazyVector still refers to them;
+	- fences are issued only between stages or where the next operation
+	  needs the state (compressed or reconstructed) of its argument to
+	  be complete.
+
+	\code
+	LazyVector<double,3> psi(world, amo);
+	LazyVector<double,3> r = psi - truncate(apply(*coulop, mul_sparse(vlocal, psi, vtol)));
+	vecfuncT residual = r.evaluate();
+	\endcode
+
+	The functions given to the graph, and the multipliers and operators,
+	must not be changed or destroyed before evaluate() returns.
+*/
+
+#include <madness/mra/mra.h>
+#include <madness/mra/vmra.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace madness {
+
+    /// A vector of functions whose value is computed on demand by evaluate()
+    template <typename T, std::size_t NDIM>
+    class LazyVector {
+    public:
+        typedef std::vector< Function<T,NDIM> > vecfuncT;
+        typedef SeparatedConvolution<double,NDIM> operatorT;
+
+    private:
+        struct Node {
+            enum Kind {LEAF, LINEAR, MUL, TRUNCATE, APPLY};
+
+            Kind kind;
+            std::size_t n;                              ///< The number of functions
+            std::vector< std::shared_ptr<Node> > args;
+            std::vector< std::vector<T> > c;            ///< LINEAR: value[i] = sum(k) c[k][i]*args[k][i]
+            Function<T,NDIM> a;                         ///< MUL: the multiplier
+            double tol;                                 ///< MUL and TRUNCATE tolerance
+            const operatorT* op;                        ///< APPLY: the operator
+            vecfuncT value;
+            bool done;
+
+            Node(Kind kind, std::size_t n) : kind(kind), n(n), tol(0.0), op(0), done(false) {}
+        };
+        typedef std::shared_ptr<Node> nodeptrT;
+
+        World* world;
+        nodeptrT node;
+
+        LazyVector(World* world, const nodeptrT& node) : world(world), node(node) {}
+
+        /// Adds alpha[i]*x[i] to the linear combination r, expanding x if it is itself unevaluated and linear
+        static void add_terms(Node& r, const std::vector<T>& alpha, const nodeptrT& x) {
+            MADNESS_ASSERT(x->n == r.n);
+            if (x->kind == Node::LINEAR && !x->done) {
+                for (std::size_t k=0; k<x->args.size(); ++k) {
+                    std::vector<T> ck(r.n);
+                    for (std::size_t i=0; i<r.n; ++i) ck[i] = alpha[i]*x->c[k][i];
+                    add_terms(r, ck, x->args[k]);
+                }
+                return;
+            }
+            for (std::size_t k=0; k<r.args.size(); ++k) {
+                if (r.args[k] == x) {
+                    for (std::size_t i=0; i<r.n; ++i) r.c[k][i] += alpha[i];
+                    return;
+                }
+            }
+            r.args.push_back(x);
+            r.c.push_back(alpha);
+        }
+
+        LazyVector linear(const std::vector<T>& alpha, const LazyVector& x,
+                          const std::vector<T>& beta, const LazyVector& y) const {
+            nodeptrT r(new Node(Node::LINEAR, x.size()));
+            add_terms(*r, alpha, x.node);
+            if (y.node) add_terms(*r, beta, y.node);
+            return LazyVector(world, r);
+        }
+
+        /// Collects the unevaluated nodes below x
+        static void collect(const nodeptrT& x, std::set<Node*>& seen, std::vector<Node*>& order) {
+            if (x->done || !seen.insert(x.get()).second) return;
+            for (const nodeptrT& arg : x->args) collect(arg, seen, order);
+            order.push_back(x.get());
+        }
+
+        /// Concatenates the values of the first arguments of the nodes
+        static vecfuncT concat_args(const std::vector<Node*>& group) {
+            vecfuncT v;
+            for (Node* x : group) v.insert(v.end(), x->args[0]->value.begin(), x->args[0]->value.end());
+            return v;
+        }
+
+        /// Splits the concatenated results of a group back into its nodes
+        static void split(const std::vector<Node*>& group, const vecfuncT& v) {
+            std::size_t offset = 0;
+            for (Node* x : group) {
+                x->value.assign(v.begin()+offset, v.begin()+offset+x->n);
+                offset += x->n;
+            }
+        }
+
+        void fence(bool& pending) const {
+            if (pending) world->gop.fence();
+            pending = false;
+        }
+
+        void evaluate_linear(const std::vector<Node*>& group, bool& pending) const {
+            if (group.empty()) return;
+            fence(pending);
+            vecfuncT all;
+            for (Node* x : group) {
+                for (const nodeptrT& arg : x->args) all.insert(all.end(), arg->value.begin(), arg->value.end());
+                x->value = zero_functions_compressed<T,NDIM>(*world, x->n, false);
+            }
+            compress(*world, all, false);
+            world->gop.fence();
+            for (Node* x : group) {
+                for (std::size_t k=0; k<x->args.size(); ++k) {
+                    for (std::size_t i=0; i<x->n; ++i) {
+                        if (x->c[k][i] != T(0.0)) x->value[i].gaxpy(T(1.0), x->args[k]->value[i], x->c[k][i], false);
+                    }
+                }
+            }
+            pending = true;
+        }
+
+        void evaluate_mul(const std::vector<Node*>& group, bool& pending) const {
+            // One call per multiplier and tolerance
+            std::map< std::pair<const FunctionImpl<T,NDIM>*,double>, std::vector<Node*> > batches;
+            for (Node* x : group) batches[std::make_pair(x->a.get_impl().get(), x->tol)].push_back(x);
+            for (auto& batch : batches) {
+                fence(pending);
+                const Function<T,NDIM>& a = batch.second[0]->a;
+                const double tol = batch.first.second;
+                if (tol > 0.0) split(batch.second, mul_sparse(*world, a, concat_args(batch.second), tol, false));
+                else split(batch.second, mul(*world, a, concat_args(batch.second), false));
+                pending = true;
+            }
+        }
+
+        void evaluate_truncate(const std::vector<Node*>& group, bool& pending) const {
+            std::map< double, std::vector<Node*> > batches;
+            for (Node* x : group) batches[x->tol].push_back(x);
+            for (auto& batch : batches) {
+                fence(pending);
+                // Truncation is in place so copy arguments that are used elsewhere
+                for (Node* x : batch.second) {
+                    const nodeptrT& arg = x->args[0];
+                    if (arg.use_count() == 1 && arg->kind != Node::LEAF) {
+                        x->value = arg->value;
+                    }
+                    else {
+                        x->value = copy(*world, arg->value, false);
+                        pending = true;
+                    }
+                }
+                fence(pending);
+                vecfuncT all;
+                for (Node* x : batch.second) all.insert(all.end(), x->value.begin(), x->value.end());
+                truncate(*world, all, batch.first, false);
+                pending = true;
+            }
+        }
+
+        void evaluate_apply(const std::vector<Node*>& group, bool& pending) const {
+            std::map< const operatorT*, std::vector<Node*> > batches;
+            for (Node* x : group) batches[x->op].push_back(x);
+            for (auto& batch : batches) {
+                fence(pending);
+                split(batch.second, apply(*world, *batch.first, concat_args(batch.second)));
+                pending = false; // apply fences
+            }
+        }
+
+    public:
+        /// An empty vector
+        LazyVector() : world(0) {}
+
+        /// Wraps a vector of functions without copying them
+        LazyVector(World& world, const vecfuncT& v) : world(&world), node(new Node(Node::LEAF, v.size())) {
+            node->value = v;
+            node->done = true;
+        }
+
+        /// Returns the number of functions
+        std::size_t size() const {
+            return node ? node->n : 0;
+        }
+
+        /// Returns true if the value has been computed
+        bool is_evaluated() const {
+            return node && node->done;
+        }
+
+        /// Computes the value ... collective
+
+        /// Nodes computed once keep their values, so evaluating several
+        /// LazyVectors sharing part of their graph does that part once.
+        /// @param[in] fence If false the result may not be complete until the next fence
+        const vecfuncT& evaluate(bool fence=true) const {
+            MADNESS_ASSERT(node);
+            if (node->done) return node->value;
+
+            std::set<Node*> seen;
+            std::vector<Node*> order;
+            collect(node, seen, order);
+
+            bool pending = false;
+            while (!node->done) {
+                std::vector<Node*> ready[5];
+                for (Node* x : order) {
+                    bool isready = true;
+                    for (const nodeptrT& arg : x->args) isready = isready && arg->done;
+                    if (isready) ready[x->kind].push_back(x);
+                }
+                evaluate_linear(ready[Node::LINEAR], pending);
+                evaluate_mul(ready[Node::MUL], pending);
+                evaluate_truncate(ready[Node::TRUNCATE], pending);
+                evaluate_apply(ready[Node::APPLY], pending);
+
+                for (int kind=0; kind<5; ++kind) {
+                    for (Node* x : ready[kind]) x->done = true;
+                }
+                order.erase(std::remove_if(order.begin(), order.end(), [](Node* x) {return x->done;}), order.end());
+
+                // Dropping the arguments frees the intermediates no longer
+                // referenced (destruction of their FunctionImpls is deferred
+                // to the next fence)
+                for (int kind=0; kind<5; ++kind) {
+                    for (Node* x : ready[kind]) {
+                        x->args.clear();
+                        x->c.clear();
+                        x->a = Function<T,NDIM>();
+                    }
+                }
+            }
+            if (fence) this->fence(pending);
+            return node->value;
+        }
+
+        LazyVector operator+(const LazyVector& y) const {
+            return linear(std::vector<T>(size(),T(1.0)), *this, std::vector<T>(size(),T(1.0)), y);
+        }
+
+        LazyVector operator-(const LazyVector& y) const {
+            return linear(std::vector<T>(size(),T(1.0)), *this, std::vector<T>(size(),T(-1.0)), y);
+        }
+
+        LazyVector operator*(const T& alpha) const {
+            return linear(std::vector<T>(size(),alpha), *this, std::vector<T>(), LazyVector());
+        }
+
+        /// Scales each function by its own factor
+        LazyVector scale(const std::vector<T>& factors) const {
+            return linear(factors, *this, std::vector<T>(), LazyVector());
+        }
+
+        /// Returns alpha*x + beta*y
+        friend LazyVector gaxpy(const T& alpha, const LazyVector& x, const T& beta, const LazyVector& y) {
+            return x.linear(std::vector<T>(x.size(),alpha), x, std::vector<T>(x.size(),beta), y);
+        }
+
+        friend LazyVector operator*(const T& alpha, const LazyVector& x) {
+            return x*alpha;
+        }
+
+        /// Returns a*x[i], using sparsity of a and x[i] if tol>0 (cf vmra.h)
+        friend LazyVector mul_sparse(const Function<T,NDIM>& a, const LazyVector& x, double tol) {
+            nodeptrT r(new Node(Node::MUL, x.size()));
+            r->args.push_back(x.node);
+            r->a = a;
+            r->tol = tol;
+            return LazyVector(x.world, r);
+        }
+
+        /// Returns x truncated to tol (the default threshold if tol<=0)
+        friend LazyVector truncate(const LazyVector& x, double tol=0.0) {
+            nodeptrT r(new Node(Node::TRUNCATE, x.size()));
+            r->args.push_back(x.node);
+            r->tol = tol;
+            return LazyVector(x.world, r);
+        }
+
+        /// Returns op applied to each x[i] (the operator must exist until evaluated)
+        friend LazyVector apply(const operatorT& op, const LazyVector& x) {
+            nodeptrT r(new Node(Node::APPLY, x.size()));
+            r->args.push_back(x.node);
+            r->op = &op;
+            return LazyVector(x.world, r);
+        }
+
+        /// Evaluates both vectors and returns their matrix of inner products ... collective
+        friend Tensor<T> matrix_inner(const LazyVector& f, const LazyVector& g, bool sym=false) {
+            f.evaluate(false);
+            g.evaluate();
+            return matrix_inner(*f.world, f.evaluate(), g.evaluate(), sym);
+        }
+    };
+
+}
+
+#endif // MADNESS_MRA_LAZYVMRA_H__INCLUDED
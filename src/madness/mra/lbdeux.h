@@ -34,10 +34,12 @@
 #define MADNESS_MRA_IBDEUX_H__INCLUDED
 
 #include <madness/madness_config.h>
+#include <cstdlib>
 #include <map>
 #include <queue>
 #include <madness/world/atomicint.h>
 #include <madness/world/worlddc.h>
+#include <madness/world/worldhashmap.h>
 
 #include <madness/mra/key.h>
 #include <madness/mra/funcdefaults.h>
@@ -92,6 +94,117 @@ namespace madness {
 
 
 
+    /// Records the measured cost of the work done on each key
+
+    /// When enabled, with enable() or by setting \c MAD_LB_MEASURE=1 in
+    /// the environment, FunctionImpl::do_apply, mulXX and compress_op
+    /// accumulate the time (in microseconds) spent on each key.  The
+    /// costs are kept by the process that did the work, which is the
+    /// owner of the key, so that LBMeasuredCost can hand them to
+    /// LoadBalanceDeux without communication.
+    template <std::size_t NDIM>
+    class LBCostRecorder {
+        typedef Key<NDIM> keyT;
+        typedef ConcurrentHashMap<keyT,double> mapT;
+
+        static mapT& costs() {
+            static mapT map;
+            return map;
+        }
+
+        static volatile bool& flag() {
+            static volatile bool enabled = std::getenv("MAD_LB_MEASURE") && std::atoi(std::getenv("MAD_LB_MEASURE"));
+            return enabled;
+        }
+
+    public:
+        /// Turns recording on or off on this process
+        static void enable(bool value=true) {
+            flag() = value;
+        }
+
+        static bool enabled() {
+            return flag();
+        }
+
+        /// Accumulates cost (in seconds) onto key
+        static void record(const keyT& key, double seconds) {
+            typename mapT::accessor acc;
+            costs().insert(acc, key); // Value initialized to zero
+            acc->second += 1e6*seconds;
+        }
+
+        /// Returns the cost recorded for key and forgets it
+        static double take(const keyT& key) {
+            typename mapT::accessor acc;
+            if (!costs().find(acc, key)) return 0.0;
+            const double cost = acc->second;
+            acc->second = 0.0;
+            return cost;
+        }
+
+        /// Returns the total cost recorded by this process
+        static double local_total() {
+            double total = 0.0;
+            for (typename mapT::const_iterator it=costs().begin(); it!=costs().end(); ++it)
+                total += it->second;
+            return total;
+        }
+
+        /// Forgets all recorded costs
+        static void clear() {
+            costs().clear();
+        }
+
+        /// Returns the ratio of the maximum to the mean cost per process ... collective
+
+        /// Returns 1.0 if nothing was recorded.
+        static double imbalance(World& world) {
+            world.gop.fence();
+            double total = local_total(), maxcost = total;
+            world.gop.sum(total);
+            world.gop.max(maxcost);
+            return (total > 0.0) ? maxcost*world.size()/total : 1.0;
+        }
+    };
+
+    /// Times the enclosing scope and records it against a key if recording is enabled
+    template <std::size_t NDIM>
+    class LBCostTimer {
+        const Key<NDIM> key;
+        const bool on;
+        const double start;
+
+    public:
+        LBCostTimer(const Key<NDIM>& key)
+            : key(key)
+            , on(LBCostRecorder<NDIM>::enabled())
+            , start(on ? cpu_time() : 0.0)
+        {}
+
+        ~LBCostTimer() {
+            if (on) LBCostRecorder<NDIM>::record(key, cpu_time()-start);
+        }
+    };
+
+    /// Cost functor for LoadBalanceDeux::add_tree() using the measured costs
+
+    /// Each node is charged the shape cost (as in a tree-only model) plus
+    /// the cost recorded for its key.  The recorded cost is consumed so it is
+    /// counted once even if several functions sharing the key are added.
+    /// Work recorded on keys not in any added tree is not counted.
+    template <typename T, std::size_t NDIM>
+    struct LBMeasuredCost {
+        double leaf_value;
+        double parent_value;
+        LBMeasuredCost(double leaf_value=1.0, double parent_value=0.0)
+            : leaf_value(leaf_value), parent_value(parent_value) {}
+
+        double operator()(const Key<NDIM>& key, const FunctionNode<T,NDIM>& node) const {
+            return LBCostRecorder<NDIM>::take(key) + (node.has_children() ? parent_value : leaf_value);
+        }
+    };
+
     template <std::size_t NDIM>
     class LBNodeDeux {
         static const int nchild = (1<<NDIM);
@@ -0,0 +1,70 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file mra/mappedfunction.cc
+/// \brief Read-only memory mapping of files for MappedFunction
+
+#include <madness/mra/mappedfunction.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+
+namespace madness {
+    namespace detail {
+
+        MappedFile::MappedFile(const std::string& filename) : p(0), nbyte(0) {
+            const int fd = open(filename.c_str(), O_RDONLY);
+            if (fd < 0) MADNESS_EXCEPTION("MappedFile: cannot open file", errno);
+            struct stat st;
+            if (fstat(fd, &st) != 0) {
+                close(fd);
+                MADNESS_EXCEPTION("MappedFile: cannot stat file", errno);
+            }
+            nbyte = st.st_size;
+            if (nbyte) {
+                void* addr = mmap(0, nbyte, PROT_READ, MAP_SHARED, fd, 0);
+                if (addr == MAP_FAILED) {
+                    close(fd);
+                    MADNESS_EXCEPTION("MappedFile: mmap failed", errno);
+                }
+                p = static_cast<const unsigned char*>(addr);
+            }
+            close(fd); // The mapping holds its own reference to the file
+        }
+
+        MappedFile::~MappedFile() {
+            if (p) munmap(const_cast<unsigned char*>(p), nbyte);
+        }
+
+    } // namespace detail
+} // namespace madness
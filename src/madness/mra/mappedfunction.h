@@ -0,0 +1,488 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_MRA_MAPPEDFUNCTION_H__INCLUDED
+#define MADNESS_MRA_MAPPEDFUNCTION_H__INCLUDED
+
+/*!
+	\file mappedfunction.h
+	\brief Memory-mapped, read-only functions for analysis and post-processing
+	\ingroup mra
+
+	save_mapped() writes a reconstructed Function as a single file laid
+	out for \c mmap:
+
+	- a fixed header (type, dimension, k, cell),
+	- the index, one MappedNode per key sorted by level then translation,
+	- the scaling coefficients of each leaf as a contiguous block
+	  aligned to MAPPED_ALIGNMENT bytes.
+
+	A MappedFunction maps the file read-only and evaluates, integrates
+	and plots straight from the mapping with a binary search of the
+	index.  Nothing is deserialized and only the pages touched are read,
+	so opening even a large function is immediate and processes on a
+	node share the same physical memory.  A MappedFunction is local to
+	each process and does not need a World.
+
+	\code
+	save_mapped(psi, "psi.mmap");             // collective
+
+	MappedFunction<double,3> f("psi.mmap");   // any process, any time
+	double v = f(coord_3d(0.0));
+	double s = inner(f, f);
+	\endcode
+*/
+
+#include <madness/mra/mra.h>
+#include <madness/mra/legendre.h>
+#include <madness/mra/mappedfile.h>
+#include <madness/world/mpi_archive.h>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace madness {
+
+    static const std::size_t MAPPED_ALIGNMENT = 64; ///< Alignment of index and coefficients
+
+    namespace detail {
+
+        /// Leading part of a mapped function file
+        struct MappedHeader {
+            char magic[8];          ///< "MADMMAP"
+            int64_t version;
+            int64_t type;           ///< TensorTypeData<T>::id
+            int64_t ndim;
+            int64_t k;
+            int64_t nnode;          ///< No. of entries in the index
+            int64_t index_offset;   ///< Offset of the index from the start of the file
+            int64_t data_offset;    ///< Offset of the first coefficient block
+            double cell[2*6];       ///< Cell in user coordinates (lo,hi) for each dimension
+        };
+
+        /// One entry of the index of a mapped function file
+        template <std::size_t NDIM>
+        struct MappedNode {
+            Translation l[NDIM];
+            int32_t n;
+            int32_t has_children;
+            int64_t offset;         ///< Offset of the coefficients from the start of the file or -1
+
+            bool operator<(const Key<NDIM>& key) const {
+                if (n != key.level()) return n < key.level();
+                for (std::size_t d=0; d<NDIM; ++d) {
+                    if (l[d] != key.translation()[d]) return l[d] < key.translation()[d];
+                }
+                return false;
+            }
+
+            bool operator==(const Key<NDIM>& key) const {
+                if (n != key.level()) return false;
+                for (std::size_t d=0; d<NDIM; ++d) {
+                    if (l[d] != key.translation()[d]) return false;
+                }
+                return true;
+            }
+        };
+
+        /// Orders keys as in the index of a mapped function file
+        template <std::size_t NDIM>
+        struct mapped_key_less {
+            template <typename T>
+            bool operator()(const std::pair< Key<NDIM>, T>& a, const std::pair< Key<NDIM>, T>& b) const {
+                if (a.first.level() != b.first.level()) return a.first.level() < b.first.level();
+                for (std::size_t d=0; d<NDIM; ++d) {
+                    if (a.first.translation()[d] != b.first.translation()[d])
+                        return a.first.translation()[d] < b.first.translation()[d];
+                }
+                return false;
+            }
+        };
+
+        static const int64_t MAPPED_VERSION = 1;
+
+        inline int64_t mapped_align(int64_t n) {
+            return ((n + MAPPED_ALIGNMENT - 1)/MAPPED_ALIGNMENT)*MAPPED_ALIGNMENT;
+        }
+    }
+
+    /// Writes a function to a file that may be opened as a MappedFunction ... collective
+
+    /// The function is reconstructed and all of its nodes gathered to
+    /// process zero which writes the file.
+    template <typename T, std::size_t NDIM>
+    void save_mapped(const Function<T,NDIM>& f, const std::string& filename) {
+        PROFILE_FUNC;
+        MADNESS_ASSERT(NDIM <= 6);
+        typedef std::pair< Key<NDIM>, std::pair<bool, Tensor<T> > > datumT;
+        World& world = f.world();
+        f.reconstruct();
+
+        std::vector<datumT> nodes;
+        const typename FunctionImpl<T,NDIM>::dcT& coeffs = f.get_impl()->get_coeffs();
+        for (auto it=coeffs.begin(); it!=coeffs.end(); ++it) {
+            const typename FunctionImpl<T,NDIM>::nodeT& node = it->second;
+            Tensor<T> c;
+            if (node.has_coeff()) c = node.coeff().full_tensor_copy();
+            nodes.push_back(datumT(it->first, std::make_pair(node.has_children(), c)));
+        }
+
+        // Gather the nodes one process at a time (as in print_seq)
+        if (world.rank() == 0) {
+            for (ProcessID p=1; p<world.size(); ++p) {
+                std::vector<datumT> remote;
+                archive::MPIOutputArchive(world, p) & 1;
+                archive::MPIInputArchive(world, p) & remote;
+                nodes.insert(nodes.end(), remote.begin(), remote.end());
+            }
+        }
+        else {
+            int go;
+            archive::MPIInputArchive(world, 0) & go;
+            archive::MPIOutputArchive(world, 0) & nodes;
+            nodes.clear();
+        }
+
+        int ok = 1;
+        if (world.rank() == 0) {
+            std::sort(nodes.begin(), nodes.end(), detail::mapped_key_less<NDIM>());
+
+            const int k = f.k();
+            const int64_t blocksize = detail::mapped_align(int64_t(std::pow(double(k), double(NDIM)))*sizeof(T));
+
+            detail::MappedHeader header;
+            std::fill_n(reinterpret_cast<char*>(&header), sizeof(header), 0);
+            std::copy_n("MADMMAP", 8, header.magic);
+            header.version = detail::MAPPED_VERSION;
+            header.type = TensorTypeData<T>::id;
+            header.ndim = NDIM;
+            header.k = k;
+            header.nnode = nodes.size();
+            header.index_offset = detail::mapped_align(sizeof(header));
+            header.data_offset = detail::mapped_align(header.index_offset + nodes.size()*sizeof(detail::MappedNode<NDIM>));
+            const Tensor<double>& cell = FunctionDefaults<NDIM>::get_cell();
+            for (std::size_t d=0; d<NDIM; ++d) {
+                header.cell[2*d] = cell(d,0);
+                header.cell[2*d+1] = cell(d,1);
+            }
+
+            std::vector< detail::MappedNode<NDIM> > index(nodes.size());
+            int64_t offset = header.data_offset;
+            for (std::size_t i=0; i<nodes.size(); ++i) {
+                const Key<NDIM>& key = nodes[i].first;
+                for (std::size_t d=0; d<NDIM; ++d) index[i].l[d] = key.translation()[d];
+                index[i].n = key.level();
+                index[i].has_children = nodes[i].second.first;
+                if (nodes[i].second.second.has_data()) {
+                    index[i].offset = offset;
+                    offset += blocksize;
+                }
+                else {
+                    index[i].offset = -1;
+                }
+            }
+
+            std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+            const std::vector<char> pad(MAPPED_ALIGNMENT, 0);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(&pad[0], header.index_offset - sizeof(header));
+            if (index.size()) out.write(reinterpret_cast<const char*>(&index[0]), index.size()*sizeof(index[0]));
+            out.write(&pad[0], header.data_offset - header.index_offset - index.size()*sizeof(index[0]));
+            for (std::size_t i=0; i<nodes.size(); ++i) {
+                const Tensor<T>& c = nodes[i].second.second;
+                if (c.has_data()) {
+                    MADNESS_ASSERT(c.iscontiguous());
+                    out.write(reinterpret_cast<const char*>(c.ptr()), c.size()*sizeof(T));
+                    out.write(&pad[0], blocksize - c.size()*sizeof(T));
+                }
+            }
+            out.close();
+            ok = bool(out);
+        }
+        world.gop.broadcast(ok);
+        if (!ok) MADNESS_EXCEPTION("save_mapped: failed writing file", 0);
+    }
+
+    /// A read-only function served directly from a file written by save_mapped()
+    template <typename T, std::size_t NDIM>
+    class MappedFunction {
+        typedef detail::MappedNode<NDIM> mnodeT;
+        typedef Vector<double,NDIM> coordT;
+        typedef Key<NDIM> keyT;
+
+        std::shared_ptr<detail::MappedFile> file;
+        const detail::MappedHeader* header;
+        const mnodeT* index;
+        int k;
+        coordT lo;            ///< Lower corner of the cell
+        coordT width;         ///< Width of the cell
+        double rvolume;       ///< 1/sqrt(volume of the cell)
+
+        /// Evaluates the scaling functions of box n with coefficients c at x in [0,1]^NDIM
+        T eval_box(Level n, const coordT& x, const T* c) const {
+            std::vector<double> px(NDIM*k);
+            for (std::size_t d=0; d<NDIM; ++d) legendre_scaling_functions(x[d], k, &px[d*k]);
+
+            // Contract one dimension at a time starting with the last
+            std::vector<T> work(c, c + long(std::pow(double(k), double(NDIM-1))));
+            long nleft = work.size();
+            {
+                const double* p = &px[(NDIM-1)*k];
+                for (long i=0; i<nleft; ++i) {
+                    T sum = T(0.0);
+                    for (int j=0; j<k; ++j) sum += c[i*k+j]*p[j];
+                    work[i] = sum;
+                }
+            }
+            for (long d=long(NDIM)-2; d>=0; --d) {
+                const double* p = &px[d*k];
+                nleft /= k;
+                for (long i=0; i<nleft; ++i) {
+                    T sum = T(0.0);
+                    for (int j=0; j<k; ++j) sum += work[i*k+j]*p[j];
+                    work[i] = sum;
+                }
+            }
+            return work[0]*std::pow(2.0,0.5*NDIM*n)*rvolume;
+        }
+
+        /// Finds the leaf containing x in simulation coordinates, returning x relative to the leaf
+        const mnodeT* find_leaf(coordT& x) const {
+            Vector<Translation,NDIM> l(0);
+            keyT key(0,l);
+            while (true) {
+                const mnodeT* p = find(key);
+                if (!p) return 0;
+                if (p->offset >= 0 || !p->has_children) return p;
+                for (std::size_t d=0; d<NDIM; ++d) {
+                    double xd = x[d]*2.0;
+                    int ld = int(xd);
+                    if (ld == 2) ld = 1;
+                    x[d] = xd - ld;
+                    l[d] = 2*l[d] + ld;
+                }
+                key = keyT(key.level()+1,l);
+            }
+        }
+
+    public:
+        typedef T typeT;
+
+        /// Maps the file and validates its header
+        MappedFunction(const std::string& filename)
+            : file(new detail::MappedFile(filename))
+        {
+            if (file->size() < sizeof(detail::MappedHeader))
+                MADNESS_EXCEPTION("MappedFunction: file too short", file->size());
+            header = reinterpret_cast<const detail::MappedHeader*>(file->data());
+            if (std::string(header->magic) != "MADMMAP" || header->version != detail::MAPPED_VERSION)
+                MADNESS_EXCEPTION("MappedFunction: not a mapped function file", 0);
+            if (header->type != TensorTypeData<T>::id || header->ndim != long(NDIM))
+                MADNESS_EXCEPTION("MappedFunction: file holds a different type of function", header->ndim);
+            if (std::size_t(header->data_offset) > file->size())
+                MADNESS_EXCEPTION("MappedFunction: file truncated", header->data_offset);
+
+            index = reinterpret_cast<const mnodeT*>(file->data() + header->index_offset);
+            k = header->k;
+            double volume = 1.0;
+            for (std::size_t d=0; d<NDIM; ++d) {
+                lo[d] = header->cell[2*d];
+                width[d] = header->cell[2*d+1] - header->cell[2*d];
+                volume *= width[d];
+            }
+            rvolume = 1.0/std::sqrt(volume);
+        }
+
+        /// Returns the wavelet order
+        int get_k() const { return k; }
+
+        /// Returns the number of nodes in the tree
+        std::size_t size() const { return header->nnode; }
+
+        /// Returns the index entry for key or null if absent
+        const mnodeT* find(const keyT& key) const {
+            const mnodeT* end = index + header->nnode;
+            const mnodeT* p = std::lower_bound(index, end, key);
+            return (p != end && *p == key) ? p : 0;
+        }
+
+        /// Returns the k^NDIM scaling coefficients of a leaf (pointing into the mapping) or null
+        const T* coeff(const mnodeT* p) const {
+            if (!p || p->offset < 0) return 0;
+            return reinterpret_cast<const T*>(file->data() + p->offset);
+        }
+
+        /// Returns a copy of the coefficients of a leaf as a tensor
+        Tensor<T> coeff_tensor(const mnodeT* p) const {
+            std::vector<long> dims(NDIM, k);
+            Tensor<T> c(dims);
+            const T* src = coeff(p);
+            MADNESS_ASSERT(src);
+            std::copy(src, src+c.size(), c.ptr());
+            return c;
+        }
+
+        /// Evaluates the function at a point in user coordinates
+        T operator()(const coordT& xuser) const {
+            coordT x;
+            for (std::size_t d=0; d<NDIM; ++d) {
+                x[d] = (xuser[d] - lo[d])/width[d];
+                MADNESS_ASSERT(x[d]>=0.0 && x[d]<=1.0);
+            }
+            const mnodeT* p = find_leaf(x);
+            if (!p || p->offset < 0) return T(0.0);
+            return eval_box(p->n, x, coeff(p));
+        }
+
+        /// Evaluates the function on a regular grid of points (as Function::eval_cube)
+
+        /// @param[in] cell The region (user coordinates) to be plotted
+        /// @param[in] npt The number of points in each dimension
+        Tensor<T> eval_cube(const Tensor<double>& cell, const std::vector<long>& npt) const {
+            MADNESS_ASSERT(static_cast<std::size_t>(cell.dim(0))>=NDIM && cell.dim(1)==2 && npt.size()>=NDIM);
+            Tensor<T> r(NDIM, &npt[0]);
+
+            // Same grid as Function::eval_cube, moved infinitesimally
+            // inside dyadic points so that the same leaves are chosen
+            const double eps=1e-14;
+            coordT simlo, h;
+            for (std::size_t d=0; d<NDIM; ++d) {
+                simlo[d] = (cell(d,0) - lo[d])/width[d];
+                double simhi = (cell(d,1) - lo[d])/width[d];
+                MADNESS_ASSERT(simhi >= simlo[d] && simlo[d] >= 0.0 && simhi <= 1.0);
+                const double delta = eps*(simhi-simlo[d]);
+                simlo[d] += delta;
+                simhi -= 2*delta;
+                h[d] = (npt[d] > 1) ? (simhi-simlo[d])/(npt[d]-1) : 0.0;
+            }
+
+            // Consecutive points usually fall in the same leaf
+            const mnodeT* last = 0;
+            coordT boxlo, boxhi;
+            long i = 0;
+            for (IndexIterator it(NDIM, &npt[0]); it; ++it, ++i) {
+                coordT x;
+                for (std::size_t d=0; d<NDIM; ++d) x[d] = simlo[d] + h[d]*it[d];
+                bool inside = last;
+                for (std::size_t d=0; d<NDIM && inside; ++d) inside = (x[d] >= boxlo[d] && x[d] <= boxhi[d]);
+                if (inside) {
+                    const double twon = std::pow(2.0, double(last->n));
+                    for (std::size_t d=0; d<NDIM; ++d) x[d] = x[d]*twon - last->l[d];
+                }
+                else {
+                    last = find_leaf(x);
+                    if (last) {
+                        const double fac = std::pow(0.5, double(last->n));
+                        for (std::size_t d=0; d<NDIM; ++d) {
+                            boxlo[d] = fac*last->l[d];
+                            boxhi[d] = boxlo[d] + fac;
+                        }
+                    }
+                }
+                r.ptr()[i] = (last && last->offset >= 0) ? eval_box(last->n, x, coeff(last)) : T(0.0);
+            }
+            return r;
+        }
+
+        /// Returns the 2-norm of the function
+        double norm2() const {
+            const long n = long(std::pow(double(k), double(NDIM)));
+            double sum = 0.0;
+            for (long i=0; i<header->nnode; ++i) {
+                const T* c = coeff(index+i);
+                if (c) for (long j=0; j<n; ++j) sum += std::norm(c[j]);
+            }
+            return std::sqrt(sum);
+        }
+    };
+
+    /// Returns the inner product of two mapped functions
+
+    /// Where one tree is deeper than the other the leaf of the shallow
+    /// tree is projected onto the children with the two-scale relation.
+    template <typename T, typename R, std::size_t NDIM>
+    TENSOR_RESULT_TYPE(T,R) inner(const MappedFunction<T,NDIM>& f, const MappedFunction<R,NDIM>& g) {
+        typedef TENSOR_RESULT_TYPE(T,R) resultT;
+        MADNESS_ASSERT(f.get_k() == g.get_k());
+        const int k = f.get_k();
+        const long n = long(std::pow(double(k), double(NDIM)));
+        const Tensor<double>& hgsonly = FunctionCommonData<double,NDIM>::get(k).hgsonly;
+
+        // Key, plus the coefficients of f and g if projected from a parent
+        typedef std::tuple< Key<NDIM>, Tensor<T>, Tensor<R> > itemT;
+        std::vector<itemT> stack(1, itemT(Key<NDIM>(0), Tensor<T>(), Tensor<R>()));
+        resultT sum = resultT(0.0);
+        while (stack.size()) {
+            const Key<NDIM> key = std::get<0>(stack.back());
+            const Tensor<T> fc = std::get<1>(stack.back());
+            const Tensor<R> gc = std::get<2>(stack.back());
+            stack.pop_back();
+
+            const typename detail::MappedNode<NDIM>* fp = fc.has_data() ? 0 : f.find(key);
+            const typename detail::MappedNode<NDIM>* gp = gc.has_data() ? 0 : g.find(key);
+            const T* fptr = fc.has_data() ? fc.ptr() : f.coeff(fp);
+            const R* gptr = gc.has_data() ? gc.ptr() : g.coeff(gp);
+
+            if (fptr && gptr) {
+                for (long i=0; i<n; ++i) sum += conditional_conj(fptr[i])*gptr[i];
+            }
+            else if (fptr || gptr) {
+                // One is a leaf ... only go further if the other has children
+                const bool fkids = fp && fp->has_children;
+                const bool gkids = gp && gp->has_children;
+                if (!(fkids || gkids)) continue;
+                Tensor<T> fs = fptr ? transform(fc.has_data() ? fc : f.coeff_tensor(fp), hgsonly) : Tensor<T>();
+                Tensor<R> gs = gptr ? transform(gc.has_data() ? gc : g.coeff_tensor(gp), hgsonly) : Tensor<R>();
+                for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
+                    std::vector<Slice> s(NDIM);
+                    for (std::size_t d=0; d<NDIM; ++d) {
+                        const long lo = (kit.key().translation()[d]&1)*k; // Lowest bit of translation
+                        s[d] = Slice(lo, lo+k-1);
+                    }
+                    stack.push_back(itemT(kit.key(),
+                                          fs.has_data() ? copy(fs(s)) : Tensor<T>(),
+                                          gs.has_data() ? copy(gs(s)) : Tensor<R>()));
+                }
+            }
+            else if (fp && gp && fp->has_children && gp->has_children) {
+                for (KeyChildIterator<NDIM> kit(key); kit; ++kit)
+                    stack.push_back(itemT(kit.key(), Tensor<T>(), Tensor<R>()));
+            }
+        }
+        return sum;
+    }
+
+}
+
+#endif // MADNESS_MRA_MAPPEDFUNCTION_H__INCLUDED
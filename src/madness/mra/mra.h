@@ -70,6 +70,7 @@ namespace madness {
 #include <madness/mra/funcdefaults.h>
 #include <madness/mra/function_factory.h>
 #include <madness/mra/lbdeux.h>
+#include <madness/mra/sfcpmap.h>
 #include <madness/mra/funcimpl.h>
 
 // some forward declarations
@@ -671,6 +672,34 @@ namespace madness {
         }
 
 
+        /// Stores the coefficients in reduced precision to save memory.  No communication.
+
+        /// The format of each node is the smallest (8 or 16 bit block-scaled
+        /// integers, or single precision) whose error is at most
+        /// FunctionDefaults<NDIM>::get_pack_tol() times the truncation
+        /// threshold of the node; nodes for which none is accurate enough
+        /// are left as they are.  Coefficients are widened back to full
+        /// precision when they are next used, and archives keep them packed.
+        Function<T,NDIM>& pack(bool fence = true) {
+            PROFILE_MEMBER_FUNC(Function);
+            if (!impl) return *this;
+            impl->pack(FunctionDefaults<NDIM>::get_pack_tol(), FunctionDefaults<NDIM>::get_pack_scaled(), fence);
+            return *this;
+        }
+
+
+        /// Widens packed coefficients to full precision.  No communication.
+
+        /// Only needed to do all of the widening at once, since
+        /// coefficients are otherwise widened when they are used.
+        const Function<T,NDIM>& unpack(bool fence = true) const {
+            PROFILE_MEMBER_FUNC(Function);
+            if (!impl) return *this;
+            impl->unpack(fence);
+            return *this;
+        }
+
+
         /// Compresses the function, transforming into wavelet basis.  Possible non-blocking comm.
 
         /// By default fence=true meaning that this operation completes before returning,
@@ -682,11 +711,19 @@ namespace madness {
         ///
         /// Since reconstruction/compression do not discard information we define them
         /// as const ... "logical constness" not "bitwise constness".
-        const Function<T,NDIM>& compress(bool fence = true) const {
+        ///
+        /// If \c by_level is true the tree is compressed one level at a time
+        /// with batched filters and one exchange of messages per level
+        /// (FunctionImpl::compress_by_level), which is faster for wide and
+        /// shallow trees.  This is collective and always fences.
+        const Function<T,NDIM>& compress(bool fence = true, bool by_level = false) const {
             PROFILE_MEMBER_FUNC(Function);
             if (!impl || is_compressed()) return *this;
             if (VERIFY_TREE) verify_tree();
-            const_cast<Function<T,NDIM>*>(this)->impl->compress(false, false, false, fence);
+            if (by_level)
+                const_cast<Function<T,NDIM>*>(this)->impl->compress_by_level(false, false);
+            else
+                const_cast<Function<T,NDIM>*>(this)->impl->compress(false, false, false, fence);
             return *this;
         }
 
@@ -735,10 +772,16 @@ namespace madness {
         ///
         /// Since reconstruction/compression do not discard information we define them
         /// as const ... "logical constness" not "bitwise constness".
-        const Function<T,NDIM>& reconstruct(bool fence = true) const {
+        ///
+        /// If \c by_level is true the tree is reconstructed one level at a
+        /// time, cf compress.  This is collective and always fences.
+        const Function<T,NDIM>& reconstruct(bool fence = true, bool by_level = false) const {
             PROFILE_MEMBER_FUNC(Function);
             if (!impl || !is_compressed()) return *this;
-            const_cast<Function<T,NDIM>*>(this)->impl->reconstruct(fence);
+            if (by_level)
+                const_cast<Function<T,NDIM>*>(this)->impl->reconstruct_by_level();
+            else
+                const_cast<Function<T,NDIM>*>(this)->impl->reconstruct(fence);
             if (fence && VERIFY_TREE) verify_tree(); // Must be after in case nonstandard
             return *this;
         }
@@ -2416,6 +2459,7 @@ namespace madness {
 #include <madness/mra/operator.h>
 #include <madness/mra/functypedefs.h>
 #include <madness/mra/vmra.h>
+#include <madness/mra/checkpoint.h>
 // #include <madness/mra/mraimpl.h> !!!!!!!!!!!!! NOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOO  !!!!!!!!!!!!!!!!!!
 
 #endif // MADNESS_MRA_MRA_H__INCLUDED
@@ -1173,6 +1173,16 @@ namespace madness {
         flo_unary_op_node_inplace(do_reduce_rank(targs),fence);
     }
 
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::pack(double fac, bool scaled, bool fence) {
+        flo_unary_op_node_inplace(do_pack(this,fac,scaled),fence);
+    }
+
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::unpack(bool fence) {
+        flo_unary_op_node_inplace(do_unpack(),fence);
+    }
+
 
     /// Transform sum coefficients at level n to sums+differences at level n-1
 
@@ -1636,6 +1646,7 @@ namespace madness {
         //PROFILE_MEMBER_FUNC(FunctionImpl);
 
         MADNESS_ASSERT(not redundant);
+        LBCostTimer<NDIM> lbtimer(key);
         double cpu0=cpu_time();
         // Copy child scaling coeffs into contiguous block
         tensorT d(cdata.v2k);
@@ -1847,7 +1858,7 @@ namespace madness {
         typename dcT::const_iterator end = coeffs.end();
         for (typename dcT::const_iterator it=coeffs.begin(); it!=end; ++it) {
             const nodeT& node = it->second;
-            if (node.has_coeff()) sum+=node.coeff().real_size();
+            sum+=node.real_size();
         }
         world.gop.sum(sum);
         return sum;
@@ -3074,6 +3085,543 @@ namespace madness {
         }
     }
 
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::compress_by_level(bool nonstandard, bool keepleaves) {
+        MADNESS_ASSERT(not is_redundant());
+        this->compressed = true;
+        this->nonstandard = nonstandard;
+        this->redundant = false;
+        world.gop.fence();
+
+        std::vector< std::vector<keyT> > levels;
+        for (typename dcT::iterator it=coeffs.begin(); it!=coeffs.end(); ++it) {
+            const std::size_t n = it->first.level();
+            if (levels.size() <= n) levels.resize(n+1);
+            levels[n].push_back(it->first);
+        }
+        long nlevel = levels.size();
+        world.gop.max(nlevel);
+        levels.resize(nlevel);
+
+        const std::size_t nbatch = 16;
+        for (long n=nlevel-1; n>=0; --n) {
+            std::vector< Future< std::vector< std::pair<keyT,tensorT> > > > batches;
+            for (std::size_t i=0; i<levels[n].size(); i+=nbatch) {
+                const std::vector<keyT> keys(levels[n].begin()+i,
+                                             levels[n].begin()+std::min(i+nbatch, levels[n].size()));
+                batches.push_back(woT::task(world.rank(), &implT::compress_level_op, keys, nonstandard, keepleaves));
+            }
+
+            // One message per process with the sum coefficients for all its parents
+            std::map< ProcessID, std::vector< std::pair<keyT,tensorT> > > out;
+            for (std::size_t b=0; b<batches.size(); ++b) {
+                const std::vector< std::pair<keyT,tensorT> >& sums = batches[b].get();
+                for (std::size_t i=0; i<sums.size(); ++i)
+                    out[coeffs.owner(sums[i].first.parent())].push_back(sums[i]);
+            }
+            for (typename std::map< ProcessID, std::vector< std::pair<keyT,tensorT> > >::const_iterator it=out.begin();
+                 it!=out.end(); ++it) {
+                if (it->first == world.rank())
+                    accumulate_child_sums(it->second);
+                else
+                    woT::send(it->first, &implT::accumulate_child_sums, it->second);
+            }
+            world.gop.fence();
+        }
+    }
+
+    template <typename T, std::size_t NDIM>
+    std::vector< std::pair<Key<NDIM>,Tensor<T> > >
+    FunctionImpl<T,NDIM>::compress_level_op(const std::vector<keyT>& keys, bool nonstandard, bool keepleaves) {
+        std::vector< std::pair<keyT,tensorT> > result;
+        std::vector<keyT> interior;
+        std::vector<tensorT> d;
+        for (std::size_t i=0; i<keys.size(); ++i) {
+            nodeT& node = coeffs.find(keys[i]).get()->second;
+            if (node.has_children()) {
+                typename ConcurrentHashMap<keyT,tensorT>::accessor acc;
+                if (level_sums.find(acc, keys[i])) {
+                    d.push_back(acc->second);
+                    level_sums.erase(acc);
+                }
+                else {
+                    d.push_back(tensorT(cdata.v2k));
+                }
+                interior.push_back(keys[i]);
+            }
+            else {
+                if (keys[i].level() > 0 && node.has_coeff())
+                    result.push_back(std::make_pair(keys[i], node.coeff().full_tensor_copy()));
+                if (!keepleaves) node.clear_coeff();
+            }
+        }
+        if (interior.empty()) return result;
+
+        d = vtransform(d, cdata.hgT);
+
+        // tighter thresh for internal nodes
+        TensorArgs targs2=targs;
+        targs2.thresh*=0.1;
+
+        for (std::size_t j=0; j<interior.size(); ++j) {
+            typename dcT::accessor acc;
+            MADNESS_ASSERT(coeffs.find(acc, interior[j]));
+
+            if (acc->second.has_coeff()) {
+                const tensorT c = acc->second.coeff().full_tensor_copy();
+                if (c.dim(0) == k) {
+                    d[j](cdata.s0) += c;
+                }
+                else {
+                    d[j] += c;
+                }
+            }
+
+            if (interior[j].level() > 0) {
+                result.push_back(std::make_pair(interior[j], copy(d[j](cdata.s0))));
+                if (!nonstandard) d[j](cdata.s0) = 0.0;
+            }
+            acc->second.set_coeff(coeffT(d[j],targs2));
+        }
+        return result;
+    }
+
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::accumulate_child_sums(const std::vector< std::pair<keyT,tensorT> >& batch) {
+        for (std::size_t i=0; i<batch.size(); ++i) {
+            const keyT& child = batch[i].first;
+            typename ConcurrentHashMap<keyT,tensorT>::accessor acc;
+            if (level_sums.insert(acc, child.parent())) acc->second = tensorT(cdata.v2k);
+            acc->second(child_patch(child)) += batch[i].second;
+        }
+    }
+
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::reconstruct_by_level() {
+        MADNESS_ASSERT(not is_redundant());
+        nonstandard = compressed = redundant = false;
+        world.gop.fence();
+
+        if (world.rank() == coeffs.owner(cdata.key0)) {
+            typename ConcurrentHashMap<keyT,tensorT>::accessor acc;
+            level_sums.insert(acc, cdata.key0);
+        }
+
+        const std::size_t nbatch = 16;
+        while (true) {
+            // The nodes of this level with the sum coefficients from their parents
+            std::vector< std::pair<keyT,tensorT> > nodes;
+            for (typename ConcurrentHashMap<keyT,tensorT>::iterator it=level_sums.begin(); it!=level_sums.end(); ++it)
+                nodes.push_back(std::make_pair(it->first, it->second));
+            level_sums.clear();
+            long nnode = nodes.size();
+            world.gop.sum(nnode);
+            if (nnode == 0) break;
+
+            std::vector< Future< std::vector< std::pair<keyT,tensorT> > > > batches;
+            for (std::size_t i=0; i<nodes.size(); i+=nbatch) {
+                const std::vector< std::pair<keyT,tensorT> > batch(nodes.begin()+i,
+                                                                   nodes.begin()+std::min(i+nbatch, nodes.size()));
+                batches.push_back(woT::task(world.rank(), &implT::reconstruct_level_op, batch));
+            }
+
+            std::map< ProcessID, std::vector< std::pair<keyT,tensorT> > > out;
+            for (std::size_t b=0; b<batches.size(); ++b) {
+                const std::vector< std::pair<keyT,tensorT> >& sums = batches[b].get();
+                for (std::size_t i=0; i<sums.size(); ++i)
+                    out[coeffs.owner(sums[i].first)].push_back(sums[i]);
+            }
+            for (typename std::map< ProcessID, std::vector< std::pair<keyT,tensorT> > >::const_iterator it=out.begin();
+                 it!=out.end(); ++it) {
+                if (it->first == world.rank())
+                    store_parent_sums(it->second);
+                else
+                    woT::send(it->first, &implT::store_parent_sums, it->second);
+            }
+            world.gop.fence();
+        }
+    }
+
+    template <typename T, std::size_t NDIM>
+    std::vector< std::pair<Key<NDIM>,Tensor<T> > >
+    FunctionImpl<T,NDIM>::reconstruct_level_op(const std::vector< std::pair<keyT,tensorT> >& nodes) {
+        std::vector<keyT> interior;
+        std::vector<tensorT> d;
+        for (std::size_t i=0; i<nodes.size(); ++i) {
+            const keyT& key = nodes[i].first;
+            const tensorT& s = nodes[i].second;
+
+            // As in reconstruct_op not all siblings may be present
+            typename dcT::iterator it = coeffs.find(key).get();
+            if (it == coeffs.end()) {
+                coeffs.replace(key,nodeT(coeffT(),false));
+                it = coeffs.find(key).get();
+            }
+            nodeT& node = it->second;
+
+            if (node.has_children() && !node.has_coeff()) {
+                node.set_coeff(coeffT(cdata.v2k,targs));
+            }
+
+            if (node.has_children() || node.has_coeff()) {
+                coeffT c = node.coeff();
+                if (key.level() > 0 && s.has_data()) c(cdata.s0) += s;
+                if (c.dim(0) == 2*k) {
+                    interior.push_back(key);
+                    d.push_back(c.full_tensor_copy());
+                    node.clear_coeff();
+                    node.set_has_children(true);
+                }
+                else {
+                    MADNESS_ASSERT(node.is_leaf());
+                }
+            }
+            else {
+                node.set_coeff(s.has_data() ? coeffT(s,targs) : coeffT(cdata.vk,targs));
+            }
+        }
+
+        std::vector< std::pair<keyT,tensorT> > result;
+        if (interior.empty()) return result;
+
+        d = vtransform(d, cdata.hg);
+
+        for (std::size_t j=0; j<interior.size(); ++j) {
+            for (KeyChildIterator<NDIM> kit(interior[j]); kit; ++kit) {
+                const keyT& child = kit.key();
+                result.push_back(std::make_pair(child, copy(d[j](child_patch(child)))));
+            }
+        }
+        return result;
+    }
+
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::store_parent_sums(const std::vector< std::pair<keyT,tensorT> >& batch) {
+        for (std::size_t i=0; i<batch.size(); ++i) {
+            typename ConcurrentHashMap<keyT,tensorT>::accessor acc;
+            level_sums.insert(acc, batch[i].first);
+            acc->second = batch[i].second;
+        }
+    }
+
+    template <typename T, std::size_t NDIM>
+    std::vector<typename FunctionImpl<T,NDIM>::tensorT>
+    FunctionImpl<T,NDIM>::vtransform(const std::vector<tensorT>& d, const Tensor<double>& c) const {
+        const long nf = d.size();
+        const long n = c.dim(0);
+        const long size = d[0].size();
+
+        // Interleave so that the function index is the fastest varying
+        const long len = size*nf;
+        tensorT a(1,&len,false), w(1,&len,false);
+        T* MADNESS_RESTRICT pa = a.ptr();
+        for (long i=0; i<nf; ++i) {
+            MADNESS_ASSERT(d[i].iscontiguous() && d[i].size()==size);
+            const T* pd = d[i].ptr();
+            for (long p=0; p<size; ++p) pa[p*nf+i] = pd[p];
+        }
+
+        // Each step transforms the leading dimension and moves it to the
+        // end, so after NDIM steps the function index leads again
+        T* t0 = a.ptr();
+        T* t1 = w.ptr();
+        for (std::size_t step=0; step<NDIM; ++step) {
+            mTxmq(len/n, n, n, t1, t0, c.ptr());
+            std::swap(t0,t1);
+        }
+
+        std::vector<tensorT> r(nf);
+        for (long i=0; i<nf; ++i) {
+            r[i] = tensorT(d[i].ndim(), d[i].dims(), false);
+            std::copy(t0+i*size, t0+(i+1)*size, r[i].ptr());
+        }
+        return r;
+    }
+
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::vcompress(const std::vector<implT*>& v, bool fence) {
+        for (std::size_t i=0; i<v.size(); ++i) {
+            MADNESS_ASSERT(not v[i]->is_redundant());
+            MADNESS_ASSERT(v[i]->coeffs.get_pmap() == coeffs.get_pmap() && v[i]->get_k() == k);
+            // Must set true here so that successive calls without fence do the right thing
+            v[i]->compressed = true;
+            v[i]->nonstandard = v[i]->redundant = false;
+        }
+        if (world.rank() == coeffs.owner(cdata.key0)) vcompress_spawn(v, cdata.key0);
+        if (fence) world.gop.fence();
+    }
+
+    template <typename T, std::size_t NDIM>
+    Future< std::vector<typename FunctionImpl<T,NDIM>::coeffT> >
+    FunctionImpl<T,NDIM>::vcompress_spawn(const std::vector<implT*>& v, const keyT& key) {
+        std::vector<coeffT> s(v.size());
+        std::vector<implT*> interior;
+        for (std::size_t i=0; i<v.size(); ++i) {
+            nodeT& node = v[i]->coeffs.find(key).get()->second;
+            if (node.has_children()) {
+                interior.push_back(v[i]);
+            }
+            else {
+                s[i] = node.coeff();
+                node.clear_coeff();
+            }
+        }
+        if (interior.empty()) return Future< std::vector<coeffT> >(s);
+
+        std::vector< Future< std::vector<coeffT> > > children = future_vector_factory< std::vector<coeffT> >(1<<NDIM);
+        int i=0;
+        for (KeyChildIterator<NDIM> kit(key); kit; ++kit,++i) {
+            children[i] = woT::task(coeffs.owner(kit.key()), &implT::vcompress_spawn, interior, kit.key(),
+                                    TaskAttributes::hipri());
+        }
+        return woT::task(world.rank(), &implT::vcompress_op, v, key, s, children);
+    }
+
+    template <typename T, std::size_t NDIM>
+    std::vector<typename FunctionImpl<T,NDIM>::coeffT>
+    FunctionImpl<T,NDIM>::vcompress_op(const std::vector<implT*>& v, const keyT& key, const std::vector<coeffT>& s,
+                                       const std::vector< Future< std::vector<coeffT> > >& children) {
+        LBCostTimer<NDIM> lbtimer(key);
+
+        // Copy child scaling coeffs of the interior functions into contiguous blocks
+        std::vector<std::size_t> interior;
+        std::vector<tensorT> d;
+        for (std::size_t i=0; i<v.size(); ++i) {
+            if (!v[i]->coeffs.find(key).get()->second.has_children()) continue;
+            tensorT di(cdata.v2k);
+            int c=0;
+            for (KeyChildIterator<NDIM> kit(key); kit; ++kit,++c) {
+                const coeffT& child = children[c].get()[interior.size()];
+                if (child.has_data()) di(child_patch(kit.key())) += child.full_tensor_copy();
+            }
+            interior.push_back(i);
+            d.push_back(di);
+        }
+
+        d = vtransform(d, cdata.hgT);
+
+        // tighter thresh for internal nodes
+        TensorArgs targs2=targs;
+        targs2.thresh*=0.1;
+
+        std::vector<coeffT> result(s);
+        for (std::size_t j=0; j<interior.size(); ++j) {
+            typename dcT::accessor acc;
+            MADNESS_ASSERT(v[interior[j]]->coeffs.find(acc, key));
+
+            if (acc->second.has_coeff()) {
+                const tensorT c = acc->second.coeff().full_tensor_copy();
+                if (c.dim(0) == k) {
+                    d[j](cdata.s0) += c;
+                }
+                else {
+                    d[j] += c;
+                }
+            }
+
+            // need the deep copy for contiguity
+            result[interior[j]] = coeffT(copy(d[j](cdata.s0)),targs2);
+            if (key.level() > 0) d[j](cdata.s0) = 0.0;
+            acc->second.set_coeff(coeffT(d[j],targs2));
+        }
+        return result;
+    }
+
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::vreconstruct(const std::vector<implT*>& v, bool fence) {
+        for (std::size_t i=0; i<v.size(); ++i) {
+            MADNESS_ASSERT(not v[i]->is_redundant() && not v[i]->is_nonstandard());
+            MADNESS_ASSERT(v[i]->coeffs.get_pmap() == coeffs.get_pmap() && v[i]->get_k() == k);
+            // Must set false here so that successive calls without fence do the right thing
+            v[i]->compressed = false;
+        }
+        if (world.rank() == coeffs.owner(cdata.key0))
+            woT::task(world.rank(), &implT::vreconstruct_op, v, cdata.key0, std::vector<coeffT>(v.size()));
+        if (fence) world.gop.fence();
+    }
+
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::vreconstruct_op(const std::vector<implT*>& v, const keyT& key, const std::vector<coeffT>& s) {
+        std::vector<implT*> interior;
+        std::vector<tensorT> d;
+        for (std::size_t i=0; i<v.size(); ++i) {
+            // As in reconstruct_op not all siblings may be present
+            typename dcT::iterator it = v[i]->coeffs.find(key).get();
+            if (it == v[i]->coeffs.end()) {
+                v[i]->coeffs.replace(key,nodeT(coeffT(),false));
+                it = v[i]->coeffs.find(key).get();
+            }
+            nodeT& node = it->second;
+
+            if (node.has_children() && !node.has_coeff()) {
+                node.set_coeff(coeffT(cdata.v2k,targs));
+            }
+
+            if (node.has_children() || node.has_coeff()) {
+                coeffT c = node.coeff();
+                if (key.level() > 0 && s[i].has_data()) c(cdata.s0) += s[i];
+                if (c.dim(0) == 2*k) {
+                    interior.push_back(v[i]);
+                    d.push_back(c.full_tensor());
+                    node.clear_coeff();
+                    node.set_has_children(true);
+                }
+                else {
+                    MADNESS_ASSERT(node.is_leaf());
+                }
+            }
+            else {
+                coeffT ss=s[i];
+                if (ss.has_no_data()) ss=coeffT(cdata.vk,targs);
+                if (key.level()) node.set_coeff(copy(ss));
+                else node.set_coeff(ss);
+            }
+        }
+        if (interior.empty()) return;
+
+        d = vtransform(d, cdata.hg);
+
+        for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
+            const keyT& child = kit.key();
+            const std::vector<Slice> cp = child_patch(child);
+            std::vector<coeffT> ss(interior.size());
+            for (std::size_t j=0; j<interior.size(); ++j) ss[j] = coeffT(copy(d[j](cp)),targs);
+            woT::task(coeffs.owner(child), &implT::vreconstruct_op, interior, child, ss);
+        }
+    }
+
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::vnorm_tree(const std::vector<implT*>& v, bool fence) {
+        for (std::size_t i=0; i<v.size(); ++i) {
+            MADNESS_ASSERT(v[i]->coeffs.get_pmap() == coeffs.get_pmap());
+        }
+        if (world.rank() == coeffs.owner(cdata.key0)) vnorm_tree_spawn(v, cdata.key0);
+        if (fence) world.gop.fence();
+    }
+
+    template <typename T, std::size_t NDIM>
+    Future< std::vector<double> > FunctionImpl<T,NDIM>::vnorm_tree_spawn(const std::vector<implT*>& v, const keyT& key) {
+        std::vector<double> norms(v.size(), 0.0);
+        std::vector<implT*> interior;
+        for (std::size_t i=0; i<v.size(); ++i) {
+            nodeT& node = v[i]->coeffs.find(key).get()->second;
+            if (node.has_children()) {
+                interior.push_back(v[i]);
+            }
+            else {
+                norms[i] = node.coeff().normf();
+                node.set_norm_tree(norms[i]);
+            }
+        }
+        if (interior.empty()) return Future< std::vector<double> >(norms);
+
+        std::vector< Future< std::vector<double> > > children = future_vector_factory< std::vector<double> >(1<<NDIM);
+        int i=0;
+        for (KeyChildIterator<NDIM> kit(key); kit; ++kit,++i) {
+            children[i] = woT::task(coeffs.owner(kit.key()), &implT::vnorm_tree_spawn, interior, kit.key());
+        }
+        return woT::task(world.rank(), &implT::vnorm_tree_op, v, key, norms, children);
+    }
+
+    template <typename T, std::size_t NDIM>
+    std::vector<double> FunctionImpl<T,NDIM>::vnorm_tree_op(const std::vector<implT*>& v, const keyT& key,
+                                                            const std::vector<double>& norms,
+                                                            const std::vector< Future< std::vector<double> > >& children) {
+        std::vector<double> result(norms);
+        std::size_t j=0;
+        for (std::size_t i=0; i<v.size(); ++i) {
+            if (!v[i]->coeffs.find(key).get()->second.has_children()) continue;
+            double sum = 0.0;
+            for (int c=0; c<(1<<NDIM); ++c) {
+                const double value = children[c].get()[j];
+                sum += value*value;
+            }
+            result[i] = sqrt(sum);
+            v[i]->coeffs.task(key, &nodeT::set_norm_tree, result[i]);
+            ++j;
+        }
+        return result;
+    }
+
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::vtruncate(const std::vector<implT*>& v, double tol, bool fence) {
+        for (std::size_t i=0; i<v.size(); ++i) {
+            MADNESS_ASSERT(v[i]->is_compressed());
+            MADNESS_ASSERT(v[i]->coeffs.get_pmap() == coeffs.get_pmap());
+        }
+        if (world.rank() == coeffs.owner(cdata.key0)) vtruncate_spawn(v, cdata.key0, tol);
+        if (fence) world.gop.fence();
+    }
+
+    template <typename T, std::size_t NDIM>
+    Future< std::vector<bool> > FunctionImpl<T,NDIM>::vtruncate_spawn(const std::vector<implT*>& v, const keyT& key, double tol) {
+        std::vector<bool> hascoeff(v.size(), false);
+        std::vector<implT*> interior;
+        for (std::size_t i=0; i<v.size(); ++i) {
+            // As in truncate_spawn make missing nodes empty leaves
+            typename dcT::iterator it = v[i]->coeffs.find(key).get();
+            if (it == v[i]->coeffs.end()) {
+                v[i]->coeffs.replace(key,nodeT());
+                it = v[i]->coeffs.find(key).get();
+            }
+            nodeT& node = it->second;
+            if (node.has_children()) {
+                interior.push_back(v[i]);
+            }
+            else {
+                if (node.has_coeff() && key.level()>1) {
+                    const double ftol = (tol > 0.0) ? tol : v[i]->thresh;
+                    if (node.coeff().normf() < v[i]->truncate_tol(ftol,key)) node.clear_coeff();
+                }
+                hascoeff[i] = node.has_coeff();
+            }
+        }
+        if (interior.empty()) return Future< std::vector<bool> >(hascoeff);
+
+        std::vector< Future< std::vector<bool> > > children = future_vector_factory< std::vector<bool> >(1<<NDIM);
+        int i=0;
+        for (KeyChildIterator<NDIM> kit(key); kit; ++kit,++i) {
+            children[i] = woT::task(coeffs.owner(kit.key()), &implT::vtruncate_spawn, interior, kit.key(), tol,
+                                    TaskAttributes::generator());
+        }
+        return woT::task(world.rank(), &implT::vtruncate_op, v, key, tol, hascoeff, children);
+    }
+
+    template <typename T, std::size_t NDIM>
+    std::vector<bool> FunctionImpl<T,NDIM>::vtruncate_op(const std::vector<implT*>& v, const keyT& key, double tol,
+                                                         const std::vector<bool>& hascoeff,
+                                                         const std::vector< Future< std::vector<bool> > >& children) {
+        std::vector<bool> result(hascoeff);
+        std::size_t j=0;
+        for (std::size_t i=0; i<v.size(); ++i) {
+            nodeT& node = v[i]->coeffs.find(key).get()->second;
+            if (!node.has_children()) continue;
+
+            // If any child has coefficients, a parent cannot truncate
+            bool childcoeff = false;
+            for (int c=0; c<(1<<NDIM); ++c) childcoeff = childcoeff || children[c].get()[j];
+            ++j;
+            if (childcoeff) {
+                result[i] = true;
+                continue;
+            }
+
+            if (!node.has_coeff()) node.set_coeff(coeffT(cdata.v2k,targs));
+            if (key.level() > 1) {
+                const double ftol = (tol > 0.0) ? tol : v[i]->thresh;
+                if (node.coeff().normf() < v[i]->truncate_tol(ftol,key)) {
+                    node.clear_coeff();
+                    node.set_has_children(false);
+                    for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
+                        v[i]->coeffs.erase(kit.key());
+                    }
+                }
+            }
+            result[i] = node.has_coeff();
+        }
+        return result;
+    }
+
     template <typename T, std::size_t NDIM>
     void FunctionImpl<T,NDIM>::plot_cube_kernel(archive::archive_ptr< Tensor<T> > ptr,
                                                 const keyT& key,
@@ -3298,6 +3846,12 @@ namespace madness {
         truncate_on_project = true;
         apply_randomize = false;
         project_randomize = false;
+        apply_batched = true;
+        inner_tiled = true;
+        fused_traversal = true;
+        pack_tol = 0.1;
+        pack_scaled = true;
+        apply_mixed_precision = false;
         bc = BoundaryConditions<NDIM>(BC_FREE);
         tt = TT_FULL;
         cell = Tensor<double>(NDIM,2);
@@ -3324,6 +3878,12 @@ namespace madness {
     		std::cout << "             truncate_on_project" <<  ": " << truncate_on_project << std::endl;
     		std::cout << "                 apply_randomize" <<  ": " << apply_randomize << std::endl;
     		std::cout << "               project_randomize" <<  ": " << project_randomize << std::endl;
+    		std::cout << "                   apply_batched" <<  ": " << apply_batched << std::endl;
+    		std::cout << "                     inner_tiled" <<  ": " << inner_tiled << std::endl;
+    		std::cout << "                 fused_traversal" <<  ": " << fused_traversal << std::endl;
+    		std::cout << "                        pack_tol" <<  ": " << pack_tol << std::endl;
+    		std::cout << "                     pack_scaled" <<  ": " << pack_scaled << std::endl;
+    		std::cout << "           apply_mixed_precision" <<  ": " << apply_mixed_precision << std::endl;
     		std::cout << "                              bc" <<  ": " << bc << std::endl;
     		std::cout << "                              tt" <<  ": " << tt << std::endl;
     		std::cout << "                            cell" <<  ": " << cell << std::endl;
@@ -3344,6 +3904,12 @@ namespace madness {
     template <std::size_t NDIM> bool FunctionDefaults<NDIM>::truncate_on_project;
     template <std::size_t NDIM> bool FunctionDefaults<NDIM>::apply_randomize;
     template <std::size_t NDIM> bool FunctionDefaults<NDIM>::project_randomize;
+    template <std::size_t NDIM> bool FunctionDefaults<NDIM>::apply_batched;
+    template <std::size_t NDIM> bool FunctionDefaults<NDIM>::inner_tiled;
+    template <std::size_t NDIM> bool FunctionDefaults<NDIM>::fused_traversal;
+    template <std::size_t NDIM> double FunctionDefaults<NDIM>::pack_tol;
+    template <std::size_t NDIM> bool FunctionDefaults<NDIM>::pack_scaled;
+    template <std::size_t NDIM> bool FunctionDefaults<NDIM>::apply_mixed_precision;
     template <std::size_t NDIM> BoundaryConditions<NDIM> FunctionDefaults<NDIM>::bc;
     template <std::size_t NDIM> TensorType FunctionDefaults<NDIM>::tt;
     template <std::size_t NDIM> Tensor<double> FunctionDefaults<NDIM>::cell;
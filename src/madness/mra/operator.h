@@ -37,6 +37,9 @@
 
 /// \ingroup function
 
+#include <atomic>
+#include <cfloat>
+#include <memory>
 #include <type_traits>
 #include <limits.h>
 #include <madness/mra/adquad.h>
@@ -52,6 +55,50 @@
 
 namespace madness {
 
+    /// Counts and sampled errors of the mixed precision apply of one operator
+
+    /// One in \c SAMPLE of the terms applied in single precision is also
+    /// applied in double to measure the error, which is recorded relative
+    /// to the error the term was allowed.
+    struct MixedPrecisionStats {
+        static const long SAMPLE = 64;
+        std::atomic<long> nhigh;    ///< Terms applied in double
+        std::atomic<long> nlow;     ///< Terms applied in single precision
+        long nsample;               ///< Terms whose error was measured
+        double maxerr, sumsq;       ///< Max and sum of squares of the measured relative errors
+        Mutex mutex;
+
+        MixedPrecisionStats() : nhigh(0), nlow(0), nsample(0), maxerr(0.0), sumsq(0.0) {}
+
+        /// Copies of an operator start with no statistics
+        MixedPrecisionStats(const MixedPrecisionStats&) : MixedPrecisionStats() {}
+
+        MixedPrecisionStats& operator=(const MixedPrecisionStats&) {
+            return *this;
+        }
+
+        /// Counts a single precision term and returns true if its error should be measured
+        bool sample() {
+            return (nlow++ % SAMPLE) == 0;
+        }
+
+        void record(double err, double allowed) {
+            const double relerr = (allowed > 0.0) ? err/allowed : 0.0;
+            ScopedMutex<Mutex> lock(mutex);
+            ++nsample;
+            maxerr = std::max(maxerr, relerr);
+            sumsq += relerr*relerr;
+        }
+
+        void reset() {
+            ScopedMutex<Mutex> lock(mutex);
+            nhigh = 0;
+            nlow = 0;
+            nsample = 0;
+            maxerr = sumsq = 0.0;
+        }
+    };
+
     /// SeparatedConvolutionInternal keeps data for 1 term and all dimensions and 1 displacement
     /// Why is this here?? Why don't you just use ConvolutionND in SeparatedConvolutionData??
     template <typename Q, std::size_t NDIM>
@@ -83,7 +130,7 @@ namespace madness {
     I think it works like this:
     We try to apply transition matrices to the compressed form of function coefficients.
     Most of the code is about caching these transition matrices. They are cached (key of the map is the displacement)
-    in the SimpleCache "data", which is of type SeparatedConvolutionData, which keeps the matrices
+    in the DenseCache "data", which is of type SeparatedConvolutionData, which keeps the matrices
     for all separated terms and dimensions. These SeparatedConvolutionData are constructed using
     ConvolutionND "ops", which is constructed at the construction of the SeparatedConvolution.
 
@@ -91,7 +138,7 @@ namespace madness {
 
                     construction                                            storage
 
-                                                                    SimpleCache<SeparatedConvolutionData>
+                                                                    DenseCache<SeparatedConvolutionData>
                                                                         (all terms, all dim) / (all disp)
              vector<ConvolutionND>
              (1 term, all dim) / (all terms)
@@ -145,8 +192,9 @@ namespace madness {
         const std::vector<Slice> s0;
 
         // SeparatedConvolutionData keeps data for all terms and all dimensions and 1 displacement
-        mutable SimpleCache< SeparatedConvolutionData<Q,NDIM>, NDIM > data; ///< cache for all terms, dims and displacements
+        mutable DenseCache< SeparatedConvolutionData<Q,NDIM>, NDIM > data; ///< cache for all terms, dims and displacements
         mutable SimpleCache< SeparatedConvolutionData<Q,NDIM>, 2*NDIM > mod_data; ///< cache for all terms, dims and displacements
+        mutable MixedPrecisionStats mixed_stats; ///< what the mixed precision apply did and how well
 
     public:
 
@@ -179,6 +227,54 @@ namespace madness {
             const Q* VT;
         };
 
+        /// Single precision copies of one input block and work space for apply_transformation_low
+        struct LowPrecisionWork {
+            Tensor<float> f, f0;        // the input and its scaling function block
+            double fnorm, f0norm;
+            Tensor<float> work1, work2;
+            Tensor<float> M;            // one matrix of a term, converted on the fly
+
+            LowPrecisionWork(const Tensor<double>& f, const Tensor<double>& f0, const std::vector<long>& vr)
+                : f(f.ndim(),f.dims(),false), f0(f0.ndim(),f0.dims(),false)
+                , fnorm(f.normf()), f0norm(f0.normf())
+                , work1(vr,false), work2(vr,false), M(f.dim(0)*f.dim(0)) {
+                copy_to_float(f.size(), f.ptr(), this->f.ptr());
+                copy_to_float(f0.size(), f0.ptr(), this->f0.ptr());
+            }
+        };
+
+        /// True if a term with this relative tolerance per dimension may be applied in single precision
+
+        /// The rounding error of the transformation grows like the square
+        /// root of the number of multiply-adds per element and must stay
+        /// below the error the term is allowed anyway.  Measured errors are
+        /// typically a tenth of that bound.
+        static bool low_precision_ok(double tol, long dimk) {
+            return NDIM*tol >= std::sqrt(2.0*NDIM*dimk)*FLT_EPSILON;
+        }
+
+        static void copy_to_float(long n, const double* a, float* MADNESS_RESTRICT b) {
+            for (long i=0; i<n; ++i) b[i] = float(a[i]);
+        }
+
+        template <typename X>
+        static void copy_to_float(long, const X*, float*) {
+            MADNESS_EXCEPTION("mixed precision apply is only for real operators", 0);
+        }
+
+        /// Returns the single precision work for an input block, or null if not applying in mixed precision
+        template <typename T>
+        std::unique_ptr<LowPrecisionWork> make_low_precision_work(const Tensor<T>&, const Tensor<T>&) const {
+            return std::unique_ptr<LowPrecisionWork>();
+        }
+
+        std::unique_ptr<LowPrecisionWork> make_low_precision_work(const Tensor<double>& f,
+                                                                  const Tensor<double>& f0) const {
+            if (!std::is_same<Q,double>::value || !FunctionDefaults<NDIM>::get_apply_mixed_precision())
+                return std::unique_ptr<LowPrecisionWork>();
+            return std::unique_ptr<LowPrecisionWork>(new LowPrecisionWork(f, f0, modified() ? vk : v2k));
+        }
+
 //        /// return the right block of the upsampled operator (modified NS only)
 //
 //        /// unlike the operator matrices on the natural level the upsampled operator
@@ -275,6 +371,95 @@ namespace madness {
         }
 
 
+        /// accumulate into result, transforming in single precision
+
+        /// Same as apply_transformation but on the single precision copy of
+        /// the input, with the matrices converted as they are needed.
+        template <typename R>
+        void apply_transformation_low(long dimk,
+                                      const Transformation trans[NDIM],
+                                      const Tensor<float>& f,
+                                      LowPrecisionWork& low,
+                                      const Q mufac,
+                                      Tensor<R>& result) const {
+            long size = 1;
+            for (std::size_t i=0; i<NDIM; ++i) size *= dimk;
+            long dimi = size/dimk;
+
+            float* MADNESS_RESTRICT w1=low.work1.ptr();
+            float* MADNESS_RESTRICT w2=low.work2.ptr();
+            float* MADNESS_RESTRICT m=low.M.ptr();
+
+            // U has leading dimension dimk of which the first r columns are used
+            for (long i=0; i<dimk; ++i) copy_to_float(trans[0].r, trans[0].U+i*dimk, m+i*trans[0].r);
+            mTxmq(dimi, trans[0].r, dimk, w1, f.ptr(), m);
+
+            size = trans[0].r * size / dimk;
+            dimi = size/dimk;
+            for (std::size_t d=1; d<NDIM; ++d) {
+                for (long i=0; i<dimk; ++i) copy_to_float(trans[d].r, trans[d].U+i*dimk, m+i*trans[d].r);
+                mTxmq(dimi, trans[d].r, dimk, w2, w1, m);
+                size = trans[d].r * size / dimk;
+                dimi = size/dimk;
+                std::swap(w1,w2);
+            }
+
+            bool doit = false;
+            for (std::size_t d=0; d<NDIM; ++d) doit = doit || trans[d].VT;
+
+            if (doit) {
+                for (std::size_t d=0; d<NDIM; ++d) {
+                    if (trans[d].VT) {
+                        dimi = size/trans[d].r;
+                        copy_to_float(trans[d].r*dimk, trans[d].VT, m);
+                        mTxmq(dimi, dimk, trans[d].r, w2, w1, m);
+                        size = dimk*size/trans[d].r;
+                    }
+                    else {
+                        fast_transpose(dimk, dimi, w1, w2);
+                    }
+                    std::swap(w1,w2);
+                }
+            }
+
+            R* MADNESS_RESTRICT p = result.ptr();
+            for (long i=0; i<size; ++i) p[i] += mufac*double(w1[i]);
+        }
+
+
+        /// accumulate into result, in single precision if the term allows it
+
+        /// \c tol is the error allowed relative to the norms of the operator
+        /// and the input, and \c allowed the same in absolute terms.
+        template <typename T, typename R>
+        void apply_transformation_mixed(long dimk,
+                                        const Transformation trans[NDIM],
+                                        const Tensor<T>& f,
+                                        const Tensor<float>& flow,
+                                        double tol,
+                                        double allowed,
+                                        Tensor<R>& work1,
+                                        Tensor<R>& work2,
+                                        LowPrecisionWork* low,
+                                        const Q mufac,
+                                        Tensor<R>& result) const {
+            if (!low || !low_precision_ok(tol, dimk)) {
+                if (low) ++mixed_stats.nhigh;
+                apply_transformation(dimk, trans, f, work1, work2, mufac, result);
+            }
+            else if (mixed_stats.sample()) {
+                Tensor<R> hi(result.ndim(), result.dims()), lo(result.ndim(), result.dims());
+                apply_transformation(dimk, trans, f, work1, work2, mufac, hi);
+                apply_transformation_low(dimk, trans, flow, *low, mufac, lo);
+                mixed_stats.record((hi-lo).normf(), allowed);
+                result += lo;
+            }
+            else {
+                apply_transformation_low(dimk, trans, flow, *low, mufac, result);
+            }
+        }
+
+
         /// accumulate into result
         template <typename T, typename R>
         void apply_transformation3(const Tensor<T> trans2[NDIM],
@@ -362,7 +547,8 @@ namespace madness {
                          double tol,
                          const Q mufac,
                          Tensor<TENSOR_RESULT_TYPE(T,Q)>& work1,
-                         Tensor<TENSOR_RESULT_TYPE(T,Q)>& work2) const {
+                         Tensor<TENSOR_RESULT_TYPE(T,Q)>& work2,
+                         LowPrecisionWork* low=0) const {
 
             //PROFILE_MEMBER_FUNC(SeparatedConvolution); // Too fine grain for routine profiling
             Transformation trans[NDIM];
@@ -408,7 +594,11 @@ namespace madness {
                     trans2[d]=ops_1d[d]->R;
                 }
 
-                if (!rank_is_zero)
+                if (!rank_is_zero && low)
+                    apply_transformation_mixed(twok, trans, f, low->f, tol,
+                                               tol*NDIM*Rnorm*std::abs(mufac)*low->fnorm,
+                                               work1, work2, low, mufac, result);
+                else if (!rank_is_zero)
                     apply_transformation(twok, trans, f, work1, work2, mufac, result);
 
                 //            apply_transformation2(n, twok, tol, trans2, f, work1, work2, mufac, result);
@@ -449,7 +639,11 @@ namespace madness {
                     }
                     trans2[d]=ops_1d[d]->T;
                 }
-                if (!rank_is_zero)
+                if (!rank_is_zero && low)
+                    apply_transformation_mixed(k, trans, f0, low->f0, tol,
+                                               tol*NDIM*Tnorm*std::abs(mufac)*low->f0norm,
+                                               work1, work2, low, -mufac, result0);
+                else if (!rank_is_zero)
                     apply_transformation(k, trans, f0, work1, work2, -mufac, result0);
 //                apply_transformation2(n, k, tol, trans2, f0, work1, work2, -mufac, result0);
 //                apply_transformation3(trans2, f0, -mufac, result0);
@@ -1034,6 +1228,33 @@ namespace madness {
         	}
         }
 
+        /// Returns the counts and measured errors of the mixed precision apply in this process
+        const MixedPrecisionStats& mixed_precision_stats() const {return mixed_stats;}
+
+        /// Prints the counts and measured errors of the mixed precision apply ... collective
+
+        /// Errors are relative to the error each term was allowed, so any
+        /// maximum below one is within the requested precision.
+        void print_mixed_precision_stats() const {
+            World& world = this->get_world();
+            double sum[4] = {double(mixed_stats.nhigh), double(mixed_stats.nlow),
+                             double(mixed_stats.nsample), mixed_stats.sumsq};
+            double maxerr = mixed_stats.maxerr;
+            world.gop.sum(sum, 4);
+            world.gop.max(maxerr);
+            if (world.rank()==0) {
+                const double ntot = std::max(1.0, sum[0]+sum[1]);
+                printf("mixed precision apply: %.0f terms, %.1f%% in single precision\n",
+                       sum[0]+sum[1], 100.0*sum[1]/ntot);
+                printf("          sampled %.0f terms: max error %.2e, rms error %.2e (relative to allowed)\n",
+                       sum[2], maxerr, std::sqrt(sum[3]/std::max(1.0, sum[2])));
+            }
+        }
+
+        void reset_mixed_precision_stats() const {
+            mixed_stats.reset();
+        }
+
         const BoundaryConditions<NDIM>& get_bc() const {return bc;}
 
         const std::vector< Key<NDIM> >& get_disp(Level n) const {
@@ -1160,6 +1381,7 @@ namespace madness {
             }
 
             const Tensor<T> f0 = copy(coeff(s0));
+            std::unique_ptr<LowPrecisionWork> low = make_low_precision_work(*input, f0);
             for (int mu=0; mu<rank; ++mu) {
                 // SeparatedConvolutionInternal keeps data for 1 term and all dimensions and 1 displacement
                 const SeparatedConvolutionInternal<Q,NDIM>& muop =  op->muops[mu];
@@ -1167,7 +1389,7 @@ namespace madness {
                     // ops is of ConvolutionND, returns data for 1 term and all dimensions
                     Q fac = ops[mu].getfac();
                     muopxv_fast(at, muop.ops, *input, f0, r, r0, tol/std::abs(fac), fac,
-                                work1, work2);
+                                work1, work2, low.get());
                 }
             }
 
@@ -1179,6 +1401,76 @@ namespace madness {
         }
 
 
+        /// apply this operator on coefficients in full rank form for several displacements
+
+        /// Same as calling apply() for each shift, but the padded input, the
+        /// scaling-function block and the work space of apply_transformation
+        /// are set up once for all of them.
+        /// @param[in]  source  the source key
+        /// @param[in]  shifts  the displacements, where the source coeffs come from
+        /// @param[in]  coeff   source coeffs in full rank
+        /// @param[in]  tol     thresh/#neigh*cnorm
+        /// @return     the result op(coeff) for each displacement
+        template <typename T>
+        std::vector< Tensor<TENSOR_RESULT_TYPE(T,Q)> >
+        apply_batch(const Key<NDIM>& source,
+                    const std::vector< Key<NDIM> >& shifts,
+                    const Tensor<T>& coeff,
+                    double tol) const {
+            MADNESS_ASSERT(coeff.ndim()==NDIM);
+
+            double cpu0=cpu_time();
+
+            typedef TENSOR_RESULT_TYPE(T,Q) resultT;
+            const Tensor<T>* input = &coeff;
+            Tensor<T> dummy;
+
+            if (not modified()) {
+                if (coeff.dim(0) == k) {
+                    // Leaf node with only scaling coefficients ... see apply()
+                    dummy = Tensor<T>(v2k);
+                    dummy(s0) = coeff;
+                    input = &dummy;
+                }
+                else {
+                    MADNESS_ASSERT(coeff.dim(0)==2*k);
+                }
+            }
+
+            tol = 0.01*tol/rank; // Error is per separated term
+            ApplyTerms at;
+            at.r_term=true;
+            at.t_term=(source.level()>0);
+
+            const std::vector<long>& vr = modified() ? vk : v2k;
+            Tensor<resultT> work1(vr,false), work2(vr,false);
+            const Tensor<T> f0 = copy(coeff(s0));
+            std::unique_ptr<LowPrecisionWork> low = make_low_precision_work(*input, f0);
+
+            std::vector< Tensor<resultT> > results(shifts.size());
+            for (std::size_t i=0; i<shifts.size(); ++i) {
+                const SeparatedConvolutionData<Q,NDIM>* op = getop(source.level(), shifts[i], source);
+
+                Tensor<resultT> r(vr), r0(vk);
+                for (int mu=0; mu<rank; ++mu) {
+                    const SeparatedConvolutionInternal<Q,NDIM>& muop =  op->muops[mu];
+                    if (muop.norm > tol) {
+                        Q fac = ops[mu].getfac();
+                        muopxv_fast(at, muop.ops, *input, f0, r, r0, tol/std::abs(fac), fac,
+                                    work1, work2, low.get());
+                    }
+                }
+
+                r(s0).gaxpy(1.0,r0,1.0);
+                results[i] = r;
+            }
+            double cpu1=cpu_time();
+            timer_full.accumulate(cpu1-cpu0);
+
+            return results;
+        }
+
+
         /// apply this operator on only 1 particle of the coefficients in low rank form
 
         /// note the unfortunate mess with NDIM: here NDIM is the operator dimension, and FDIM is the
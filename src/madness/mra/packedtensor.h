@@ -0,0 +1,210 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_MRA_PACKEDTENSOR_H__INCLUDED
+#define MADNESS_MRA_PACKEDTENSOR_H__INCLUDED
+
+/*!
+	\file packedtensor.h
+	\brief Reduced-precision storage of the coefficients of a node
+	\ingroup mra
+
+	Function::pack() replaces the coefficients of each node by a
+	PackedTensor whose error is below a fraction
+	(FunctionDefaults::get_pack_tol()) of the truncation threshold of
+	the node.  Nodes widen back to full precision the first time their
+	coefficients are used, so packed functions may be used anywhere.
+*/
+
+#include <madness/tensor/tensor.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace madness {
+    namespace detail {
+
+        /// Coefficients held in single precision or as block-scaled integers
+
+        /// The format is the smallest whose bound on the Frobenius
+        /// norm of the error is below the tolerance given to the
+        /// constructor: 8 or 16 bit integers with one scale per block
+        /// of \c blocksize real values, or single precision.  If none
+        /// is accurate enough the format is FULL, nothing is stored and
+        /// the caller keeps the original tensor.  Complex values are
+        /// packed as pairs of reals.
+        template <typename T>
+        class PackedTensor {
+        public:
+            enum Format {FULL=0, FP32=1, INT16=2, INT8=3};
+            static const long blocksize = 64;
+
+        private:
+            typedef typename TensorTypeData<T>::scalar_type scalarT;
+            static const long nscalar = sizeof(T)/sizeof(scalarT); ///< Real values per element
+
+            int format;
+            std::vector<long> dims;
+            std::vector<unsigned char> data;
+
+            /// Bound on the error of rounding to integers in [-qmax,qmax] scaled per block
+            static double scaled_error(const scalarT* x, long n, double qmax) {
+                double sum = 0.0;
+                for (long lo=0; lo<n; lo+=blocksize) {
+                    const long hi = std::min(n, lo+blocksize);
+                    double amax = 0.0;
+                    for (long i=lo; i<hi; ++i) amax = std::max(amax, double(std::abs(x[i])));
+                    const double half = 0.5*amax/qmax;
+                    sum += half*half*(hi-lo);
+                }
+                return std::sqrt(sum);
+            }
+
+            /// Bound on the error of rounding to single precision
+            static double fp32_error(const scalarT* x, long n) {
+                double sum = 0.0, amax = 0.0;
+                for (long i=0; i<n; ++i) {
+                    const double a = std::abs(x[i]);
+                    sum += a*a;
+                    amax = std::max(amax, a);
+                }
+                if (amax > 0.5*std::numeric_limits<float>::max()) return 1e300;
+                return std::sqrt(sum)*std::numeric_limits<float>::epsilon()*0.5;
+            }
+
+            template <typename intT>
+            void pack_scaled(const scalarT* x, long n, double qmax) {
+                const long nblock = (n+blocksize-1)/blocksize;
+                data.resize(nblock*sizeof(float) + n*sizeof(intT));
+                float* scale = reinterpret_cast<float*>(&data[0]);
+                intT* q = reinterpret_cast<intT*>(&data[nblock*sizeof(float)]);
+                for (long b=0, lo=0; b<nblock; ++b, lo+=blocksize) {
+                    const long hi = std::min(n, lo+blocksize);
+                    double amax = 0.0;
+                    for (long i=lo; i<hi; ++i) amax = std::max(amax, double(std::abs(x[i])));
+                    scale[b] = float(amax/qmax);
+                    const double rscale = (scale[b] > 0.0f) ? 1.0/scale[b] : 0.0;
+                    for (long i=lo; i<hi; ++i) {
+                        const double v = std::max(-qmax, std::min(qmax, std::round(x[i]*rscale)));
+                        q[i] = intT(v);
+                    }
+                }
+            }
+
+            template <typename intT>
+            void unpack_scaled(scalarT* x, long n) const {
+                const long nblock = (n+blocksize-1)/blocksize;
+                const float* scale = reinterpret_cast<const float*>(&data[0]);
+                const intT* q = reinterpret_cast<const intT*>(&data[nblock*sizeof(float)]);
+                for (long b=0, lo=0; b<nblock; ++b, lo+=blocksize) {
+                    const long hi = std::min(n, lo+blocksize);
+                    const double s = scale[b];
+                    for (long i=lo; i<hi; ++i) x[i] = scalarT(s*q[i]);
+                }
+            }
+
+        public:
+            PackedTensor() : format(FULL) {}
+
+            /// Packs t with error at most tol, allowing the integer formats if scaled is true
+            PackedTensor(const Tensor<T>& t, double tol, bool scaled) : format(FULL) {
+                if (!t.has_data()) return;
+                const Tensor<T> c = t.iscontiguous() ? t : copy(t);
+                const scalarT* x = reinterpret_cast<const scalarT*>(c.ptr());
+                const long n = c.size()*nscalar;
+
+                if (scaled && scaled_error(x, n, 127.0) <= tol) format = INT8;
+                else if (scaled && scaled_error(x, n, 32767.0) <= tol) format = INT16;
+                else if (sizeof(scalarT) > sizeof(float) && fp32_error(x, n) <= tol) format = FP32;
+                else return;
+
+                dims.assign(c.dims(), c.dims()+c.ndim());
+                if (format == FP32) {
+                    data.resize(n*sizeof(float));
+                    float* p = reinterpret_cast<float*>(&data[0]);
+                    for (long i=0; i<n; ++i) p[i] = float(x[i]);
+                }
+                else if (format == INT16) {
+                    pack_scaled<int16_t>(x, n, 32767.0);
+                }
+                else {
+                    pack_scaled<int8_t>(x, n, 127.0);
+                }
+            }
+
+            /// Returns the format (FULL if the tensor was not packed)
+            int get_format() const {
+                return format;
+            }
+
+            /// Returns the number of elements of the tensor
+            long size() const {
+                long n = 1;
+                for (std::size_t i=0; i<dims.size(); ++i) n *= dims[i];
+                return (format == FULL) ? 0 : n;
+            }
+
+            /// Returns the number of bytes used including this object
+            std::size_t real_size() const {
+                return sizeof(*this) + dims.size()*sizeof(long) + data.size();
+            }
+
+            /// Returns a new tensor with the coefficients in the precision of T
+            Tensor<T> unpack() const {
+                MADNESS_ASSERT(format != FULL);
+                Tensor<T> t(long(dims.size()), &dims[0], false);
+                scalarT* x = reinterpret_cast<scalarT*>(t.ptr());
+                const long n = t.size()*nscalar;
+                if (format == FP32) {
+                    const float* p = reinterpret_cast<const float*>(&data[0]);
+                    for (long i=0; i<n; ++i) x[i] = scalarT(p[i]);
+                }
+                else if (format == INT16) {
+                    unpack_scaled<int16_t>(x, n);
+                }
+                else {
+                    unpack_scaled<int8_t>(x, n);
+                }
+                return t;
+            }
+
+            template <typename Archive>
+            void serialize(Archive& ar) {
+                ar & format & dims & data;
+            }
+        };
+
+    }
+}
+
+#endif // MADNESS_MRA_PACKEDTENSOR_H__INCLUDED
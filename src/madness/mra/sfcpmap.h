@@ -0,0 +1,255 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_MRA_SFCPMAP_H__INCLUDED
+#define MADNESS_MRA_SFCPMAP_H__INCLUDED
+
+/*!
+	\file sfcpmap.h
+	\brief Process map that gives each process a segment of a space-filling curve
+	\ingroup mra
+
+	The hashing process maps (WorldDCDefaultPmap, SimplePmap and
+	LevelPmap) scatter neighboring boxes over all processes, so nearly
+	every neighbor accessed by apply() or diff() is remote.  SFCPmap
+	orders the boxes at a partition level \c n along a Hilbert (or
+	Morton) curve and gives each process a contiguous segment of the
+	curve, so that neighbors are mostly on the same process.  Boxes
+	finer than \c n belong to their ancestor at level \c n, and boxes
+	coarser than \c n to the process holding the start of their
+	segment of the curve.
+
+	The segments are either of equal length or chosen to give each
+	process equal cost, e.g., with the cost functors of LoadBalanceDeux:
+	\code
+	FunctionDefaults<3>::set_pmap(pmap_3d(new SFCPmap<3>(world)));
+
+	FunctionDefaults<3>::redistribute(world,
+	    make_sfc_pmap(world, orbitals, LBMeasuredCost<double,3>(1.0,8.0)));
+	\endcode
+*/
+
+#include <madness/world/MADworld.h>
+#include <madness/mra/key.h>
+#include <algorithm>
+#include <stdint.h>
+#include <vector>
+
+namespace madness {
+
+    template <typename T, std::size_t NDIM> class Function;
+
+    /// Process map assigning contiguous segments of a space-filling curve to each process
+    template <std::size_t NDIM>
+    class SFCPmap : public WorldDCPmapInterface< Key<NDIM> > {
+    public:
+        enum Curve {MORTON, HILBERT};
+
+    private:
+        typedef Key<NDIM> keyT;
+
+        int nproc;
+        Level n;                    ///< The partition level
+        Curve curve;
+        std::vector<uint64_t> start; ///< start[p] is the first cell owned by p
+
+        /// Transforms coordinates of b bits in place so that interleaving gives the Hilbert index
+
+        /// J. Skilling, "Programming the Hilbert curve", AIP Conf. Proc. 707, 381 (2004).
+        /// The top bits of the result depend only on the top bits of the
+        /// input so a parent's index is the prefix of its children's.
+        static void hilbert_transpose(uint64_t* x, int b) {
+            const uint64_t m = uint64_t(1) << (b-1);
+            for (uint64_t q=m; q>1; q>>=1) {
+                const uint64_t p = q-1;
+                for (std::size_t i=0; i<NDIM; ++i) {
+                    if (x[i] & q) {
+                        x[0] ^= p;
+                    }
+                    else {
+                        const uint64_t t = (x[0]^x[i]) & p;
+                        x[0] ^= t;
+                        x[i] ^= t;
+                    }
+                }
+            }
+            for (std::size_t i=1; i<NDIM; ++i) x[i] ^= x[i-1];
+            uint64_t t = 0;
+            for (uint64_t q=m; q>1; q>>=1) {
+                if (x[NDIM-1] & q) t ^= q-1;
+            }
+            for (std::size_t i=0; i<NDIM; ++i) x[i] ^= t;
+        }
+
+        /// Returns the position along the curve of the box (level,l) among boxes at that level
+        uint64_t curve_index(Level level, const Vector<Translation,NDIM>& l) const {
+            if (level == 0) return 0;
+            uint64_t x[NDIM];
+            for (std::size_t i=0; i<NDIM; ++i) x[i] = l[i];
+            if (curve == HILBERT) hilbert_transpose(x, level);
+            uint64_t index = 0;
+            for (int bit=level-1; bit>=0; --bit) {
+                for (std::size_t i=0; i<NDIM; ++i) index = (index<<1) | ((x[i]>>bit) & 1);
+            }
+            return index;
+        }
+
+        void set_uniform() {
+            const uint64_t ncell = size();
+            start.resize(nproc);
+            for (int p=0; p<nproc; ++p)
+                start[p] = (ncell/nproc)*p + std::min(uint64_t(p), ncell%nproc);
+        }
+
+        void set_weighted(const std::vector<double>& cost) {
+            MADNESS_ASSERT(cost.size() == size());
+            double total = 0.0;
+            for (std::size_t i=0; i<cost.size(); ++i) total += cost[i];
+            if (total <= 0.0) {
+                set_uniform();
+                return;
+            }
+
+            // Each segment starts where the cumulative cost reaches its share
+            start.assign(nproc, cost.size());
+            start[0] = 0;
+            double sum = 0.0;
+            int p = 1;
+            for (std::size_t i=0; i<cost.size() && p<nproc; ++i) {
+                while (p < nproc && sum >= total*p/nproc) start[p++] = i;
+                sum += cost[i];
+            }
+        }
+
+        void init(int np, Curve c, int level) {
+            nproc = np;
+            curve = c;
+            n = (level < 0) ? default_level(nproc) : level;
+            MADNESS_ASSERT(n >= 0 && n*NDIM < 63);
+        }
+
+    public:
+        /// Returns the smallest partition level with at least 64 cells per process (at most 2^24 cells)
+        static Level default_level(int nproc) {
+            Level level = 0;
+            while ((uint64_t(1) << (NDIM*level)) < uint64_t(64)*nproc && NDIM*(level+1) <= 24) ++level;
+            return level;
+        }
+
+        /// Equal numbers of cells per process
+
+        /// @param[in] world The world whose processes are mapped
+        /// @param[in] curve The space-filling curve
+        /// @param[in] level The partition level (default from the number of processes)
+        SFCPmap(World& world, Curve curve=HILBERT, int level=-1) {
+            init(world.size(), curve, level);
+            set_uniform();
+        }
+
+        /// Equal numbers of cells per process for a given number of processes
+        SFCPmap(int nproc, Curve curve=HILBERT, int level=-1) {
+            init(nproc, curve, level);
+            set_uniform();
+        }
+
+        /// Equal cost per process
+
+        /// @param[in] nproc The number of processes
+        /// @param[in] cost The cost of each cell at the partition level in curve order (same on all processes)
+        /// @param[in] curve The space-filling curve
+        /// @param[in] level The partition level (the size of cost must be 2^(NDIM*level))
+        SFCPmap(int nproc, const std::vector<double>& cost, Curve curve, int level) {
+            init(nproc, curve, level);
+            set_weighted(cost);
+        }
+
+        /// Returns the number of cells at the partition level
+        uint64_t size() const {
+            return uint64_t(1) << (NDIM*n);
+        }
+
+        /// Returns the partition level
+        Level get_level() const {
+            return n;
+        }
+
+        /// Returns the cell at the partition level (in curve order) containing or starting the box
+        uint64_t cell(const keyT& key) const {
+            const Level level = key.level();
+            if (level >= n) {
+                Vector<Translation,NDIM> l = key.translation();
+                for (std::size_t i=0; i<NDIM; ++i) l[i] >>= (level-n);
+                return curve_index(n, l);
+            }
+            return curve_index(level, key.translation()) << (NDIM*(n-level));
+        }
+
+        /// Returns the process owning a cell
+        ProcessID cell_owner(uint64_t c) const {
+            return ProcessID(std::upper_bound(start.begin(), start.end(), c) - start.begin()) - 1;
+        }
+
+        ProcessID owner(const keyT& key) const {
+            return cell_owner(cell(key));
+        }
+
+        void print() const {
+            madness::print("SFCPmap:", (curve == HILBERT) ? "Hilbert" : "Morton",
+                           "curve at level", n, "over", nproc, "processes");
+        }
+    };
+
+    /// Makes an SFCPmap giving each process equal cost ... collective
+
+    /// The cost of each box of the functions is computed by
+    /// <tt>costfn(key,node)</tt> on the owner of the box, as for
+    /// LoadBalanceDeux::add_tree(), and charged to its cell.
+    template <typename T, std::size_t NDIM, typename costT>
+    std::shared_ptr< WorldDCPmapInterface< Key<NDIM> > >
+    make_sfc_pmap(World& world, const std::vector< Function<T,NDIM> >& f, const costT& costfn,
+                  typename SFCPmap<NDIM>::Curve curve=SFCPmap<NDIM>::HILBERT, int level=-1) {
+        const SFCPmap<NDIM> uniform(world.size(), curve, level);
+        std::vector<double> cost(uniform.size(), 0.0);
+        world.gop.fence();
+        for (std::size_t i=0; i<f.size(); ++i) {
+            const typename Function<T,NDIM>::implT::dcT& coeffs = f[i].get_impl()->get_coeffs();
+            for (auto it=coeffs.begin(); it!=coeffs.end(); ++it) {
+                cost[uniform.cell(it->first)] += costfn(it->first, it->second);
+            }
+        }
+        world.gop.sum(&cost[0], cost.size());
+        return std::shared_ptr< WorldDCPmapInterface< Key<NDIM> > >(
+            new SFCPmap<NDIM>(world.size(), cost, curve, uniform.get_level()));
+    }
+
+}
+
+#endif // MADNESS_MRA_SFCPMAP_H__INCLUDED
@@ -34,6 +34,7 @@
 #define MADNESS_MRA_SIMPLECACHE_H__INCLUDED
 
 #include <madness/mra/key.h>
+#include <atomic>
 
 namespace madness {
     /// Simplified interface around hash_map to cache stuff for 1D
@@ -101,6 +102,181 @@ namespace madness {
             Key<NDIM> key(n,disp.translation());
             set(key, val);
         }
+
+        /// Calls op(key,value) for each cached element ... not thread safe against set()
+        template <typename opT>
+        void for_each(const opT& op) const {
+            for (typename mapT::const_iterator it=cache.begin(); it!=cache.end(); ++it) {
+                op(it->first, it->second);
+            }
+        }
+    };
+
+
+    /// Write once cache for 1D and displacement keys with lock free lookup
+
+    /// Elements at levels below \c maxlevel whose translations are all in
+    /// [-radius,radius] are held in a table indexed directly by level
+    /// and translation, so that a lookup is an index computation and
+    /// one atomic load instead of a hash and a lock.  The table of a
+    /// level is allocated when its first element is set, and a value
+    /// is published by a compare-and-swap of its slot so that readers
+    /// see either nothing or the complete value.  Other keys go to a
+    /// SimpleCache.  As for SimpleCache, subsequent writes of an
+    /// element have no effect.
+    template <typename Q, std::size_t NDIM>
+    class DenseCache {
+    private:
+        static const int maxlevel = 64;
+        typedef std::atomic<const Q*> slotT;
+
+        Translation radius;
+        std::size_t nslot;              ///< Number of slots per level
+        std::atomic<slotT*> table[maxlevel];
+        SimpleCache<Q,NDIM> overflow;
+
+        /// Returns the largest radius with at most 8192 slots per level (and at most 128)
+        static Translation default_radius() {
+            Translation r = 128;
+            while (r > 1) {
+                std::size_t n = 1;
+                for (std::size_t d=0; d<NDIM; ++d) n *= 2*r+1;
+                if (n <= 8192) break;
+                --r;
+            }
+            return r;
+        }
+
+        /// Computes the slot of the element or returns false if it is not in the table
+        bool index(Level n, const Vector<Translation,NDIM>& l, std::size_t& i) const {
+            if (n < 0 || n >= maxlevel) return false;
+            i = 0;
+            for (std::size_t d=NDIM; d-->0; ) {
+                if (l[d] < -radius || l[d] > radius) return false;
+                i = i*(2*radius+1) + (l[d] + radius);
+            }
+            return true;
+        }
+
+        /// Returns the table of a level, allocating it if necessary
+        slotT* level_table(Level n) {
+            slotT* t = table[n].load(std::memory_order_acquire);
+            if (t) return t;
+            slotT* fresh = new slotT[nslot];
+            for (std::size_t i=0; i<nslot; ++i) fresh[i].store(0, std::memory_order_relaxed);
+            if (table[n].compare_exchange_strong(t, fresh, std::memory_order_acq_rel)) return fresh;
+            delete [] fresh;        // Another thread allocated it first
+            return t;
+        }
+
+        const Q* find(Level n, const Vector<Translation,NDIM>& l) const {
+            std::size_t i;
+            if (!index(n, l, i)) return overflow.getptr(Key<NDIM>(n,l));
+            const slotT* t = table[n].load(std::memory_order_acquire);
+            if (!t) return 0;
+            return t[i].load(std::memory_order_acquire);
+        }
+
+        void insert(Level n, const Vector<Translation,NDIM>& l, const Q& val) {
+            std::size_t i;
+            if (!index(n, l, i)) {
+                overflow.set(Key<NDIM>(n,l), val);
+                return;
+            }
+            slotT* t = level_table(n);
+            if (t[i].load(std::memory_order_acquire)) return;
+            const Q* expected = 0;
+            const Q* p = new Q(val);
+            if (!t[i].compare_exchange_strong(expected, p, std::memory_order_acq_rel)) delete p;
+        }
+
+        void init(Translation r) {
+            radius = r;
+            nslot = 1;
+            for (std::size_t d=0; d<NDIM; ++d) nslot *= 2*radius+1;
+            for (int n=0; n<maxlevel; ++n) table[n].store(0, std::memory_order_relaxed);
+        }
+
+        void clear() {
+            for (int n=0; n<maxlevel; ++n) {
+                slotT* t = table[n].load(std::memory_order_acquire);
+                if (!t) continue;
+                for (std::size_t i=0; i<nslot; ++i) delete t[i].load(std::memory_order_relaxed);
+                delete [] t;
+                table[n].store(0, std::memory_order_relaxed);
+            }
+            overflow = SimpleCache<Q,NDIM>();
+        }
+
+    public:
+        /// Makes an empty cache with a table for translations in [-radius,radius]
+        explicit DenseCache(Translation radius=default_radius()) {
+            init(radius);
+        }
+
+        DenseCache(const DenseCache& c) {
+            init(c.radius);
+            c.for_each([this](const Key<NDIM>& key, const Q& val) {this->set(key, val);});
+        }
+
+        DenseCache& operator=(const DenseCache& c) {
+            if (this != &c) {
+                clear();
+                init(c.radius);
+                c.for_each([this](const Key<NDIM>& key, const Q& val) {this->set(key, val);});
+            }
+            return *this;
+        }
+
+        ~DenseCache() {
+            clear();
+        }
+
+        /// If key is present return pointer to cached value, otherwise return NULL
+        inline const Q* getptr(const Key<NDIM>& key) const {
+            return find(key.level(), key.translation());
+        }
+
+        /// If key=(n,l) is present return pointer to cached value, otherwise return NULL
+        inline const Q* getptr(Level n, Translation l) const {
+            return find(n, Vector<Translation,NDIM>(l));
+        }
+
+        /// If key=(n,disp) is present return pointer to cached value, otherwise return NULL
+        inline const Q* getptr(Level n, const Key<NDIM>& disp) const {
+            return find(n, disp.translation());
+        }
+
+        /// Set value associated with key ... gives ownership of a new copy to the container
+        inline void set(const Key<NDIM>& key, const Q& val) {
+            insert(key.level(), key.translation(), val);
+        }
+
+        inline void set(Level n, Translation l, const Q& val) {
+            insert(n, Vector<Translation,NDIM>(l), val);
+        }
+
+        inline void set(Level n, const Key<NDIM>& disp, const Q& val) {
+            insert(n, disp.translation(), val);
+        }
+
+        /// Calls op(key,value) for each cached element
+        template <typename opT>
+        void for_each(const opT& op) const {
+            for (int n=0; n<maxlevel; ++n) {
+                const slotT* t = table[n].load(std::memory_order_acquire);
+                if (!t) continue;
+                for (std::size_t i=0; i<nslot; ++i) {
+                    const Q* p = t[i].load(std::memory_order_acquire);
+                    if (!p) continue;
+                    Vector<Translation,NDIM> l;
+                    std::size_t j = i;
+                    for (std::size_t d=0; d<NDIM; ++d, j/=(2*radius+1)) l[d] = Translation(j%(2*radius+1)) - radius;
+                    op(Key<NDIM>(n,l), *p);
+                }
+            }
+            overflow.for_each(op);
+        }
     };
 }
 #endif // MADNESS_MRA_SIMPLECACHE_H__INCLUDED
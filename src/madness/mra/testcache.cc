@@ -0,0 +1,159 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file testcache.cc
+/// \brief Times lookups in SimpleCache and DenseCache from many threads
+
+/// Usage: testcache [nthread] [nrep]
+///
+/// Each thread runs through the same keys as the convolution caches
+/// see them (levels 0-9 and small displacements) starting at a
+/// different offset, and sets the element if it is not yet present.
+/// The first pass fills the cache concurrently and later passes only
+/// read it.  Every value is checked.
+
+#include <madness/mra/mra.h>
+#include <cstdio>
+#include <cstdlib>
+#include <sched.h>
+
+using namespace madness;
+
+static AtomicInt ngo;    // Threads wait for this to be set
+static AtomicInt ndone;  // Number of threads that have finished
+static AtomicInt nerr;   // Number of incorrect values seen
+
+template <std::size_t NDIM>
+double value(const Key<NDIM>& key) {
+    double v = key.level();
+    for (std::size_t d=0; d<NDIM; ++d) v += 1e-3*(d+1)*key.translation()[d];
+    return v;
+}
+
+template <std::size_t NDIM>
+std::vector< Key<NDIM> > make_keys(Translation radius) {
+    std::vector< Key<NDIM> > keys;
+    const Translation m = 2*radius+1;
+    Translation ntot = 1;
+    for (std::size_t d=0; d<NDIM; ++d) ntot *= m;
+    for (Level n=0; n<10; ++n) {
+        for (Translation i=0; i<ntot; ++i) {
+            Vector<Translation,NDIM> l;
+            Translation j = i;
+            for (std::size_t d=0; d<NDIM; ++d, j/=m) l[d] = j%m - radius;
+            keys.push_back(Key<NDIM>(n,l));
+        }
+    }
+    return keys;
+}
+
+template <typename cacheT, std::size_t NDIM>
+class Worker : public ThreadBase {
+    cacheT& cache;
+    const std::vector< Key<NDIM> >& keys;
+    const long nrep;
+    const std::size_t offset;
+
+public:
+    Worker(cacheT& cache, const std::vector< Key<NDIM> >& keys, long nrep, std::size_t offset)
+        : ThreadBase(), cache(cache), keys(keys), nrep(nrep), offset(offset) {
+        start();
+    }
+
+    void run() {
+        while (ngo == 0) sched_yield();
+        const std::size_t nkey = keys.size();
+        long err = 0;
+        for (long rep=0; rep<nrep; ++rep) {
+            for (std::size_t i=0; i<nkey; ++i) {
+                const Key<NDIM>& key = keys[(i+offset)%nkey];
+                const double* p = cache.getptr(key);
+                if (!p) {
+                    cache.set(key, value(key));
+                    p = cache.getptr(key);
+                }
+                if (!p || *p != value(key)) ++err;
+            }
+        }
+        nerr += err;
+        ndone++;
+    }
+};
+
+/// Returns the wall time for nthread threads to make nrep passes over the keys
+template <typename cacheT, std::size_t NDIM>
+double time_cache(const std::vector< Key<NDIM> >& keys, int nthread, long nrep) {
+    cacheT cache;
+    ngo = 0;
+    ndone = 0;
+    // The threads are detached so they are not deleted here
+    for (int i=0; i<nthread; ++i)
+        new Worker<cacheT,NDIM>(cache, keys, nrep, (keys.size()*i)/nthread);
+    const double start = wall_time();
+    ngo = 1;
+    while (ndone != nthread) sched_yield();
+    return wall_time() - start;
+}
+
+template <std::size_t NDIM>
+void compare(Translation radius, int nthread, long nrep) {
+    const std::vector< Key<NDIM> > keys = make_keys<NDIM>(radius);
+    const double tsimple = time_cache<SimpleCache<double,NDIM>,NDIM>(keys, nthread, nrep);
+    const double tdense = time_cache<DenseCache<double,NDIM>,NDIM>(keys, nthread, nrep);
+    const double nlookup = double(keys.size())*nrep*nthread;
+    printf("%4d %8d %8ld %12.3f %12.3f %12.1f %12.1f %8.2f\n", int(NDIM), int(keys.size()), nrep,
+           tsimple, tdense, 1e9*tsimple/nlookup, 1e9*tdense/nlookup, tsimple/tdense);
+}
+
+int main(int argc, char** argv) {
+    initialize(argc, argv);
+    const int nthread = (argc > 1) ? std::atoi(argv[1]) : 64;
+    const long nrep = (argc > 2) ? std::atol(argv[2]) : 10;
+
+    print("threads", nthread);
+    printf("%4s %8s %8s %12s %12s %12s %12s %8s\n", "ndim", "nkey", "nrep",
+           "simple(s)", "dense(s)", "simple(ns)", "dense(ns)", "speedup");
+    nerr = 0;
+    compare<1>(100, nthread, nrep);
+    compare<3>(4, nthread, nrep);
+    compare<6>(1, nthread, nrep);
+
+    // Keys outside the dense table go to the fallback
+    const std::vector< Key<1> > far = make_keys<1>(300);
+    time_cache<DenseCache<double,1>,1>(far, nthread, 1);
+
+    const int err = nerr;
+    print("errors", err);
+    print(err ? "FAILED" : "PASSED");
+
+    finalize();
+    return err;
+}
@@ -0,0 +1,127 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file testcompress.cc
+/// \brief Times compress and reconstruct recursively and one level at a time
+
+/// Usage: testcompress [ngauss]
+///
+/// The function is a sum of Gaussians spread over a large cell so that
+/// its tree is wide and shallow, which is the case the level by level
+/// traversal is made for.
+
+#include <madness/mra/mra.h>
+#include <madness/misc/ran.h>
+
+using namespace madness;
+
+static const double L = 40.0;      // box size
+static const long k = 6;           // wavelet order
+static const double thresh = 1e-4; // precision
+static const int nrep = 5;         // repetitions of each traversal
+
+class gaussians : public FunctionFunctorInterface<double,3> {
+    std::vector<coord_3d> centers;
+    std::vector<double> expnts;
+public:
+    gaussians(long n) {
+        for (long i=0; i<n; ++i) {
+            coord_3d center;
+            for (int d=0; d<3; ++d) center[d] = 0.8*L*(RandomValue<double>() - 0.5);
+            centers.push_back(center);
+            expnts.push_back(1.0 + 2.0*RandomValue<double>());
+        }
+    }
+
+    double operator()(const coord_3d& r) const {
+        double sum = 0.0;
+        for (std::size_t i=0; i<centers.size(); ++i) {
+            const double x=r[0]-centers[i][0], y=r[1]-centers[i][1], z=r[2]-centers[i][2];
+            const double arg = expnts[i]*(x*x + y*y + z*z);
+            if (arg < 40.0) sum += exp(-arg);
+        }
+        return sum;
+    }
+};
+
+/// Returns the time for nrep pairs of compress and reconstruct
+double time_traversal(World& world, const real_function_3d& f, bool by_level) {
+    world.gop.fence();
+    const double start = wall_time();
+    for (int rep=0; rep<nrep; ++rep) {
+        f.compress(true, by_level);
+        f.reconstruct(true, by_level);
+    }
+    return wall_time() - start;
+}
+
+int main(int argc, char** argv) {
+    initialize(argc, argv);
+    World world(SafeMPI::COMM_WORLD);
+
+    startup(world,argc,argv);
+    std::cout.precision(6);
+
+    FunctionDefaults<3>::set_k(k);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_initial_level(3);
+    FunctionDefaults<3>::set_truncate_mode(1);
+    FunctionDefaults<3>::set_cubic_cell(-L/2, L/2);
+
+    const long ngauss = (argc > 1) ? std::atol(argv[1]) : 200;
+
+    real_function_3d f = real_factory_3d(world).functor(real_functor_3d(new gaussians(ngauss)));
+    const real_function_3d g = copy(f);
+    const std::size_t nnode = f.tree_size();
+    const std::size_t depth = f.max_depth();
+
+    const double trec = time_traversal(world, f, false);
+    const double tlev = time_traversal(world, f, true);
+
+    // Compare with the untouched copy in both forms
+    double err = (f - g).norm2();
+    f.compress(true, true);
+    g.compress();
+    err = std::max(err, (f - g).norm2());
+
+    int success = 0;
+    if (world.rank() == 0) {
+        printf("%8s %6s %14s %14s %8s %10s\n", "nodes", "depth", "recursive(s)", "by level(s)", "speedup", "error");
+        printf("%8lu %6lu %14.3f %14.3f %8.2f %10.2e\n", nnode, depth, trec, tlev, trec/tlev, err);
+    }
+    if (err > 1e-12) ++success;
+
+    if (world.rank() == 0) print(success ? "FAILED" : "PASSED");
+
+    finalize();
+    return success;
+}
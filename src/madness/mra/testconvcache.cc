@@ -0,0 +1,153 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file testconvcache.cc
+/// \brief Tests the on-disk cache of the matrix elements of 1D convolutions
+
+#include <madness/mra/mra.h>
+#include <madness/mra/operator.h>
+#include <cstdio>
+
+using namespace madness;
+
+static const double L = 20.0;      // box size
+static const long k = 8;           // wavelet order
+static const double thresh = 1e-6; // precision
+
+static double gaussian(const coord_3d& r) {
+    const double x=r[0]-0.3, y=r[1], z=r[2]+0.2;
+    return exp(-2.0*(x*x + y*y + z*z));
+}
+
+/// Returns the largest difference between the blocks of two operators
+double compare_blocks(const Convolution1D<double>& a, const Convolution1D<double>& b, Level nmax) {
+    double err = 0.0;
+    for (Level n=0; n<=nmax; ++n) {
+        for (Translation l=-4; l<=4; ++l) {
+            err = std::max(err, (a.get_rnlp(n,l) - b.get_rnlp(n,l)).normf());
+
+            const ConvolutionData1D<double>* p = a.nonstandard(n,l);
+            const ConvolutionData1D<double>* q = b.nonstandard(n,l);
+            err = std::max(err, std::abs(p->Rnormf - q->Rnormf) + std::abs(p->Tnorm - q->Tnorm));
+            if (p->R.size()) err = std::max(err, (p->R - q->R).normf() + (p->RVT - q->RVT).normf());
+
+            const Key<2> key(n, Vector<Translation,2>{4, 4+l});
+            p = a.mod_nonstandard(key);
+            q = b.mod_nonstandard(key);
+            err = std::max(err, std::abs(p->N_diff - q->N_diff));
+            if (p->T.size()) err = std::max(err, (p->T - q->T).normf() + (p->TU - q->TU).normf());
+        }
+    }
+    return err;
+}
+
+int main(int argc, char** argv) {
+    initialize(argc, argv);
+    World world(SafeMPI::COMM_WORLD);
+
+    int success = 0;
+
+    startup(world,argc,argv);
+    std::cout.precision(10);
+
+    // A private directory so that earlier runs do not warm the cache
+    char dir[64];
+    snprintf(dir, sizeof(dir), "testconvcache.%d.d", world.rank());
+    ConvolutionDiskCache::set_directory(dir);
+    const std::string name = GaussianConvolution1D<double>::cache_name(k, 2.0, 1000.0, 0, false, 0.0);
+    remove(ConvolutionDiskCache::filename(name).c_str());
+
+    {
+        GaussianConvolution1D<double> a(k, 2.0, 1000.0, 0, false);
+        GaussianConvolution1D<double> ref(k, 2.0, 1000.0, 0, false);
+        compare_blocks(a, ref, 5);
+        a.save_disk_cache();
+
+        const detail::ConvolutionCacheFile file(name, TensorTypeData<double>::id, k, false);
+        const std::size_t nrecord = file.records().size();
+        if (world.rank() == 0) print("blocks saved", nrecord);
+        if (nrecord == 0) ++success;
+
+        for (int mmap=0; mmap<2; ++mmap) {
+            ConvolutionDiskCache::set_mmap(mmap);
+            GaussianConvolution1D<double> b(k, 2.0, 1000.0, 0, false);
+            const double err = compare_blocks(ref, b, 5);
+            if (world.rank() == 0) print("mmap", mmap, "error in cached blocks", err);
+            if (err != 0.0) ++success;
+
+            // Blocks computed after loading are added to the file
+            compare_blocks(ref, b, 6);
+            b.save_disk_cache();
+        }
+        const detail::ConvolutionCacheFile added(name, TensorTypeData<double>::id, k, true);
+        if (world.rank() == 0) print("blocks after adding a level", added.records().size());
+        if (added.records().size() <= nrecord) ++success;
+
+        // A different operator must not pick up these blocks
+        const std::string other = GaussianConvolution1D<double>::cache_name(k, 2.0, 1000.0, 1, false, 0.0);
+        const detail::ConvolutionCacheFile wrong(other, TensorTypeData<double>::id, k, false);
+        if (!wrong.empty()) ++success;
+    }
+
+    // A Poisson apply with a warm cache is the same as with a cold one
+    // (up to the rounding of the order in which apply accumulates)
+    FunctionDefaults<3>::set_k(k);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_initial_level(2);
+    FunctionDefaults<3>::set_truncate_mode(1);
+    FunctionDefaults<3>::set_cubic_cell(-L/2, L/2);
+
+    real_function_3d f = real_factory_3d(world).f(gaussian);
+    real_function_3d cold, warm;
+    {
+        real_convolution_3d op = CoulombOperator(world, 1e-3, thresh);
+        cold = op(f);
+        GaussianConvolution1DCache<double>::save();
+        GaussianConvolution1DCache<double>::map.clear();
+    }
+    {
+        real_convolution_3d op = CoulombOperator(world, 1e-3, thresh);
+        warm = op(f);
+        GaussianConvolution1DCache<double>::map.clear();
+    }
+    const double err = (cold - warm).norm2();
+    if (world.rank() == 0) print("error of apply with the warm cache", err);
+    if (err > 1e-10*f.norm2()) ++success;
+
+    ConvolutionDiskCache::set_directory("");
+    world.gop.fence();
+
+    if (world.rank() == 0) print(success ? "FAILED" : "PASSED");
+
+    finalize();
+    return success;
+}
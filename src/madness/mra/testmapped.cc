@@ -0,0 +1,126 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file testmapped.cc
+/// \brief Tests MappedFunction against the Function it was written from
+
+#include <madness/mra/mra.h>
+#include <madness/mra/mappedfunction.h>
+#include <cstdio>
+
+using namespace madness;
+
+static const double L = 10.0;      // box size
+static const long k = 8;           // wavelet order
+static const double thresh = 1e-6; // precision
+
+static double narrow_func(const coord_3d& r) {
+    const double x=r[0]-0.3, y=r[1], z=r[2]+0.2;
+    return exp(-4.0*(x*x + y*y + z*z));
+}
+
+static double wide_func(const coord_3d& r) {
+    const double x=r[0], y=r[1]-0.5, z=r[2];
+    return (1.0 + x)*exp(-0.5*(x*x + y*y + z*z));
+}
+
+bool is_like(double a, double b, double tol) {
+    return (std::abs(a - b) <= tol*std::max(1.0,std::abs(a)));
+}
+
+int main(int argc, char** argv) {
+    initialize(argc, argv);
+    World world(SafeMPI::COMM_WORLD);
+
+    int success = 0;
+
+    startup(world,argc,argv);
+    std::cout.precision(10);
+
+    FunctionDefaults<3>::set_k(k);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_initial_level(2);
+    FunctionDefaults<3>::set_truncate_mode(1);
+    FunctionDefaults<3>::set_cubic_cell(-L/2, L/2);
+
+    // Different trees so that inner() must project between levels
+    real_function_3d f = real_factory_3d(world).f(narrow_func);
+    real_function_3d g = real_factory_3d(world).f(wide_func);
+    f.compress(); // save_mapped must reconstruct
+
+    save_mapped(f, "testmapped_f.mmap");
+    save_mapped(g, "testmapped_g.mmap");
+    world.gop.fence();
+
+    MappedFunction<double,3> mf("testmapped_f.mmap");
+    MappedFunction<double,3> mg("testmapped_g.mmap");
+
+    const coord_3d pts[] = {coord_3d(0.0), coord_3d(0.3), coord_3d(-1.7), coord_3d(4.9)};
+    for (const coord_3d& x : pts) {
+        const double fx = f(x), gx = g(x);
+        if (!is_like(fx, mf(x), 1e-12)) ++success;
+        if (!is_like(gx, mg(x), 1e-12)) ++success;
+    }
+
+    const double fg = inner(f,g), ff = f.norm2(), gg = g.norm2();
+    const double mfg = inner(mf,mg), mgf = inner(mg,mf);
+    const double mff = mf.norm2(), mgg = mg.norm2();
+    if (world.rank() == 0) {
+        printf("<f|g>   Function %16.12f  Mapped %16.12f %16.12f\n", fg, mfg, mgf);
+        printf("||f||   Function %16.12f  Mapped %16.12f\n", ff, mff);
+        printf("||g||   Function %16.12f  Mapped %16.12f\n", gg, mgg);
+    }
+    if (!is_like(fg, mfg, 1e-10)) ++success;
+    if (!is_like(fg, mgf, 1e-10)) ++success;
+    if (!is_like(ff, mff, 1e-10)) ++success;
+    if (!is_like(gg, mgg, 1e-10)) ++success;
+
+    Tensor<double> cell(3,2);
+    cell(_,0) = -2.0;
+    cell(_,1) = 3.0;
+    std::vector<long> npt(3,11);
+    Tensor<double> plotf = f.eval_cube(cell, npt);
+    Tensor<double> plotmf = mf.eval_cube(cell, npt);
+    const double err = (plotf - plotmf).normf();
+    if (world.rank() == 0) printf("eval_cube difference %.2e\n", err);
+    if (err > 1e-12) ++success;
+
+    world.gop.fence();
+    if (world.rank() == 0) {
+        std::remove("testmapped_f.mmap");
+        std::remove("testmapped_g.mmap");
+        print(success ? "FAILED" : "PASSED");
+    }
+
+    finalize();
+    return success;
+}
@@ -0,0 +1,121 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file testmatinner.cc
+/// \brief Times matrix_inner with and without tiling for 100-1000 orbitals
+
+/// Usage: testmatinner [nmax]
+///
+/// The orbitals are Gaussians centered at random in a small molecule
+/// sized region so that, as for real orbitals, most boxes are shared by
+/// many functions.
+
+#include <madness/mra/mra.h>
+#include <madness/misc/ran.h>
+
+using namespace madness;
+
+static const double L = 20.0;      // box size
+static const long k = 8;           // wavelet order
+static const double thresh = 1e-5; // precision
+
+class gaussian : public FunctionFunctorInterface<double,3> {
+    const coord_3d center;
+    const double expnt;
+public:
+    gaussian(const coord_3d& center, double expnt) : center(center), expnt(expnt) {}
+
+    double operator()(const coord_3d& r) const {
+        const double x=r[0]-center[0], y=r[1]-center[1], z=r[2]-center[2];
+        return exp(-expnt*(x*x + y*y + z*z));
+    }
+};
+
+/// Returns the time for matrix_inner of the first n functions
+double time_inner(World& world, const std::vector<real_function_3d>& v, bool sym, bool tiled, Tensor<double>& r) {
+    FunctionDefaults<3>::set_inner_tiled(tiled);
+    world.gop.fence();
+    const double start = wall_time();
+    r = matrix_inner(world, v, v, sym);
+    return wall_time() - start;
+}
+
+int main(int argc, char** argv) {
+    initialize(argc, argv);
+    World world(SafeMPI::COMM_WORLD);
+
+    startup(world,argc,argv);
+    std::cout.precision(6);
+
+    FunctionDefaults<3>::set_k(k);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_initial_level(2);
+    FunctionDefaults<3>::set_truncate_mode(1);
+    FunctionDefaults<3>::set_cubic_cell(-L/2, L/2);
+
+    const long nmax = (argc > 1) ? std::atol(argv[1]) : 1000;
+
+    std::vector<real_function_3d> orbitals;
+    for (long i=0; i<nmax; ++i) {
+        coord_3d center;
+        for (int d=0; d<3; ++d) center[d] = 4.0*(RandomValue<double>() - 0.5);
+        const double expnt = 0.5 + 2.0*RandomValue<double>();
+        orbitals.push_back(real_factory_3d(world).functor(
+            real_functor_3d(new gaussian(center, expnt))).nofence());
+    }
+    world.gop.fence();
+    compress(world, orbitals);
+
+    int success = 0;
+    if (world.rank() == 0)
+        printf("%6s %4s %12s %12s %8s %10s\n", "norb", "sym", "pairwise(s)", "tiled(s)", "speedup", "error");
+    const long sizes[] = {100, 200, 500, 1000};
+    for (long n : sizes) {
+        if (n > nmax) break;
+        std::vector<real_function_3d> v(orbitals.begin(), orbitals.begin()+n);
+        for (int sym=0; sym<2; ++sym) {
+            Tensor<double> rold, rnew;
+            const double told = time_inner(world, v, sym, false, rold);
+            const double tnew = time_inner(world, v, sym, true, rnew);
+            const double err = (rold - rnew).normf()/rold.normf();
+            if (world.rank() == 0)
+                printf("%6ld %4d %12.3f %12.3f %8.2f %10.2e\n", n, sym, told, tnew, told/tnew, err);
+            if (err > 1e-12) ++success;
+        }
+    }
+    FunctionDefaults<3>::set_inner_tiled(true);
+
+    if (world.rank() == 0) print(success ? "FAILED" : "PASSED");
+
+    finalize();
+    return success;
+}
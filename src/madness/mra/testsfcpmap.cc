@@ -0,0 +1,295 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file testsfcpmap.cc
+/// \brief Tests SFCPmap and compares the remote traffic of apply and diff under each process map
+
+/// The remote references are modelled for a given number of processes
+/// from the tree of a function: for every leaf, apply() sends to all
+/// nearest neighbors and diff() looks up the face neighbors.  Run with
+/// more than one process the number of messages actually sent
+/// by apply() and diff() is also reported.
+
+#include <madness/mra/mra.h>
+#include <madness/mra/operator.h>
+#include <madness/misc/ran.h>
+#include <numeric>
+
+using namespace madness;
+
+static const double L = 20.0;      // box size
+static const long k = 6;           // wavelet order
+static const double thresh = 1e-4; // precision
+
+static double molecule(const coord_3d& r) {
+    // Three atoms along a bent chain
+    static const double c[3][3] = {{-1.5,0.0,0.0}, {0.0,0.8,0.0}, {1.5,0.0,0.3}};
+    double sum = 0.0;
+    for (int a=0; a<3; ++a) {
+        const double x=r[0]-c[a][0], y=r[1]-c[a][1], z=r[2]-c[a][2];
+        sum += exp(-2.0*(x*x + y*y + z*z));
+    }
+    return sum;
+}
+
+/// Checks that the curve visits every cell once, in unit steps for Hilbert, and is self-similar
+template <std::size_t NDIM>
+int test_curve(typename SFCPmap<NDIM>::Curve curve, int nproc) {
+    const SFCPmap<NDIM> pmap(nproc, curve);
+    const Level n = pmap.get_level();
+    const long twon = 1l << n;
+    const uint64_t ncell = pmap.size();
+
+    int nerr = 0;
+    std::vector< Vector<Translation,NDIM> > where(ncell);
+    std::vector<bool> seen(ncell, false);
+    std::vector<long> dims(NDIM, twon);
+    for (IndexIterator it(dims); it; ++it) {
+        Vector<Translation,NDIM> l;
+        for (std::size_t d=0; d<NDIM; ++d) l[d] = it[d];
+        const Key<NDIM> key(n, l);
+        const uint64_t c = pmap.cell(key);
+        if (c >= ncell || seen[c]) ++nerr;
+        else {
+            seen[c] = true;
+            where[c] = l;
+        }
+
+        // Ancestors start the segment of the curve holding their descendants
+        for (Level m=0; m<n; ++m) {
+            const uint64_t a = pmap.cell(key.parent(n-m));
+            const int shift = NDIM*(n-m);
+            if ((a >> shift) != (c >> shift) || (a & ((uint64_t(1) << shift) - 1))) ++nerr;
+        }
+
+        // Finer boxes belong with their ancestor
+        for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
+            if (pmap.owner(kit.key()) != pmap.owner(key)) ++nerr;
+        }
+    }
+    if (nerr) print("test_curve: bad cells", nerr);
+
+    if (curve == SFCPmap<NDIM>::HILBERT) {
+        for (uint64_t c=1; c<ncell; ++c) {
+            long dist = 0;
+            for (std::size_t d=0; d<NDIM; ++d) dist += std::abs(where[c][d] - where[c-1][d]);
+            if (dist != 1) {
+                if (nerr == 0) print("test_curve: Hilbert curve is not continuous at", c);
+                ++nerr;
+            }
+        }
+    }
+
+    // Contiguous segments of equal length
+    std::vector<long> count(nproc, 0);
+    ProcessID last = 0;
+    for (uint64_t c=0; c<ncell; ++c) {
+        const ProcessID p = pmap.cell_owner(c);
+        if (p < last || p >= nproc) ++nerr;
+        else ++count[p];
+        last = p;
+    }
+    for (int p=0; p<nproc; ++p) {
+        if (std::abs(count[p] - long(ncell/nproc)) > 1) ++nerr;
+    }
+
+    print("test_curve", NDIM, (curve == SFCPmap<NDIM>::HILBERT) ? "Hilbert" : "Morton",
+          "nproc", nproc, "level", n, (nerr ? "FAILED" : "OK"));
+    return nerr;
+}
+
+/// Checks that weighted segments have nearly equal cost
+int test_weighted(int nproc) {
+    const Level n = 4;
+    std::vector<double> cost(1ul << (3*n));
+    double total = 0.0, maxcost = 0.0;
+    for (std::size_t i=0; i<cost.size(); ++i) {
+        cost[i] = (i%97 == 0) ? 50.0*RandomValue<double>() : RandomValue<double>();
+        total += cost[i];
+        maxcost = std::max(maxcost, cost[i]);
+    }
+    const SFCPmap<3> pmap(nproc, cost, SFCPmap<3>::HILBERT, n);
+
+    std::vector<double> proccost(nproc, 0.0);
+    for (std::size_t i=0; i<cost.size(); ++i) proccost[pmap.cell_owner(i)] += cost[i];
+    int nerr = 0;
+    for (int p=0; p<nproc; ++p) {
+        if (proccost[p] > total/nproc + maxcost) ++nerr;
+    }
+    print("test_weighted nproc", nproc, "max/mean cost",
+          *std::max_element(proccost.begin(), proccost.end())*nproc/total, (nerr ? "FAILED" : "OK"));
+    return nerr;
+}
+
+/// Remote references by apply and diff, and the leaves per process, for one map
+struct traffic {
+    long apply, diff, nref_apply, nref_diff;
+    double imbalance;
+};
+
+template <typename pmapT>
+traffic model_traffic(const real_function_3d& f, const pmapT& pmap, int nproc) {
+    traffic t = {0, 0, 0, 0, 0.0};
+    std::vector<long> leaves(nproc, 0);
+    const real_function_3d::implT::dcT& coeffs = f.get_impl()->get_coeffs();
+    for (auto it=coeffs.begin(); it!=coeffs.end(); ++it) {
+        const Key<3>& key = it->first;
+        if (!it->second.has_coeff()) continue;
+        const ProcessID me = pmap.owner(key);
+        ++leaves[me];
+        const Translation twon = Translation(1) << key.level();
+        for (IndexIterator d(3, 3); d; ++d) {
+            Vector<Translation,3> l;
+            long dist = 0;
+            bool valid = true;
+            for (std::size_t i=0; i<3; ++i) {
+                l[i] = key.translation()[i] + d[i] - 1;
+                dist += std::abs(d[i] - 1);
+                valid = valid && l[i] >= 0 && l[i] < twon;
+            }
+            if (dist == 0 || !valid) continue;
+            const bool remote = (pmap.owner(Key<3>(key.level(), l)) != me);
+            ++t.nref_apply;
+            t.apply += remote;
+            if (dist == 1) {
+                ++t.nref_diff;
+                t.diff += remote;
+            }
+        }
+    }
+    const double total = std::accumulate(leaves.begin(), leaves.end(), 0l);
+    t.imbalance = *std::max_element(leaves.begin(), leaves.end())*nproc/total;
+    return t;
+}
+
+/// Returns the messages sent to other processes by this process doing op (including fences)
+template <typename opT>
+unsigned long count_messages(World& world, opT op) {
+    world.gop.fence();
+    const uint64_t nsent = RMI::get_stats().nmsg_sent;
+    op();
+    world.gop.fence();
+    return RMI::get_stats().nmsg_sent - nsent;
+}
+
+int main(int argc, char** argv) {
+    initialize(argc, argv);
+    World world(SafeMPI::COMM_WORLD);
+
+    int success = 0;
+
+    startup(world,argc,argv);
+    std::cout.precision(6);
+
+    if (world.rank() == 0) {
+        for (int nproc=1; nproc<=13; nproc+=4) {
+            success += test_curve<1>(SFCPmap<1>::HILBERT, nproc);
+            success += test_curve<2>(SFCPmap<2>::HILBERT, nproc);
+            success += test_curve<3>(SFCPmap<3>::HILBERT, nproc);
+            success += test_curve<3>(SFCPmap<3>::MORTON, nproc);
+            success += test_curve<4>(SFCPmap<4>::HILBERT, nproc);
+            success += test_weighted(nproc);
+        }
+    }
+
+    FunctionDefaults<3>::set_k(k);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_initial_level(2);
+    FunctionDefaults<3>::set_truncate_mode(1);
+    FunctionDefaults<3>::set_cubic_cell(-L/2, L/2);
+
+    real_function_3d f = real_factory_3d(world).f(molecule);
+    f.truncate();
+    f.reconstruct();
+
+    // Modelled remote references for more processes than are running
+    if (world.size() == 1) {
+        const int nprocs[] = {16, 256};
+        for (int nproc : nprocs) {
+            // Weighted by the number of leaves in each cell
+            const SFCPmap<3> uniform(nproc);
+            std::vector<double> cost(uniform.size(), 0.0);
+            const real_function_3d::implT::dcT& coeffs = f.get_impl()->get_coeffs();
+            for (auto it=coeffs.begin(); it!=coeffs.end(); ++it)
+                if (it->second.has_coeff()) cost[uniform.cell(it->first)] += 1.0;
+
+            const traffic t[] = {
+                model_traffic(f, SimplePmap< Key<3> >(nproc), nproc),
+                model_traffic(f, LevelPmap< Key<3> >(nproc), nproc),
+                model_traffic(f, SFCPmap<3>(nproc, SFCPmap<3>::MORTON), nproc),
+                model_traffic(f, SFCPmap<3>(nproc, SFCPmap<3>::HILBERT), nproc),
+                model_traffic(f, SFCPmap<3>(nproc, cost, SFCPmap<3>::HILBERT, uniform.get_level()), nproc)
+            };
+            const char* names[] = {"SimplePmap", "LevelPmap", "SFC Morton", "SFC Hilbert", "SFC Hilbert weighted"};
+
+            printf("\nRemote references modelled for %d processes (%ld apply and %ld diff references)\n",
+                   nproc, t[0].nref_apply, t[0].nref_diff);
+            printf("%22s %10s %10s %10s\n", "pmap", "apply", "diff", "leaf imbal");
+            for (int i=0; i<5; ++i)
+                printf("%22s %10ld %10ld %10.2f\n", names[i], t[i].apply, t[i].diff, t[i].imbalance);
+
+            if (t[3].apply >= t[1].apply || t[3].diff >= t[1].diff) {
+                print("SFC Hilbert map is not more local than LevelPmap");
+                ++success;
+            }
+        }
+    }
+    else {
+        // Measured messages under each map on the processes running
+        real_convolution_3d op = CoulombOperator(world, 1e-3, thresh);
+        std::shared_ptr< WorldDCPmapInterface< Key<3> > > pmaps[4] = {
+            std::shared_ptr< WorldDCPmapInterface< Key<3> > >(new LevelPmap< Key<3> >(world)),
+            std::shared_ptr< WorldDCPmapInterface< Key<3> > >(new SFCPmap<3>(world, SFCPmap<3>::MORTON)),
+            std::shared_ptr< WorldDCPmapInterface< Key<3> > >(new SFCPmap<3>(world, SFCPmap<3>::HILBERT))
+        };
+        pmaps[3] = make_sfc_pmap(world, std::vector<real_function_3d>(1, f), LBMeasuredCost<double,3>(1.0, 0.0));
+        const char* names[] = {"LevelPmap", "SFC Morton", "SFC Hilbert", "SFC Hilbert weighted"};
+        if (world.rank() == 0) printf("\nRemote messages sent on %d processes\n%22s %10s %10s\n",
+                                      world.size(), "pmap", "apply", "diff");
+        for (int i=0; i<4; ++i) {
+            FunctionDefaults<3>::redistribute(world, pmaps[i]);
+            unsigned long napply = count_messages(world, [&](){real_function_3d g = apply(op, f);});
+            unsigned long ndiff = count_messages(world, [&](){
+                    real_derivative_3d D(world, 0);
+                    real_function_3d g = D(f);});
+            world.gop.sum(napply);
+            world.gop.sum(ndiff);
+            if (world.rank() == 0) printf("%22s %10lu %10lu\n", names[i], napply, ndiff);
+        }
+    }
+
+    world.gop.broadcast(success);
+    if (world.rank() == 0) print(success ? "FAILED" : "PASSED");
+
+    finalize();
+    return success;
+}
@@ -240,6 +240,16 @@ int test_basic(World& world) {
     CHECK(new_norm-norm, 1e-9, "new_norm");
     CHECK(new_err, 3e-5, "new_err");
 
+    // One level at a time instead of recursively
+    f.reconstruct();
+    Function<T,NDIM> g = copy(f);
+    g.compress(true, true);
+    f.compress();
+    CHECK((f-g).norm2(), 1e-14, "compress by level");
+    f.reconstruct();
+    g.reconstruct(true, true);
+    CHECK(g.err(*functor)-f.err(*functor), 1e-14, "reconstruct by level");
+
     world.gop.fence();
     if (world.rank() == 0) print("projection, compression, reconstruction, truncation OK",ok,"\n\n");
     if (not ok) return 1;
@@ -896,6 +906,20 @@ int test_coulomb(World& world) {
     }
     CHECK(rerr, 10.0*thresh, "err in test_coulomb");
 
+    // Again with the terms that allow it applied in single precision
+    FunctionDefaults<3>::set_apply_mixed_precision(true);
+    op.reset_mixed_precision_stats();
+    START_TIMER;
+    Function<double,3> rmixed = apply_only(op,f);
+    END_TIMER("mixed precision apply");
+    FunctionDefaults<3>::set_apply_mixed_precision(false);
+    rmixed.reconstruct();
+    op.print_mixed_precision_stats();
+    double mixed_diff = (rmixed - r).norm2();
+    if (world.rank() == 0) print("  mixed - double norm", mixed_diff);
+    CHECK(mixed_diff, thresh, "mixed precision in test_coulomb");
+    CHECK(op.mixed_precision_stats().maxerr, 1.0, "mixed precision error in test_coulomb");
+
     if (ok) return 0;
     return 1;
 }
@@ -1226,6 +1250,82 @@ int test_io(World& world) {
     return 1;
 }
 
+/// Returns the memory used by the coefficients of f
+template <typename T, std::size_t NDIM>
+std::size_t coeff_size(World& world, const Function<T,NDIM>& f) {
+    typedef typename FunctionImpl<T,NDIM>::dcT dcT;
+    std::size_t sum = 0;
+    const dcT& coeffs = f.get_impl()->get_coeffs();
+    for (typename dcT::const_iterator it=coeffs.begin(); it!=coeffs.end(); ++it) {
+        sum += it->second.real_size();
+    }
+    world.gop.sum(sum);
+    return sum;
+}
+
+template <typename T, std::size_t NDIM>
+int test_pack(World& world) {
+    if (world.rank() == 0) {
+        print("\nTest packed coefficients - type =", archive::get_type_name<T>(),", ndim =",NDIM,"\n");
+    }
+    bool ok=true;
+    typedef Vector<double,NDIM> coordT;
+    typedef std::shared_ptr< FunctionFunctorInterface<T,NDIM> > functorT;
+
+    const double thresh = 1e-6;
+    FunctionDefaults<NDIM>::set_k(8);
+    FunctionDefaults<NDIM>::set_thresh(thresh);
+    FunctionDefaults<NDIM>::set_truncate_mode(0);
+    FunctionDefaults<NDIM>::set_refine(true);
+    FunctionDefaults<NDIM>::set_initial_level(3);
+    FunctionDefaults<NDIM>::set_cubic_cell(-10,10);
+
+    const coordT origin(0.0);
+    const double expnt = 10.0;
+    const double coeff = pow(2.0/PI,0.25*NDIM);
+    functorT functor(new Gaussian<T,NDIM>(origin, expnt, coeff));
+    Function<T,NDIM> f = FunctionFactory<T,NDIM>(world).functor(functor);
+    f.truncate();
+    const double fnorm = f.norm2();
+
+    for (int scaled=0; scaled<2; ++scaled) {
+        FunctionDefaults<NDIM>::set_pack_scaled(scaled);
+        Function<T,NDIM> g = copy(f);
+        const std::size_t fsize = coeff_size(world, g);
+        g.pack();
+        const std::size_t gsize = coeff_size(world, g);
+        if (world.rank() == 0) print("scaled", scaled, "size", fsize, "packed", gsize);
+        // Small 1D nodes are left alone, large ones shrink
+        CHECK(double(gsize > (NDIM < 3 ? 1.0 : 0.6)*fsize),0.5,"packed size");
+
+        // Packed coefficients stay packed through I/O
+        int nio = (world.size()-1)/20 + 1;
+        archive::ParallelOutputArchive out(world, "packed", nio);
+        out & g;
+        out.close();
+        Function<T,NDIM> h;
+        archive::ParallelInputArchive in(world, "packed", nio);
+        in & h;
+        in.close();
+        in.remove();
+        CHECK(double(coeff_size(world, h) != gsize),0.5,"packed size after io");
+
+        // ... and are widened when used
+        double err = (h - f).norm2();
+        CHECK(err,thresh,"error of packed function");
+        err = (2.0*g - f).norm2() - fnorm;
+        CHECK(err,thresh,"arithmetic on packed function");
+        g.unpack();
+        CHECK(double(coeff_size(world, g) < fsize),0.5,"size after unpack");
+    }
+    FunctionDefaults<NDIM>::set_pack_scaled(true);
+
+    if (world.rank() == 0) print("test_pack OK");
+    world.gop.fence();
+    if (ok) return 0;
+    return 1;
+}
+
 template <typename T, std::size_t NDIM>
 int test_apply_push_1d(World& world) {
     typedef Vector<double,NDIM> coordT;
@@ -1335,6 +1435,7 @@ int main(int argc, char**argv) {
         nfail+=test_plot<double,1>(world);
         nfail+=test_apply_push_1d<double,1>(world);
         nfail+=test_io<double,1>(world);
+        nfail+=test_pack<double,1>(world);
 
         // stupid location for this test
         GenericConvolution1D<double,GaussianGenericFunctor<double> > gen(10,GaussianGenericFunctor<double>(100.0,100.0),0);
@@ -1353,6 +1454,7 @@ int main(int argc, char**argv) {
         nfail+=test_op<double_complex,1>(world);
         nfail+=test_plot<double_complex,1>(world);
         nfail+=test_io<double_complex,1>(world);
+        nfail+=test_pack<double_complex,1>(world);
 
         //TaskInterface::debug = true;
         nfail+=test_basic<double,2>(world);
@@ -1371,6 +1473,7 @@ int main(int argc, char**argv) {
         nfail+=test_coulomb(world);
         nfail+=test_plot<double,3>(world);
         nfail+=test_io<double,3>(world);
+        nfail+=test_pack<double,3>(world);
 
         test_plot<double,4>(world); // slow unless reduce npt in test_plot
 
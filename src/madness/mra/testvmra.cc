@@ -1,6 +1,7 @@
 #define NO_GENTENSOR
 #include <madness/mra/mra.h>
 #include <madness/mra/vmra.h>
+#include <madness/mra/lazyvmra.h>
 #include <madness/misc/ran.h>
 
 const double PI = 3.1415926535897932384;
@@ -183,6 +184,178 @@ void test_multi_to_multi_op(World& world) {
 
 }
 
+template <std::size_t NDIM>
+void test_checkpoint(World& world) {
+
+    typedef Function<double,NDIM> functionT;
+    typedef std::vector<Function<double,NDIM> > vecfuncT;
+    typedef std::shared_ptr< FunctionFunctorInterface<double,NDIM> > ffunctorT;
+
+    const double thresh=1.e-7;
+    Tensor<double> cell(NDIM,2);
+    for (std::size_t i=0; i<NDIM; ++i) {
+        cell(i,0) = -11.0-2*i;  // Deliberately asymmetric bounding box
+        cell(i,1) =  10.0+i;
+    }
+    FunctionDefaults<NDIM>::set_cell(cell);
+    FunctionDefaults<NDIM>::set_k(8);
+    FunctionDefaults<NDIM>::set_thresh(thresh);
+    FunctionDefaults<NDIM>::set_refine(true);
+    FunctionDefaults<NDIM>::set_initial_level(3);
+    FunctionDefaults<NDIM>::set_truncate_mode(1);
+
+    vecfuncT v(5);
+    for (functionT& f : v) {
+        ffunctorT functor(RandomGaussian<double,NDIM>(FunctionDefaults<NDIM>::get_cell(),0.5));
+        f=FunctionFactory<double,NDIM>(world).functor(functor);
+    }
+    v[0].compress(); // Mix of compressed and reconstructed
+    v[1].compress();
+    vecfuncT ref=copy(world,v);
+
+    // The functions may be modified as soon as the checkpoint returns
+    save_checkpoint(v,"test_checkpoint");
+    scale(world,v,2.0);
+    checkpoint_wait(world);
+    MADNESS_ASSERT(checkpoint_exists(world,"test_checkpoint"));
+
+    vecfuncT w;
+    load_checkpoint(world,w,"test_checkpoint");
+    MADNESS_ASSERT(w.size()==ref.size());
+    double err=0.0;
+    for (std::size_t i=0; i<w.size(); ++i) {
+        MADNESS_ASSERT(w[i].is_compressed()==ref[i].is_compressed());
+        err+=(w[i]-ref[i]).norm2();
+    }
+    if (world.rank()==0) print("error in checkpoint ",err);
+    if (err > thresh) error("checkpoint differs from the functions saved");
+
+    if (world.rank()==0) {
+        std::remove(detail::checkpoint_index_name("test_checkpoint").c_str());
+        for (ProcessID p=0; p<world.size(); ++p)
+            std::remove(detail::checkpoint_shard_name("test_checkpoint",p).c_str());
+    }
+    world.gop.fence();
+}
+
+template <typename T, std::size_t NDIM>
+void test_fused(World& world) {
+
+    typedef Function<T,NDIM> functionT;
+    typedef std::vector<Function<T,NDIM> > vecfuncT;
+    typedef std::shared_ptr< FunctionFunctorInterface<T,NDIM> > ffunctorT;
+
+    const double thresh=1.e-7;
+    Tensor<double> cell(NDIM,2);
+    for (std::size_t i=0; i<NDIM; ++i) {
+        cell(i,0) = -11.0-2*i;  // Deliberately asymmetric bounding box
+        cell(i,1) =  10.0+i;
+    }
+    FunctionDefaults<NDIM>::set_cell(cell);
+    FunctionDefaults<NDIM>::set_k(8);
+    FunctionDefaults<NDIM>::set_thresh(thresh);
+    FunctionDefaults<NDIM>::set_refine(true);
+    FunctionDefaults<NDIM>::set_initial_level(3);
+    FunctionDefaults<NDIM>::set_truncate_mode(1);
+
+    vecfuncT v(6);
+    for (std::size_t i=0; i<v.size()-1; ++i) {
+        ffunctorT functor(RandomGaussian<T,NDIM>(FunctionDefaults<NDIM>::get_cell(),100.0));
+        v[i]=FunctionFactory<T,NDIM>(world).functor(functor);
+    }
+    v.back()=v[0]; // the same function twice must be transformed once
+    vecfuncT ref=copy(world,v);
+    ref.back()=ref[0];
+
+    // Each step of the fused traversals against one function at a time
+    double err=0.0;
+    FunctionDefaults<NDIM>::set_fused_traversal(false);
+    compress(world,ref);
+    FunctionDefaults<NDIM>::set_fused_traversal(true);
+    compress(world,v);
+    for (std::size_t i=0; i<v.size(); ++i) err+=(v[i]-ref[i]).norm2();
+
+    // Truncating the same function twice may remove more boxes
+    FunctionDefaults<NDIM>::set_fused_traversal(false);
+    vecfuncT distinct(ref.begin(),ref.end()-1);
+    truncate(world,distinct,1.e-5);
+    FunctionDefaults<NDIM>::set_fused_traversal(true);
+    truncate(world,v,1.e-5);
+    for (std::size_t i=0; i<v.size(); ++i) {
+        err+=(v[i]-ref[i]).norm2();
+        if (v[i].tree_size() != ref[i].tree_size()) err+=1.0;
+    }
+
+    FunctionDefaults<NDIM>::set_fused_traversal(false);
+    reconstruct(world,ref);
+    FunctionDefaults<NDIM>::set_fused_traversal(true);
+    reconstruct(world,v);
+    for (std::size_t i=0; i<v.size(); ++i) MADNESS_ASSERT(!v[i].is_compressed());
+    for (std::size_t i=0; i<v.size(); ++i) {
+        if (v[i].tree_size() != ref[i].tree_size()) err+=1.0;
+        err+=(v[i]-ref[i]).norm2();
+    }
+
+    norm_tree(world,v);
+    const Key<NDIM> key0(0);
+    for (std::size_t i=0; i<v.size(); ++i) {
+        const double norm=v[i].norm2();
+        const typename FunctionImpl<T,NDIM>::dcT& coeffs=v[i].get_impl()->get_coeffs();
+        if (coeffs.is_local(key0)) err+=std::abs(coeffs.find(key0).get()->second.get_norm_tree()-norm);
+    }
+    world.gop.sum(err);
+
+    if (world.rank()==0) print("error in fused traversals ",err);
+    if (err > 1.e-10) error("fused traversals differ from one function at a time");
+}
+
+void test_lazy(World& world) {
+
+    typedef std::vector<Function<double,3> > vecfuncT;
+    typedef std::shared_ptr< FunctionFunctorInterface<double,3> > ffunctorT;
+
+    const double thresh=1.e-5;
+    FunctionDefaults<3>::set_cubic_cell(-10.0,10.0);
+    FunctionDefaults<3>::set_k(6);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_initial_level(3);
+    FunctionDefaults<3>::set_truncate_mode(1);
+
+    vecfuncT v(4);
+    for (Function<double,3>& f : v) {
+        ffunctorT functor(RandomGaussian<double,3>(FunctionDefaults<3>::get_cell(),10.0));
+        f=FunctionFactory<double,3>(world).functor(functor);
+    }
+    ffunctorT vfunctor(RandomGaussian<double,3>(FunctionDefaults<3>::get_cell(),1.0));
+    Function<double,3> V=FunctionFactory<double,3>(world).functor(vfunctor);
+    real_convolution_3d op=CoulombOperator(world, 1.e-3, thresh);
+
+    // r = v - truncate(op*(V*v)),  s = 2*v + r - v  =  v + r
+    vecfuncT Vv=mul_sparse(world,V,v,thresh);
+    vecfuncT opVv=apply(world,op,Vv);
+    truncate(world,opVv);
+    vecfuncT rref=sub(world,v,opVv);
+    vecfuncT sref=add(world,v,rref);
+
+    LazyVector<double,3> x(world,v);
+    LazyVector<double,3> r=x - truncate(apply(op,mul_sparse(V,x,thresh)));
+    LazyVector<double,3> s=2.0*x + r - x;
+    const vecfuncT& sval=s.evaluate();
+    const vecfuncT& rval=r.evaluate();
+
+    double err=0.0;
+    for (std::size_t i=0; i<v.size(); ++i) {
+        err+=(rval[i]-rref[i]).norm2();
+        err+=(sval[i]-sref[i]).norm2();
+    }
+    Tensor<double> S=matrix_inner(s,x,false);
+    err+=(S-matrix_inner(world,sref,v,false)).normf();
+
+    if (world.rank()==0) print("error in lazy evaluation ",err);
+    if (err > 1.e-12) error("lazy evaluation differs from vmra");
+}
+
 int main(int argc, char**argv) {
     initialize(argc, argv);
 
@@ -195,11 +368,16 @@ int main(int argc, char**argv) {
         test_multi_to_multi_op<1>(world);
         test_multi_to_multi_op<2>(world);
         test_multi_to_multi_op<3>(world);
+        test_checkpoint<1>(world);
+        test_checkpoint<3>(world);
+        test_fused<double,3>(world);
+        test_lazy(world);
 #if !HAVE_GENTENSOR
         test_inner<double,std::complex<double>,1,false>(world);
         test_inner<std::complex<double>,double,1,false>(world);
         test_inner<std::complex<double>,std::complex<double>,1,false>(world);
         test_inner<std::complex<double>,std::complex<double>,1,true>(world);
+        test_fused<std::complex<double>,2>(world);
 #endif
     }
     catch (const SafeMPI::Exception& e) {
@@ -123,9 +123,38 @@
 #include <madness/mra/derivative.h>
 #include <madness/tensor/distributed_matrix.h>
 #include <cstdio>
+#include <set>
 
 namespace madness {
 
+    /// Returns the distinct impls of the functions selected by op if they can be traversed together
+
+    /// The fused traversals of compress, reconstruct, truncate and
+    /// norm_tree visit each box once for all functions, which needs full
+    /// rank coefficients, a common process map and a common wavelet
+    /// order.  Returns an empty vector if that is not the case, if fewer
+    /// than two functions are selected, or if disabled with
+    /// FunctionDefaults::set_fused_traversal().
+    template <typename T, std::size_t NDIM, typename opT>
+    std::vector<FunctionImpl<T,NDIM>*> fused_impls(const std::vector< Function<T,NDIM> >& v, const opT& select) {
+        std::vector<FunctionImpl<T,NDIM>*> impls;
+        if (!FunctionDefaults<NDIM>::get_fused_traversal()) return impls;
+
+        std::set<FunctionImpl<T,NDIM>*> seen;
+        for (unsigned int i=0; i<v.size(); ++i) {
+            if (!v[i].is_initialized() || !select(v[i])) continue;
+            FunctionImpl<T,NDIM>* impl = v[i].get_impl().get();
+            if (seen.insert(impl).second) impls.push_back(impl);
+        }
+        for (unsigned int i=0; i<impls.size(); ++i) {
+            if (impls[i]->get_pmap() != impls[0]->get_pmap() || impls[i]->get_k() != impls[0]->get_k() ||
+                impls[i]->get_tensor_type() != TT_FULL || impls[i]->is_redundant() || impls[i]->is_on_demand()) {
+                impls.clear();
+            }
+        }
+        if (impls.size() < 2) impls.clear();
+        return impls;
+    }
 
 
     /// Compress a vector of functions
@@ -135,6 +164,12 @@ namespace madness {
                   bool fence=true) {
 
         PROFILE_BLOCK(Vcompress);
+        std::vector<FunctionImpl<T,NDIM>*> impls = fused_impls(v, [](const Function<T,NDIM>& f) {return !f.is_compressed();});
+        if (impls.size()) {
+            impls[0]->vcompress(impls, fence);
+            return;
+        }
+
         bool must_fence = false;
         for (unsigned int i=0; i<v.size(); ++i) {
             if (!v[i].is_compressed()) {
@@ -153,6 +188,15 @@ namespace madness {
                      const std::vector< Function<T,NDIM> >& v,
                      bool fence=true) {
         PROFILE_BLOCK(Vreconstruct);
+        std::vector<FunctionImpl<T,NDIM>*> impls = fused_impls(v, [](const Function<T,NDIM>& f) {return f.is_compressed();});
+        for (unsigned int i=0; i<impls.size(); ++i) {
+            if (impls[i]->is_nonstandard()) impls.clear();
+        }
+        if (impls.size()) {
+            impls[0]->vreconstruct(impls, fence);
+            return;
+        }
+
         bool must_fence = false;
         for (unsigned int i=0; i<v.size(); ++i) {
             if (v[i].is_compressed()) {
@@ -228,6 +272,32 @@ namespace madness {
     }
 
 
+    /// Stores the coefficients of a vector of functions in reduced precision
+    template <typename T, std::size_t NDIM>
+    void pack(World& world,
+              std::vector< Function<T,NDIM> >& v,
+              bool fence=true) {
+        PROFILE_BLOCK(Vpack);
+        for (unsigned int i=0; i<v.size(); ++i) {
+            v[i].pack(false);
+        }
+        if (fence) world.gop.fence();
+    }
+
+
+    /// Widens the packed coefficients of a vector of functions
+    template <typename T, std::size_t NDIM>
+    void unpack(World& world,
+                const std::vector< Function<T,NDIM> >& v,
+                bool fence=true) {
+        PROFILE_BLOCK(Vunpack);
+        for (unsigned int i=0; i<v.size(); ++i) {
+            v[i].unpack(false);
+        }
+        if (fence) world.gop.fence();
+    }
+
+
     /// Truncates a vector of functions
     template <typename T, std::size_t NDIM>
     void truncate(World& world,
@@ -238,6 +308,12 @@ namespace madness {
 
         compress(world, v);
 
+        std::vector<FunctionImpl<T,NDIM>*> impls = fused_impls(v, [](const Function<T,NDIM>&) {return true;});
+        if (impls.size()) {
+            impls[0]->vtruncate(impls, tol, fence);
+            return;
+        }
+
         for (unsigned int i=0; i<v.size(); ++i) {
             v[i].truncate(tol, false);
         }
@@ -672,6 +748,13 @@ namespace madness {
                    bool fence=true)
     {
         PROFILE_BLOCK(Vnorm_tree);
+        std::vector<FunctionImpl<T,NDIM>*> impls = fused_impls(v, [](const Function<T,NDIM>&) {return true;});
+        if (impls.size()) {
+            reconstruct(world, v);
+            impls[0]->vnorm_tree(impls, fence);
+            return;
+        }
+
         for (unsigned int i=0; i<v.size(); ++i) {
             v[i].norm_tree(false);
         }
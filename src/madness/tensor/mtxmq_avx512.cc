@@ -0,0 +1,67 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file tensor/mtxmq_avx512.cc
+/// \brief mTxmq kernels for AVX-512 ... this file must be compiled with the matching flags
+
+#include <madness/tensor/mtxmq_kernels.h>
+
+namespace madness {
+
+    void mTxmq_avx512(long dimi, long dimj, long dimk,
+                     double* c, const double* a, const double* b, long ldb) {
+        MTxmqKernels::run(dimi, dimj, dimk, c, a, b, ldb);
+    }
+
+    void mTxmq_avx512(long dimi, long dimj, long dimk,
+                     float* c, const float* a, const float* b, long ldb) {
+        MTxmqKernels::run(dimi, dimj, dimk, c, a, b, ldb);
+    }
+
+    void mTxmq_avx512(long dimi, long dimj, long dimk,
+                     std::complex<double>* c, const std::complex<double>* a,
+                     const std::complex<double>* b, long ldb) {
+        MTxmqKernels::run(dimi, dimj, dimk, c, a, b, ldb);
+    }
+
+    void mTxmq_avx512(long dimi, long dimj, long dimk,
+                     std::complex<double>* c, const std::complex<double>* a,
+                     const double* b, long ldb) {
+        MTxmqKernels::run(dimi, dimj, dimk, c, a, b, ldb);
+    }
+
+    void mTxmq_avx512(long dimi, long dimj, long dimk,
+                     std::complex<double>* c, const double* a,
+                     const std::complex<double>* b, long ldb) {
+        MTxmqKernels::run(dimi, dimj, dimk, c, a, b, ldb);
+    }
+
+}
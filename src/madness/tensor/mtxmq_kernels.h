@@ -0,0 +1,313 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_TENSOR_MTXMQ_KERNELS_H__INCLUDED
+#define MADNESS_TENSOR_MTXMQ_KERNELS_H__INCLUDED
+
+#include <madness/tensor/mtxmq_simd.h>
+#include <immintrin.h>
+#include <cstring>
+#include <utility>
+
+/// \file tensor/mtxmq_kernels.h
+/// \brief Register-blocked mTxmq kernels generated for each column count
+
+// This file is ONLY included into mtxmq_avx2.cc and mtxmq_avx512.cc, each
+// compiled for its own instruction set.  Everything is in an anonymous
+// namespace since the two versions must not be merged by the linker.
+
+#if !defined(__AVX512F__) && !(defined(__AVX2__) && defined(__FMA__))
+#error "mtxmq_kernels.h must be compiled with AVX2 and FMA or with AVX-512"
+#endif
+
+namespace madness {
+    namespace {
+
+        // Registers and instructions for one scalar type
+        template <typename S> struct ISA;
+
+#if defined(__AVX512F__)
+
+        template <> struct ISA<double> {
+            typedef __m512d vecT;
+            static const int VW = 8;     // Doubles per register
+            static const int NACC = 24;  // Registers available for accumulators
+            static const int MAXIB = 8;  // Most rows of c held at once
+
+            static __mmask8 mask(int n) { return __mmask8((1u<<n)-1); }
+            static vecT zero() { return _mm512_setzero_pd(); }
+            static vecT load(const double* p) { return _mm512_loadu_pd(p); }
+            static vecT load(const double* p, int n) { return _mm512_maskz_loadu_pd(mask(n), p); }
+            static void store(double* p, vecT v) { _mm512_storeu_pd(p, v); }
+            static void store(double* p, vecT v, int n) { _mm512_mask_storeu_pd(p, mask(n), v); }
+            static vecT fmadd(vecT a, vecT b, vecT c) { return _mm512_fmadd_pd(a, b, c); }
+            static vecT bcast(const double* p) { return _mm512_set1_pd(*p); }
+            static vecT bcast2(const double* p) {
+                return _mm512_castps_pd(_mm512_broadcast_f32x4(_mm_castpd_ps(_mm_loadu_pd(p))));
+            }
+            static vecT swap(vecT v) { return _mm512_permute_pd(v, 0x55); }
+            static vecT sign() { return _mm512_set_pd(1.0,-1.0,1.0,-1.0,1.0,-1.0,1.0,-1.0); }
+        };
+
+        template <> struct ISA<float> {
+            typedef __m512 vecT;
+            static const int VW = 16;    // Floats per register
+            static const int NACC = 24;
+            static const int MAXIB = 8;
+
+            static __mmask16 mask(int n) { return __mmask16((1u<<n)-1); }
+            static vecT zero() { return _mm512_setzero_ps(); }
+            static vecT load(const float* p) { return _mm512_loadu_ps(p); }
+            static vecT load(const float* p, int n) { return _mm512_maskz_loadu_ps(mask(n), p); }
+            static void store(float* p, vecT v) { _mm512_storeu_ps(p, v); }
+            static void store(float* p, vecT v, int n) { _mm512_mask_storeu_ps(p, mask(n), v); }
+            static vecT fmadd(vecT a, vecT b, vecT c) { return _mm512_fmadd_ps(a, b, c); }
+            static vecT bcast(const float* p) { return _mm512_set1_ps(*p); }
+            static vecT bcast2(const float* p) {
+                double d;
+                std::memcpy(&d, p, sizeof(d));
+                return _mm512_castpd_ps(_mm512_set1_pd(d));
+            }
+            static vecT swap(vecT v) { return _mm512_permute_ps(v, 0xB1); }
+            static vecT sign() {
+                return _mm512_set_ps(1.0f,-1.0f,1.0f,-1.0f,1.0f,-1.0f,1.0f,-1.0f,
+                                     1.0f,-1.0f,1.0f,-1.0f,1.0f,-1.0f,1.0f,-1.0f);
+            }
+        };
+
+#else
+
+        template <> struct ISA<double> {
+            typedef __m256d vecT;
+            static const int VW = 4;
+            static const int NACC = 12;
+            static const int MAXIB = 4;
+
+            static __m256i mask(int n) {
+                return _mm256_set_epi64x(n>3 ? -1 : 0, n>2 ? -1 : 0, n>1 ? -1 : 0, n>0 ? -1 : 0);
+            }
+            static vecT zero() { return _mm256_setzero_pd(); }
+            static vecT load(const double* p) { return _mm256_loadu_pd(p); }
+            static vecT load(const double* p, int n) { return _mm256_maskload_pd(p, mask(n)); }
+            static void store(double* p, vecT v) { _mm256_storeu_pd(p, v); }
+            static void store(double* p, vecT v, int n) { _mm256_maskstore_pd(p, mask(n), v); }
+            static vecT fmadd(vecT a, vecT b, vecT c) { return _mm256_fmadd_pd(a, b, c); }
+            static vecT bcast(const double* p) { return _mm256_broadcast_sd(p); }
+            static vecT bcast2(const double* p) { return _mm256_broadcast_pd(reinterpret_cast<const __m128d*>(p)); }
+            static vecT swap(vecT v) { return _mm256_permute_pd(v, 0x5); }
+            static vecT sign() { return _mm256_set_pd(1.0,-1.0,1.0,-1.0); }
+        };
+
+        template <> struct ISA<float> {
+            typedef __m256 vecT;
+            static const int VW = 8;
+            static const int NACC = 12;
+            static const int MAXIB = 4;
+
+            static __m256i mask(int n) {
+                return _mm256_setr_epi32(n>0 ? -1 : 0, n>1 ? -1 : 0, n>2 ? -1 : 0, n>3 ? -1 : 0,
+                                         n>4 ? -1 : 0, n>5 ? -1 : 0, n>6 ? -1 : 0, n>7 ? -1 : 0);
+            }
+            static vecT zero() { return _mm256_setzero_ps(); }
+            static vecT load(const float* p) { return _mm256_loadu_ps(p); }
+            static vecT load(const float* p, int n) { return _mm256_maskload_ps(p, mask(n)); }
+            static void store(float* p, vecT v) { _mm256_storeu_ps(p, v); }
+            static void store(float* p, vecT v, int n) { _mm256_maskstore_ps(p, mask(n), v); }
+            static vecT fmadd(vecT a, vecT b, vecT c) { return _mm256_fmadd_ps(a, b, c); }
+            static vecT bcast(const float* p) { return _mm256_broadcast_ss(p); }
+            static vecT bcast2(const float* p) {
+                return _mm256_castpd_ps(_mm256_broadcast_sd(reinterpret_cast<const double*>(p)));
+            }
+            static vecT swap(vecT v) { return _mm256_permute_ps(v, 0xB1); }
+            static vecT sign() { return _mm256_set_ps(1.0f,-1.0f,1.0f,-1.0f,1.0f,-1.0f,1.0f,-1.0f); }
+        };
+
+#endif
+
+        // How the elements of a are combined with the rows of b, all viewed as reals
+        enum Mode {
+            REAL,   // a is real ... one broadcast per element
+            PAIR,   // a is complex and b was expanded to (b,b) pairs ... broadcast (re,im)
+            COMPLEX // a and b are complex ... re and im parts accumulated separately
+        };
+
+        template <typename S>
+        constexpr int nvec(int pw) { return (pw + ISA<S>::VW - 1)/ISA<S>::VW; }
+        constexpr int nacc(Mode mode) { return mode==COMPLEX ? 2 : 1; }
+        template <typename S>
+        constexpr int panel_width(Mode mode) { return (ISA<S>::NACC/nacc(mode))*ISA<S>::VW; }
+        template <typename S>
+        constexpr int row_block(Mode mode, int pw) {
+            return ISA<S>::NACC/(nacc(mode)*nvec<S>(pw)) < 1 ? 1 :
+                (ISA<S>::NACC/(nacc(mode)*nvec<S>(pw)) > ISA<S>::MAXIB ? ISA<S>::MAXIB :
+                 ISA<S>::NACC/(nacc(mode)*nvec<S>(pw)));
+        }
+
+        // Rows i..i+IB-1 of one panel of PW reals of c, held in registers over the k loop
+        template <typename S, Mode MODE, int PW, int IB>
+        inline void mTxmq_rows(long i, long dimi, long dimk, S* c, long ldc,
+                               const S* a, const S* b, long ldb) {
+            typedef ISA<S> isa;
+            typedef typename isa::vecT vecT;
+            const int NV = nvec<S>(PW);
+            const int REM = PW - (NV-1)*isa::VW; // Reals used in the last register
+            const int AS = (MODE==REAL) ? 1 : 2; // Reals per element of a
+
+            vecT acc[IB][NV], acc2[IB][NV];
+            for (int ii=0; ii<IB; ++ii) {
+                for (int v=0; v<NV; ++v) {
+                    acc[ii][v] = isa::zero();
+                    if (MODE==COMPLEX) acc2[ii][v] = isa::zero();
+                }
+            }
+
+            const S* ak = a + AS*i;
+            const S* bk = b;
+            for (long k=0; k<dimk; ++k, ak+=AS*dimi, bk+=ldb) {
+                vecT ar[IB], ai[IB];
+                for (int ii=0; ii<IB; ++ii) {
+                    if (MODE==PAIR) {
+                        ar[ii] = isa::bcast2(ak+2*ii);
+                    }
+                    else {
+                        ar[ii] = isa::bcast(ak+AS*ii);
+                        if (MODE==COMPLEX) ai[ii] = isa::bcast(ak+2*ii+1);
+                    }
+                }
+                for (int v=0; v<NV; ++v) {
+                    const vecT bv = (v==NV-1 && REM!=isa::VW) ?
+                        isa::load(bk+v*isa::VW, REM) : isa::load(bk+v*isa::VW);
+                    for (int ii=0; ii<IB; ++ii) {
+                        acc[ii][v] = isa::fmadd(ar[ii], bv, acc[ii][v]);
+                        if (MODE==COMPLEX) acc2[ii][v] = isa::fmadd(ai[ii], bv, acc2[ii][v]);
+                    }
+                }
+            }
+
+            for (int ii=0; ii<IB; ++ii) {
+                S* ci = c + (i+ii)*ldc;
+                for (int v=0; v<NV; ++v) {
+                    vecT r = acc[ii][v];
+                    // (ar + i ai)*(br + i bi) = ar*b + ai*(-bi, br)
+                    if (MODE==COMPLEX) r = isa::fmadd(isa::sign(), isa::swap(acc2[ii][v]), r);
+                    if (v==NV-1 && REM!=isa::VW)
+                        isa::store(ci+v*isa::VW, r, REM);
+                    else
+                        isa::store(ci+v*isa::VW, r);
+                }
+            }
+        }
+
+        // One panel of PW reals of c, blocked over rows
+        template <typename S, Mode MODE, int PW>
+        void mTxmq_panel(long dimi, long dimk, S* c, long ldc,
+                         const S* a, const S* b, long ldb) {
+            const int IB = row_block<S>(MODE, PW);
+            long i = 0;
+            for (; i+IB<=dimi; i+=IB) mTxmq_rows<S,MODE,PW,IB>(i, dimi, dimk, c, ldc, a, b, ldb);
+            for (; i<dimi; ++i) mTxmq_rows<S,MODE,PW,1>(i, dimi, dimk, c, ldc, a, b, ldb);
+        }
+
+        // All W reals of each row of c, split into panels that fit in the registers
+        template <typename S, Mode MODE, int W>
+        void mTxmq_kernel(long dimi, long dimk, S* c, long ldc,
+                          const S* a, const S* b, long ldb) {
+            const int P = panel_width<S>(MODE);
+            const int R = W%P;
+            for (int j0=0; j0+P<=W; j0+=P)
+                mTxmq_panel<S,MODE,P>(dimi, dimk, c+j0, ldc, a, b+j0, ldb);
+            if (R) mTxmq_panel<S,MODE,(R ? R : P)>(dimi, dimk, c+W-R, ldc, a, b+W-R, ldb);
+        }
+
+        template <typename S>
+        using kernelT = void (*)(long dimi, long dimk, S* c, long ldc,
+                                 const S* a, const S* b, long ldb);
+
+        template <typename S, Mode MODE, int MULT, int... J>
+        const kernelT<S>* make_kernel_table(std::integer_sequence<int, J...>) {
+            static const kernelT<S> table[] = {&mTxmq_kernel<S, MODE, MULT*(J+int(MTXMQ_SIMD_MINJ))>...};
+            return table;
+        }
+
+        /// The kernel for dimj columns of c, each of MULT reals of type S
+        template <typename S, Mode MODE, int MULT>
+        kernelT<S> mTxmq_kernel_for(long dimj) {
+            static const kernelT<S>* table = make_kernel_table<S,MODE,MULT>(
+                std::make_integer_sequence<int, int(MTXMQ_SIMD_MAXJ-MTXMQ_SIMD_MINJ+1)>());
+            return table[dimj-MTXMQ_SIMD_MINJ];
+        }
+
+        /// c = aT*b for all supported types with the columns of c in range
+        struct MTxmqKernels {
+            static void run(long dimi, long dimj, long dimk,
+                            double* c, const double* a, const double* b, long ldb) {
+                mTxmq_kernel_for<double,REAL,1>(dimj)(dimi, dimk, c, dimj, a, b, ldb);
+            }
+
+            static void run(long dimi, long dimj, long dimk,
+                            float* c, const float* a, const float* b, long ldb) {
+                mTxmq_kernel_for<float,REAL,1>(dimj)(dimi, dimk, c, dimj, a, b, ldb);
+            }
+
+            static void run(long dimi, long dimj, long dimk,
+                            std::complex<double>* c, const std::complex<double>* a,
+                            const std::complex<double>* b, long ldb) {
+                mTxmq_kernel_for<double,COMPLEX,2>(dimj)(dimi, dimk, reinterpret_cast<double*>(c), 2*dimj,
+                                                  reinterpret_cast<const double*>(a),
+                                                  reinterpret_cast<const double*>(b), 2*ldb);
+            }
+
+            static void run(long dimi, long dimj, long dimk,
+                            std::complex<double>* c, const std::complex<double>* a,
+                            const double* b, long ldb) {
+                // Duplicate each element of b so that a complex a can be
+                // broadcast as (re,im) pairs and the products land in place
+                double bx[2*MTXMQ_SIMD_MAXJ*MTXMQ_SIMD_MAXJ];
+                double* p = bx;
+                for (long k=0; k<dimk; ++k, b+=ldb) {
+                    for (long j=0; j<dimj; ++j, p+=2) p[0] = p[1] = b[j];
+                }
+                mTxmq_kernel_for<double,PAIR,2>(dimj)(dimi, dimk, reinterpret_cast<double*>(c), 2*dimj,
+                                               reinterpret_cast<const double*>(a), bx, 2*dimj);
+            }
+
+            static void run(long dimi, long dimj, long dimk,
+                            std::complex<double>* c, const double* a,
+                            const std::complex<double>* b, long ldb) {
+                mTxmq_kernel_for<double,REAL,2>(dimj)(dimi, dimk, reinterpret_cast<double*>(c), 2*dimj,
+                                               a, reinterpret_cast<const double*>(b), 2*ldb);
+            }
+        };
+
+    } // namespace
+} // namespace madness
+
+#endif // MADNESS_TENSOR_MTXMQ_KERNELS_H__INCLUDED
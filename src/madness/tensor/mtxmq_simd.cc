@@ -0,0 +1,180 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file tensor/mtxmq_simd.cc
+/// \brief Run-time dispatch of the x86 SIMD mTxmq kernels
+
+#include <madness/tensor/mtxmq_simd.h>
+#include <cstdlib>
+#include <cstring>
+
+// MADNESS_MTXMQ_AVX2 and MADNESS_MTXMQ_AVX512 are defined by the build
+// system for this file when the corresponding kernels are compiled
+#if !defined(X86_64)
+#undef MADNESS_MTXMQ_AVX2
+#undef MADNESS_MTXMQ_AVX512
+#endif
+
+namespace madness {
+
+#define MADNESS_MTXMQ_DECLARE(isa) \
+    void mTxmq_##isa(long, long, long, double*, const double*, const double*, long); \
+    void mTxmq_##isa(long, long, long, float*, const float*, const float*, long); \
+    void mTxmq_##isa(long, long, long, std::complex<double>*, const std::complex<double>*, \
+                     const std::complex<double>*, long); \
+    void mTxmq_##isa(long, long, long, std::complex<double>*, const std::complex<double>*, \
+                     const double*, long); \
+    void mTxmq_##isa(long, long, long, std::complex<double>*, const double*, \
+                     const std::complex<double>*, long);
+
+#ifdef MADNESS_MTXMQ_AVX2
+    MADNESS_MTXMQ_DECLARE(avx2)
+#endif
+#ifdef MADNESS_MTXMQ_AVX512
+    MADNESS_MTXMQ_DECLARE(avx512)
+#endif
+
+#undef MADNESS_MTXMQ_DECLARE
+
+    namespace {
+
+        // Best level supported by both this build and the CPU
+        SIMDLevel max_level() {
+            SIMDLevel level = SIMD_NONE;
+#ifdef MADNESS_MTXMQ_AVX2
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) level = SIMD_AVX2;
+#endif
+#ifdef MADNESS_MTXMQ_AVX512
+            if (__builtin_cpu_supports("avx512f")) level = SIMD_AVX512;
+#endif
+            return level;
+        }
+
+        SIMDLevel initial_level() {
+            SIMDLevel level = max_level();
+            const char* mad_simd = getenv("MAD_MTXMQ_SIMD");
+            if (mad_simd) {
+                SIMDLevel cap = SIMD_AVX512;
+                if (strcmp(mad_simd, "none") == 0 || strcmp(mad_simd, "0") == 0) cap = SIMD_NONE;
+                else if (strcmp(mad_simd, "avx2") == 0) cap = SIMD_AVX2;
+                if (cap < level) level = cap;
+            }
+            return level;
+        }
+
+        SIMDLevel& current_level() {
+            static SIMDLevel level = initial_level();
+            return level;
+        }
+
+        bool in_range(long dimi, long dimj, long dimk) {
+            return dimi > 0 && dimk > 0 && dimj >= MTXMQ_SIMD_MINJ && dimj <= MTXMQ_SIMD_MAXJ;
+        }
+
+    } // namespace
+
+    SIMDLevel mtxmq_simd_level() {
+        return current_level();
+    }
+
+    SIMDLevel set_mtxmq_simd_level(SIMDLevel level) {
+        const SIMDLevel max = max_level();
+        current_level() = (level > max) ? max : level;
+        return current_level();
+    }
+
+    const char* simd_level_name(SIMDLevel level) {
+        switch (level) {
+        case SIMD_AVX2: return "AVX2";
+        case SIMD_AVX512: return "AVX-512";
+        default: return "none";
+        }
+    }
+
+#if defined(MADNESS_MTXMQ_AVX2) && defined(MADNESS_MTXMQ_AVX512)
+#define MADNESS_MTXMQ_DISPATCH(args) \
+    switch (current_level()) { \
+    case SIMD_AVX512: mTxmq_avx512 args; return true; \
+    case SIMD_AVX2: mTxmq_avx2 args; return true; \
+    default: return false; \
+    }
+#elif defined(MADNESS_MTXMQ_AVX2)
+#define MADNESS_MTXMQ_DISPATCH(args) \
+    if (current_level() < SIMD_AVX2) return false; \
+    mTxmq_avx2 args; \
+    return true;
+#elif defined(MADNESS_MTXMQ_AVX512)
+#define MADNESS_MTXMQ_DISPATCH(args) \
+    if (current_level() < SIMD_AVX512) return false; \
+    mTxmq_avx512 args; \
+    return true;
+#else
+#define MADNESS_MTXMQ_DISPATCH(args) \
+    return false;
+#endif
+
+    bool mTxmq_simd(long dimi, long dimj, long dimk,
+                    double* c, const double* a, const double* b, long ldb) {
+        if (!in_range(dimi, dimj, dimk)) return false;
+        MADNESS_MTXMQ_DISPATCH((dimi, dimj, dimk, c, a, b, ldb))
+    }
+
+    bool mTxmq_simd(long dimi, long dimj, long dimk,
+                    float* c, const float* a, const float* b, long ldb) {
+        if (!in_range(dimi, dimj, dimk)) return false;
+        MADNESS_MTXMQ_DISPATCH((dimi, dimj, dimk, c, a, b, ldb))
+    }
+
+    bool mTxmq_simd(long dimi, long dimj, long dimk,
+                    std::complex<double>* c, const std::complex<double>* a,
+                    const std::complex<double>* b, long ldb) {
+        if (!in_range(dimi, dimj, dimk)) return false;
+        MADNESS_MTXMQ_DISPATCH((dimi, dimj, dimk, c, a, b, ldb))
+    }
+
+    bool mTxmq_simd(long dimi, long dimj, long dimk,
+                    std::complex<double>* c, const std::complex<double>* a,
+                    const double* b, long ldb) {
+        // b is expanded into a buffer of at most MAXJ*MAXJ pairs
+        if (!in_range(dimi, dimj, dimk) || dimk > MTXMQ_SIMD_MAXJ) return false;
+        MADNESS_MTXMQ_DISPATCH((dimi, dimj, dimk, c, a, b, ldb))
+    }
+
+    bool mTxmq_simd(long dimi, long dimj, long dimk,
+                    std::complex<double>* c, const double* a,
+                    const std::complex<double>* b, long ldb) {
+        if (!in_range(dimi, dimj, dimk)) return false;
+        MADNESS_MTXMQ_DISPATCH((dimi, dimj, dimk, c, a, b, ldb))
+    }
+
+#undef MADNESS_MTXMQ_DISPATCH
+
+}
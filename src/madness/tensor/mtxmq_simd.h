@@ -0,0 +1,103 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_TENSOR_MTXMQ_SIMD_H__INCLUDED
+#define MADNESS_TENSOR_MTXMQ_SIMD_H__INCLUDED
+
+#include <madness/madness_config.h>
+#include <complex>
+
+/// \file tensor/mtxmq_simd.h
+/// \brief Run-time dispatch of the x86 SIMD mTxmq kernels
+
+// The kernels are register blocked for a fixed number of columns, dimj,
+// and are instantiated for every dimj in [MTXMQ_SIMD_MINJ,MTXMQ_SIMD_MAXJ]
+// which covers both k and 2k for k=4..20 as well as the separation ranks
+// seen in low-rank transformations.  Each instruction set is compiled in
+// its own translation unit (mtxmq_avx2.cc, mtxmq_avx512.cc) and chosen at
+// run time from CPUID so that a single binary runs everywhere.
+
+namespace madness {
+
+    /// The instruction sets for which mTxmq kernels may be available
+    enum SIMDLevel {SIMD_NONE, SIMD_AVX2, SIMD_AVX512};
+
+    static const long MTXMQ_SIMD_MINJ = 4;  ///< Smallest dimj with a kernel
+    static const long MTXMQ_SIMD_MAXJ = 40; ///< Largest dimj with a kernel
+
+    /// Returns the instruction set currently used by mTxmq
+
+    /// Initially the best supported by both the build and the CPU, which
+    /// may be capped with the environment variable `MAD_MTXMQ_SIMD` set to
+    /// `none`, `avx2` or `avx512`.
+    SIMDLevel mtxmq_simd_level();
+
+    /// Selects the instruction set used by mTxmq (e.g., for benchmarking)
+
+    /// Not thread safe with respect to concurrent calls of mTxmq.
+    /// \param[in] level The requested level.
+    /// \return The level now in use, which is \c level capped at the best available.
+    SIMDLevel set_mtxmq_simd_level(SIMDLevel level);
+
+    /// Returns the name of an instruction set level
+    const char* simd_level_name(SIMDLevel level);
+
+    /// Matrix = Matrix transpose * matrix ... SIMD kernels if available
+
+    /// Computes \c c(i,j)=sum(k)a(k,i)*b(k,j) exactly as mTxmq does.
+    /// \return False if there is no kernel for this shape, type or CPU,
+    /// in which case \c c is untouched.
+    template <typename aT, typename bT, typename cT>
+    inline bool mTxmq_simd(long, long, long, cT*, const aT*, const bT*, long) {
+        return false;
+    }
+
+    bool mTxmq_simd(long dimi, long dimj, long dimk,
+                    double* c, const double* a, const double* b, long ldb);
+
+    bool mTxmq_simd(long dimi, long dimj, long dimk,
+                    float* c, const float* a, const float* b, long ldb);
+
+    bool mTxmq_simd(long dimi, long dimj, long dimk,
+                    std::complex<double>* c, const std::complex<double>* a,
+                    const std::complex<double>* b, long ldb);
+
+    bool mTxmq_simd(long dimi, long dimj, long dimk,
+                    std::complex<double>* c, const std::complex<double>* a,
+                    const double* b, long ldb);
+
+    bool mTxmq_simd(long dimi, long dimj, long dimk,
+                    std::complex<double>* c, const double* a,
+                    const std::complex<double>* b, long ldb);
+
+}
+
+#endif // MADNESS_TENSOR_MTXMQ_SIMD_H__INCLUDED
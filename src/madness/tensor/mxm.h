@@ -36,6 +36,7 @@
 #define MADNESS_TENSOR_MXM_H__INCLUDED
 
 #include <madness/madness_config.h>
+#include <madness/tensor/mtxmq_simd.h>
 
 #ifdef HAVE_INTEL_MKL
 #include <madness/tensor/cblas.h>
@@ -251,6 +252,9 @@ namespace madness {
         if (ldb == -1) ldb=dimj;
         MADNESS_ASSERT(ldb>=dimj);
 
+        // The small shapes of MRA are much faster with the SIMD kernels
+        if (mTxmq_simd(dimi, dimj, dimk, c, a, b, ldb)) return;
+
         if (dimi==0 || dimj==0) return; // nothing to do and *GEMM will complain
         if (dimk==0) {
             for (long i=0; i<dimi*dimj; i++) c[i] = 0.0;
@@ -297,6 +301,7 @@ namespace madness {
     template <typename aT, typename bT, typename cT>
     void mTxmq(long dimi, long dimj, long dimk,
                cT* MADNESS_RESTRICT c, const aT* a, const bT* b, long ldb=-1) {
+        if (mTxmq_simd(dimi, dimj, dimk, c, a, b, ldb == -1 ? dimj : ldb)) return;
         mTxmq_reference(dimi, dimj, dimk, c, a, b, ldb);
     }
 
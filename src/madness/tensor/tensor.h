@@ -35,6 +35,7 @@
 #include <madness/madness_config.h>
 #include <madness/misc/ran.h>
 #include <madness/world/posixmem.h>
+#include <madness/world/worldslab.h>
 
 #include <memory>
 #include <complex>
@@ -372,8 +373,14 @@ namespace madness {
                     _p = new T[_size];
                     _shptr = std::shared_ptr<T>(_p);
 #else
-                    if (posix_memalign((void **) &_p, TENSOR_ALIGNMENT, sizeof(T)*_size)) throw 1;
-                    _shptr.reset(_p, &free);
+                    // Registered sizes come from the thread-caching size
+                    // classes, large blocks are placed on the NUMA domain
+                    // of this thread, and the shared_ptr control block is
+                    // also drawn from the size classes
+                    SlabAllocator::Deleter deleter;
+                    _p = static_cast<T*>(SlabAllocator::allocate(sizeof(T)*_size, TENSOR_ALIGNMENT, deleter));
+                    if (!_p) throw 1;
+                    _shptr.reset(_p, deleter, SlabAllocator::Allocator<T>());
 #endif
                 }
                 catch (...) {
@@ -415,6 +415,23 @@ namespace {
         ITERATOR3(b,ASSERT_EQ(b(_i,_j,_k), a(_j,_i,_k)));
     }
 
+    TYPED_TEST(TensorTest, SlabAllocator) {
+        // A registered size must be recycled through the size classes
+        const long k = 7;
+        madness::SlabAllocator::register_size(k*k*k*sizeof(TypeParam));
+        const madness::SlabStats before = madness::SlabAllocator::get_stats();
+        for (int pass=0; pass<10; ++pass) {
+            madness::Tensor<TypeParam> a(k,k,k);
+            a.fillindex();
+            madness::Tensor<TypeParam> b = madness::copy(a);
+            ITERATOR3(b,ASSERT_EQ(b(_i,_j,_k), a(_i,_j,_k)));
+        }
+        const madness::SlabStats after = madness::SlabAllocator::get_stats();
+        ASSERT_GE(after.nalloc - before.nalloc, 20ul);
+        ASSERT_GE(after.nhit - before.nhit, 18ul);
+        ASSERT_EQ(after.bytes_in_use, before.bytes_in_use);
+    }
+
 //     TYPED_TEST(TensorTest, Container) {
 //         typedef madness::ConcurrentHashMap< int, Tensor<TypeParam> > containerT;
 //         static const int N = 100;
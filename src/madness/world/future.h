@@ -38,6 +38,7 @@
 #ifndef MADNESS_WORLD_FUTURE_H__INCLUDED
 #define MADNESS_WORLD_FUTURE_H__INCLUDED
 
+#include <atomic>
 #include <vector>
 #include <stack>
 #include <new>
@@ -46,6 +47,7 @@
 #include <madness/world/stack.h>
 #include <madness/world/worldref.h>
 #include <madness/world/world.h>
+#include <madness/world/worldslab.h>
 
 /// \addtogroup futures
 /// @{
@@ -181,6 +183,17 @@ namespace madness {
         typedef Stack<CallbackInterface*, MAXCALLBACKS> callbackT; ///< Callback type.
         typedef Stack<std::shared_ptr<FutureImpl<T> >,MAXCALLBACKS> assignmentT; ///< Assignment type.
 
+        static const int ASSIGNED = 1; ///< State bit set once the future has been assigned.
+        static const int STACKED = 2;  ///< State bit set once anything is pushed on the stacks.
+
+        /// The first callback, registered without taking the lock.
+
+        /// Almost every future has at most one callback (the task that
+        /// depends on it) and is assigned once.  That callback is kept here
+        /// and, if nothing was pushed on the stacks below, assignment does
+        /// not take the lock either.
+        std::atomic<CallbackInterface*> first_callback;
+
         /// A stack that stores callbacks that are invoked once the future has
         /// been assigned.
         volatile callbackT callbacks;
@@ -189,8 +202,8 @@ namespace madness {
         /// as this future, once it has been set.
         volatile mutable assignmentT assignments;
 
-        /// A flag indicating if the future has been set.
-        volatile bool assigned;
+        /// The \c ASSIGNED and \c STACKED flags.
+        std::atomic<int> state;
 
         /// Reference to a remote future pimpl.
         RemoteReference< FutureImpl<T> > remote_ref;
@@ -209,19 +222,21 @@ namespace madness {
             {
                 FutureImpl<T>* pimpl = ref.get();
 
-                ScopedMutex<Spinlock> fred(pimpl);
                 if(pimpl->remote_ref) {
                     // Unarchive the value to a temporary since it is going to
                     // be forwarded to another node.
                     T value;
                     input_arch & value;
 
-                    // Copy world and owner from remote_ref since sending remote_ref
-                    // will invalidate it.
-                    World& world = pimpl->remote_ref.get_world();
-                    const ProcessID owner = pimpl->remote_ref.owner();
-                    world.am.send(owner, FutureImpl<T>::set_handler,
-                            new_am_arg(pimpl->remote_ref, value));
+                    {
+                        ScopedMutex<Spinlock> fred(pimpl);
+                        // Copy world and owner from remote_ref since sending remote_ref
+                        // will invalidate it.
+                        World& world = pimpl->remote_ref.get_world();
+                        const ProcessID owner = pimpl->remote_ref.owner();
+                        world.am.send(owner, FutureImpl<T>::set_handler,
+                                new_am_arg(pimpl->remote_ref, value));
+                    }
 
                     pimpl->set_assigned(value);
                 } else {
@@ -235,23 +250,34 @@ namespace madness {
         }
 
 
-        /// \todo Brief description needed.
+        /// Marks the future assigned and runs the assignments and callbacks.
 
-        /// Invoked locally by set routine after assignment.
-        /// \todo Description needed.
-        /// \param[in] value Description needed.
+        /// Invoked locally by set routine after assignment.  Takes the lock
+        /// only if something was pushed on the stacks, and must not be
+        /// called with the lock held.
+        /// \param[in] value The value assigned.
         inline void set_assigned(const T& value) {
             // Assume that whoever is invoking this routine is holding
             // a copy of our shared pointer on its *stack* so that
             // if this future is destroyed as a result of a callback
             // the destructor of this object is not invoked until
             // we return.
-            //
-            // Also assume that the caller either has the lock
-            // or is sure that we are single threaded.
-            MADNESS_ASSERT(!assigned);
-            assigned = true;
+            const int s = state.fetch_or(ASSIGNED);
+            MADNESS_ASSERT(!(s & ASSIGNED));
+
+            // A callback registered concurrently either lands in the slot
+            // before this or sees ASSIGNED and takes itself back (see
+            // register_callback)
+            if (!(s & STACKED)) {
+                CallbackInterface* first = first_callback.exchange(nullptr);
+                if (first) first->notify();
+                return;
+            }
 
+            // Anyone who set STACKED before ASSIGNED holds the lock until
+            // they have pushed, and anyone later sees ASSIGNED and does not
+            // push, so once locked the stacks are complete.
+            ScopedMutex<Spinlock> fred(this);
             assignmentT& as = const_cast<assignmentT&>(assignments);
             callbackT& cb = const_cast<callbackT&>(callbacks);
 
@@ -261,6 +287,9 @@ namespace madness {
                 as.pop();
             }
 
+            CallbackInterface* first = first_callback.exchange(nullptr);
+            if (first) first->notify();
+
             while (!cb.empty()) {
                 MADNESS_ASSERT(cb.top());
                 cb.top()->notify();
@@ -277,7 +306,7 @@ namespace madness {
         /// \param[in] f Description needed.
         inline void add_to_assignments(const std::shared_ptr< FutureImpl<T> > f) {
             // ASSUME lock is already acquired
-            if (assigned) {
+            if (state.fetch_or(STACKED) & ASSIGNED) {
                 f->set(const_cast<T&>(t));
             }
             else {
@@ -291,9 +320,10 @@ namespace madness {
 
         /// Constructor that uses a local unassigned value.
         FutureImpl()
-                : callbacks()
+                : first_callback(nullptr)
+                , callbacks()
                 , assignments()
-                , assigned(false)
+                , state(0)
                 , remote_ref()
                 , t()
         { }
@@ -304,9 +334,10 @@ namespace madness {
         /// \todo Description needed.
         /// \param[in] remote_ref Description needed.
         FutureImpl(const RemoteReference< FutureImpl<T> >& remote_ref)
-                : callbacks()
+                : first_callback(nullptr)
+                , callbacks()
                 , assignments()
-                , assigned(false)
+                , state(0)
                 , remote_ref(remote_ref)
                 , t()
         { }
@@ -316,7 +347,7 @@ namespace madness {
 
         /// \return True if the value has been assigned; false otherwise.
         inline bool probe() const {
-            return assigned;
+            return state.load(std::memory_order_acquire) & ASSIGNED;
         }
 
 
@@ -324,12 +355,27 @@ namespace madness {
 
         /// Callbacks are invoked in the order registered. If the
         /// future is already assigned, the callback is immediately
-        /// invoked.
-        /// \todo Description needed.
-        /// \param callback Description needed.
+        /// invoked.  The first callback is registered without locking.
+        /// \param callback The callback to be invoked.
         inline void register_callback(CallbackInterface* callback) {
+            if (probe()) {
+                callback->notify();
+                return;
+            }
+
+            CallbackInterface* expected = nullptr;
+            if (first_callback.compare_exchange_strong(expected, callback)) {
+                // If the future was assigned meanwhile set_assigned may
+                // have already emptied the slot; whoever takes the callback
+                // out of the slot invokes it.
+                expected = callback;
+                if (probe() && first_callback.compare_exchange_strong(expected, nullptr))
+                    callback->notify();
+                return;
+            }
+
             ScopedMutex<Spinlock> fred(this);
-            if (assigned) callback->notify();
+            if (state.fetch_or(STACKED) & ASSIGNED) callback->notify();
             else const_cast<callbackT&>(callbacks).push(callback);
         }
 
@@ -341,14 +387,16 @@ namespace madness {
         /// \param[in] value Description needed.
         template <typename U>
         void set(const U& value) {
-            ScopedMutex<Spinlock> fred(this);
             if(remote_ref) {
-                // Copy world and owner from remote_ref since sending remote_ref
-                // will invalidate it.
-                World& world = remote_ref.get_world();
-                const ProcessID owner = remote_ref.owner();
-                world.am.send(owner, FutureImpl<T>::set_handler,
-                        new_am_arg(remote_ref, value));
+                {
+                    ScopedMutex<Spinlock> fred(this);
+                    // Copy world and owner from remote_ref since sending remote_ref
+                    // will invalidate it.
+                    World& world = remote_ref.get_world();
+                    const ProcessID owner = remote_ref.owner();
+                    world.am.send(owner, FutureImpl<T>::set_handler,
+                            new_am_arg(remote_ref, value));
+                }
                 set_assigned(value);
             } else {
                 set_assigned((const_cast<T&>(t) = value));
@@ -361,7 +409,6 @@ namespace madness {
         /// \todo Descriptions needed.
         /// \param[in] input_arch Description needed.
         void set(const archive::BufferInputArchive& input_arch) {
-            ScopedMutex<Spinlock> fred(this);
             MADNESS_ASSERT(! remote_ref);
             input_arch & const_cast<T&>(t);
             set_assigned(const_cast<T&>(t));
@@ -375,7 +422,7 @@ namespace madness {
         /// \return Description needed.
         T& get() {
             MADNESS_ASSERT(! remote_ref);  // Only for local futures
-            World::await([this] () -> bool { return this->probe(); });
+            if (! probe()) World::await([this] () -> bool { return this->probe(); });
             return *const_cast<T*>(&t);
         }
 
@@ -387,7 +434,7 @@ namespace madness {
         /// \return Description needed.
         const T& get() const {
             MADNESS_ASSERT(! remote_ref);  // Only for local futures
-            World::await([this] () -> bool { return this->probe(); });
+            if (! probe()) World::await([this] () -> bool { return this->probe(); });
             return *const_cast<const T*>(&t);
         }
 
@@ -424,12 +471,12 @@ namespace madness {
 
         /// \todo Perhaps a comment about its behavior.
         virtual ~FutureImpl() {
-            if (const_cast<callbackT&>(callbacks).size()) {
-                print("Future: uninvoked callbacks being destroyed?", assigned);
+            if (first_callback.load() || const_cast<callbackT&>(callbacks).size()) {
+                print("Future: uninvoked callbacks being destroyed?", probe());
                 abort();
             }
             if (const_cast<assignmentT&>(assignments).size()) {
-                print("Future: uninvoked assignment being destroyed?", assigned);
+                print("Future: uninvoked assignment being destroyed?", probe());
                 abort();
             }
         }
@@ -461,6 +508,9 @@ namespace madness {
         char buffer[sizeof(T)]; ///< Buffer to hold a single \c T object.
         T* const value; ///< Pointer to buffer when it holds a \c T object.
 
+        /// Allocates the implementation together with its reference count from the slab pools
+        typedef SlabAllocator::Allocator<FutureImpl<T>, 64> allocatorT;
+
         /// \todo Has something to do with the "Gotchas" section in \ref futures. More detail needed.
 
         /// \todo Perhaps more detail here, too... At the very least, can we give it a better name?
@@ -479,7 +529,7 @@ namespace madness {
 
         /// Makes an unassigned future.
         Future() :
-            f(new FutureImpl<T>()), value(nullptr)
+            f(std::allocate_shared< FutureImpl<T> >(allocatorT())), value(nullptr)
         { }
 
         /// Makes an assigned future.
@@ -497,8 +547,7 @@ namespace madness {
         explicit Future(const remote_refT& remote_ref) :
                 f(remote_ref.is_local() ?
                         remote_ref.get_shared() :
-                        std::make_shared<FutureImpl<T> >(remote_ref)),
-                //                        std::shared_ptr<FutureImpl<T> >(new FutureImpl<T>(remote_ref))),
+                        std::allocate_shared< FutureImpl<T> >(allocatorT(), remote_ref)),
                 value(nullptr)
         { }
 
@@ -523,7 +572,7 @@ namespace madness {
                 nullptr)
         {
             if(other.is_default_initialized())
-                f.reset(new FutureImpl<T>()); // Other was default constructed so make a new f
+                f = std::allocate_shared< FutureImpl<T> >(allocatorT()); // Other was default constructed so make a new f
         }
 
         /// Destructor.
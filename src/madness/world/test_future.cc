@@ -31,6 +31,7 @@
 
 #include <madness/world/MADworld.h>
 #include <string>
+#include <vector>
 
 using namespace madness;
 using namespace std;
@@ -46,6 +47,83 @@ public:
     }
 };
 
+class Counter : public CallbackInterface {
+public:
+    long n;
+
+    Counter() : n(0) {}
+
+    void notify() { ++n; }
+};
+
+// Sets a future from a pool thread
+class Setter : public TaskInterface {
+    Future<int> f;
+    const int i;
+public:
+    Setter(const Future<int>& f, int i) : f(f), i(i) {}
+
+    void run(World& world) { f.set(i); }
+};
+
+AtomicInt nrun;
+AtomicInt nodd;
+
+void count_odd(int i) {
+    nrun++;
+    if (i & 1) nodd++;
+}
+
+// Dependent tasks register their callback while the value may be being set
+void test_race(World& world) {
+    const int n = 100000;
+    nrun = 0;
+    nodd = 0;
+    for (int i=0; i<n; ++i) {
+        Future<int> f;
+        world.taskq.add(new Setter(f, i));
+        world.taskq.add(count_odd, f);
+    }
+    world.taskq.fence();
+    MADNESS_ASSERT(nrun == n && nodd == n/2);
+}
+
+// Times the life of a future with one callback: make, register, copy, set
+void bench_future(World& world) {
+    const int nrep = 16, nfut = 1<<16;
+    Counter counter;
+    std::vector< Future<double> > futures;
+    futures.reserve(nfut);
+
+    double used[2] = {-wall_time(), 0.0};
+    for (int rep=0; rep<nrep; ++rep) {
+        for (int i=0; i<nfut; ++i) {
+            Future<double> f;
+            f.register_callback(&counter);
+            Future<double> g(f);
+            f.set(double(i));
+            MADNESS_ASSERT(g.get() == i);
+        }
+    }
+    used[0] += wall_time();
+
+    // Many futures outstanding at once as when spawning a tree of tasks
+    used[1] = -wall_time();
+    for (int rep=0; rep<nrep; ++rep) {
+        for (int i=0; i<nfut; ++i) {
+            futures.push_back(Future<double>());
+            futures.back().register_callback(&counter);
+        }
+        for (int i=0; i<nfut; ++i) futures[i].set(double(i));
+        futures.clear();
+    }
+    used[1] += wall_time();
+    MADNESS_ASSERT(counter.n == 2*nrep*nfut);
+
+    if (world.rank() == 0)
+        print("future with callback: one at a time", 1e9*used[0]/(nrep*nfut),
+              "ns, batched", 1e9*used[1]/(nrep*nfut), "ns");
+}
 
 int main(int argc, char** argv) {
     madness::initialize(argc,argv);
@@ -66,6 +144,9 @@ int main(int argc, char** argv) {
 
     print(s.get(), ggg.get());
 
+    test_race(world);
+    bench_future(world);
+
     madness::finalize();
     return 0;
 }
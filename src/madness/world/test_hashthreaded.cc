@@ -384,6 +384,72 @@ void test_accessors() {
     if (a[1] != 20000000.0) MADNESS_EXCEPTION("Ooops", int(a[1]));
 }
 
+class Hammer : public madness::ThreadBase {
+private:
+    ConcurrentHashMap<int,double>& a; // Better would be a shared pointer
+    const int id, nthread, nkey, nop, phase;
+
+public:
+    Hammer(ConcurrentHashMap<int,double>& a, int id, int nthread, int nkey, int nop, int phase)
+            : ThreadBase(), a(a), id(id), nthread(nthread), nkey(nkey), nop(nop), phase(phase) {
+        start();
+    }
+
+    void run() {
+        typedef ConcurrentHashMap<int,double>::datumT datumT;
+        if (phase == 0) {
+            // Each thread inserts its own share of the keys
+            for (int key=id; key<nkey; key+=nthread) a.insert(datumT(key,key));
+        }
+        else {
+            // Random finds, with every tenth operation inserting a new key in the last phase
+            unsigned long seed = 76521 + id;
+            for (int i=0; i<nop; ++i) {
+                if (phase == 2 && i%10 == 0) {
+                    const int key = nkey + (i/10)*nthread + id;
+                    a.insert(datumT(key,key));
+                }
+                else {
+                    seed = seed*1812433253ul + 12345;
+                    const int key = int((seed >> 16) % nkey);
+                    ConcurrentHashMap<int,double>::const_accessor r;
+                    if (!a.find(r, key)) MADNESS_EXCEPTION("Hammer: missing key", key);
+                    if (r->second != key) MADNESS_EXCEPTION("Hammer: wrong value", key);
+                }
+            }
+        }
+
+        ndone++;
+    }
+};
+
+
+void test_throughput() {
+    // Many threads filling and searching a map that starts with as many
+    // bins as a WorldContainer, until it holds a million entries
+    const int nthread = 64;
+    const int nkey = 1<<20;
+    const int nop = 1<<15;
+    const char* names[] = {"insert", "find", "find+insert"};
+    ConcurrentHashMap<int,double> a(5011);
+    vector<Hammer*> hammers;
+
+    for (int phase=0; phase<3; ++phase) {
+        ndone = 0;
+        double used = madness::wall_time();
+        for (int id=0; id<nthread; ++id)
+            hammers.push_back(new Hammer(a, id, nthread, nkey, nop, phase));
+        while (ndone != nthread) sched_yield();
+        used = madness::wall_time() - used;
+        const double nops = (phase == 0) ? nkey : double(nthread)*nop;
+        printf("%d threads  %-12s %8.2f Mops/s\n", nthread, names[phase], 1e-6*nops/used);
+    }
+
+    if (a.size() != size_t(nkey + nthread*((nop+9)/10)))
+        cout << "throughput: expected size " << nkey + nthread*((nop+9)/10) << " " << a.size() << endl;
+    for (size_t i=0; i<hammers.size(); ++i) delete hammers[i];
+}
+
 int main(int argc, char** argv) {
     madness::initialize(argc,argv);
     try {
@@ -392,6 +458,7 @@ int main(int argc, char** argv) {
         test_time();
         test_thread();
         test_accessors();
+        test_throughput();
 
         cout << "Things seem to be working!\n";
     }
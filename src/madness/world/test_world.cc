@@ -31,6 +31,8 @@
 
 #include <vector>
 #include <numeric>
+#include <sstream>
+#include <cstdio>
 
 #define WORLD_INSTANTIATE_STATIC_TEMPLATES
 #include <madness/world/MADworld.h>
@@ -1124,6 +1126,234 @@ void test13(World& world) {
     world.gop.fence();
 }
 
+AtomicInt ntree_task;
+
+// Binary tree of tasks, each spawning its children much like compress_spawn
+void tree_task(World* world, int depth, int nwork) {
+    ntree_task++;
+    volatile double sum = 0.0;
+    for (int i=0; i<nwork; ++i) sum += 1.0/(i+1);
+    if (depth > 0) {
+        world->taskq.add(tree_task, world, depth-1, nwork);
+        world->taskq.add(tree_task, world, depth-1, nwork);
+    }
+}
+
+void test14(World& world) {
+    PROFILE_FUNC;
+    // Compare the shared-queue and work-stealing schedulers on fine-grained trees
+    const int depth = 16;
+    const int ntask = (1<<(depth+1)) - 1;
+    const bool stealing = ThreadPool::get_work_stealing();
+
+    world.gop.fence();
+    const int nworks[] = {0, 100, 1000};
+    for (int nwork : nworks) {
+        double used[2];
+        for (int mode=0; mode<2; ++mode) {
+            ThreadPool::set_work_stealing(mode == 1);
+            ntree_task = 0;
+            used[mode] = -wall_time();
+            world.taskq.add(tree_task, &world, depth, nwork);
+            world.taskq.fence();
+            used[mode] += wall_time();
+            MADNESS_ASSERT(ntree_task == ntask);
+        }
+        print("Time to run", ntask, "tree tasks with", nwork, "work: shared",
+              used[0], "steal", used[1], "speedup", used[0]/used[1]);
+    }
+    ThreadPool::set_work_stealing(stealing);
+
+    WSStats ws = ThreadPool::get_ws_stats();
+    print("work-stealing npush", ws.npush, "npop", ws.npop, "nsteal", ws.nsteal);
+    if (world.rank() == 0) print("test14 (work-stealing scheduler) OK");
+}
+
+void test15(World& world) {
+    PROFILE_FUNC;
+    // Short and long inputs take different paths through gop.reduce
+    const ProcessID me = world.rank();
+    const int nproc = world.size();
+    const size_t lengths[] = {1, 7, 1000, 100000};
+    for (size_t n : lengths) {
+        std::vector<double> v(n), w(n);
+        std::vector<long> l(n);
+        for (size_t i=0; i<n; ++i) {
+            v[i] = 1.0/(me + i + 1);
+            w[i] = me + double(i);
+            l[i] = me + long(i);
+        }
+        world.gop.sum(v.data(), n);
+        world.gop.max(w.data(), n);
+        world.gop.sum(l.data(), n);
+        for (size_t i=0; i<n; ++i) {
+            double sum = 0.0;
+            for (int p=0; p<nproc; ++p) sum += 1.0/(p + i + 1);
+            MADNESS_ASSERT(std::abs(v[i] - sum) <= 1e-14*sum);
+            MADNESS_ASSERT(w[i] == nproc - 1 + double(i));
+            MADNESS_ASSERT(l[i] == long(nproc*i) + nproc*(nproc-1)/2);
+        }
+
+        // All processes must hold the same bits
+        std::vector<double> vmin(v), vmax(v);
+        world.gop.min(vmin.data(), n);
+        world.gop.max(vmax.data(), n);
+        MADNESS_ASSERT(vmin == v && vmax == v);
+    }
+
+    // Non-blocking reductions complete while the main thread does other work
+    std::vector<long> a(100, me+1);
+    Future< std::vector<long> > fa = world.gop.sum_async(a);
+    Future< std::vector<long> > fb = world.gop.reduce_async(a, WorldMaxOp<long>());
+    Future<double> fc = world.gop.sum_async(double(me));
+    for (long x : fa.get()) MADNESS_ASSERT(x == nproc*(nproc+1)/2);
+    for (long x : fb.get()) MADNESS_ASSERT(x == nproc);
+    MADNESS_ASSERT(fc.get() == nproc*(nproc-1)/2);
+    world.gop.fence();
+
+    if (me == 0) print("test15 (global reductions) OK");
+}
+
+void test16(World& world) {
+    PROFILE_FUNC;
+    // Record a tree of tasks and a fence then read back the dump
+    const int depth = 8;
+    const int ntask = (1<<(depth+1)) - 1;
+    const bool tracing = Tracer::enabled();
+
+    world.gop.fence();
+    Tracer::clear();
+    Tracer::enable();
+    ntree_task = 0;
+    world.taskq.add(tree_task, &world, depth, 0);
+    world.gop.fence();
+    Tracer::disable();
+    MADNESS_ASSERT(ntree_task == ntask);
+
+    // Nothing is recorded while disabled
+    world.taskq.add(tree_task, &world, depth, 0);
+    world.taskq.fence();
+
+    std::stringstream file_name;
+    file_name << "test_world_trace_" << world.rank();
+    MADNESS_ASSERT(Tracer::dump(file_name.str().c_str(), world.rank()));
+
+    FILE* f = fopen(file_name.str().c_str(), "rb");
+    MADNESS_ASSERT(f);
+    char magic[8];
+    uint32_t version, nname, nthread;
+    int32_t rank;
+    uint64_t epoch;
+    MADNESS_ASSERT(fread(magic, 8, 1, f) == 1 && std::string(magic, 8) == "MADTRACE");
+    MADNESS_ASSERT(fread(&version, 4, 1, f) == 1 && version == 1);
+    MADNESS_ASSERT(fread(&rank, 4, 1, f) == 1 && rank == world.rank());
+    MADNESS_ASSERT(fread(&epoch, 8, 1, f) == 1);
+    MADNESS_ASSERT(fread(&nname, 4, 1, f) == 1 && nname > 0);
+    for (uint32_t i=0; i<nname; ++i) {
+        uint32_t len;
+        MADNESS_ASSERT(fread(&len, 4, 1, f) == 1);
+        std::string name(len, ' ');
+        MADNESS_ASSERT(len == 0 || fread(&name[0], len, 1, f) == 1);
+    }
+    MADNESS_ASSERT(fread(&nthread, 4, 1, f) == 1 && nthread > 0);
+    long count[Tracer::NKIND] = {0};
+    for (uint32_t t=0; t<nthread; ++t) {
+        uint32_t id;
+        uint64_t n;
+        MADNESS_ASSERT(fread(&id, 4, 1, f) == 1 && fread(&n, 8, 1, f) == 1);
+        uint64_t prev = 0;
+        for (uint64_t i=0; i<n; ++i) {
+            uint64_t time, arg;
+            uint32_t kind, name, pad;
+            int32_t peer;
+            MADNESS_ASSERT(fread(&time, 8, 1, f) == 1 && fread(&arg, 8, 1, f) == 1);
+            MADNESS_ASSERT(fread(&kind, 4, 1, f) == 1 && fread(&peer, 4, 1, f) == 1);
+            MADNESS_ASSERT(fread(&name, 4, 1, f) == 1 && fread(&pad, 4, 1, f) == 1);
+            MADNESS_ASSERT(kind < Tracer::NKIND && time >= prev);
+            MADNESS_ASSERT(name == 0xffffffffu || name < nname);
+            prev = time;
+            ++count[kind];
+        }
+    }
+    fclose(f);
+    remove(file_name.str().c_str());
+
+    // Other tasks (e.g., from the fence) may also have run
+    MADNESS_ASSERT(count[Tracer::TASK_SPAWN] >= ntask && count[Tracer::TASK_SPAWN] < 2*ntask);
+    MADNESS_ASSERT(count[Tracer::TASK_BEGIN] == count[Tracer::TASK_END]);
+    MADNESS_ASSERT(count[Tracer::TASK_BEGIN] >= ntask);
+    MADNESS_ASSERT(count[Tracer::FENCE_BEGIN] == 1 && count[Tracer::FENCE_END] == 1);
+
+    if (tracing) Tracer::enable();
+    if (world.rank() == 0) print("test16 (event tracing) OK");
+}
+
+// Receives ordered messages larger than the RMI buffers
+class HugeSink : public WorldObject<HugeSink> {
+    std::vector<long> next; // Next sequence number expected from each process
+    AtomicInt nrecv;
+public:
+    HugeSink(World& world) : WorldObject<HugeSink>(world), next(world.size(), 0) {
+        nrecv = 0;
+        process_pending();
+    }
+
+    // Runs on the server thread so ordered messages from one process arrive one at a time
+    void recv_ordered(ProcessID from, long seq, const std::vector<double>& v) {
+        MADNESS_ASSERT(seq == next[from]);
+        MADNESS_ASSERT(v.front() == from + seq && v.back() == from + seq + double(v.size()));
+        ++next[from];
+    }
+
+    void recv(ProcessID from, const std::vector<double>& v) {
+        MADNESS_ASSERT(v.front() == from && v.back() == from + double(v.size()));
+        nrecv++;
+    }
+
+    long nordered(ProcessID p) const { return next[p]; }
+    int nunordered() const { return nrecv; }
+};
+
+std::vector<double> huge_vector(World& world, double first, bool huge) {
+    const std::size_t len = (world.size() > 1 ? RMI::max_msg_len() : 1024);
+    std::vector<double> v(huge ? len/sizeof(double) + 5 : 16);
+    for (std::size_t i=0; i<v.size(); ++i) v[i] = first + double(i);
+    v.back() = first + double(v.size());
+    return v;
+}
+
+void send_huge(HugeSink* sink, ProcessID p) {
+    World& world = sink->get_world();
+    sink->send(p, &HugeSink::recv, world.rank(), huge_vector(world, world.rank(), true));
+}
+
+void test17(World& world) {
+    PROFILE_FUNC;
+    // Huge and small ordered messages from one thread must arrive in order,
+    // and huge messages from many threads at once must all arrive
+    const ProcessID me = world.rank();
+    const int nproc = world.size();
+    const long nmsg = 20;
+    const int ntask = 4;
+    HugeSink sink(world);
+    world.gop.fence();
+
+    for (int t=0; t<ntask; ++t) {
+        for (ProcessID p=0; p<nproc; ++p) world.taskq.add(send_huge, &sink, p);
+    }
+    for (long seq=0; seq<nmsg; ++seq) {
+        for (ProcessID p=0; p<nproc; ++p) {
+            sink.send(p, &HugeSink::recv_ordered, me, seq, huge_vector(world, me + seq, seq%3 != 1));
+        }
+    }
+    world.gop.fence();
+
+    for (ProcessID p=0; p<nproc; ++p) MADNESS_ASSERT(sink.nordered(p) == nmsg);
+    MADNESS_ASSERT(sink.nunordered() == ntask*nproc);
+    world.gop.fence();
+    if (me == 0) print("test17 (huge messages) OK");
+}
+
 inline bool is_odd(int i) {
     return i & 0x1;
 }
@@ -1288,6 +1518,10 @@ int main(int argc, char** argv) {
         //test11(world);
         test12(world);
         test13(world);
+        test14(world);
+        test15(world);
+        test16(world);
+        test17(world);
 
         for (int i=0; i<10; ++i) {
           print("REPETITION",i);
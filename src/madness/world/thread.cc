@@ -74,6 +74,7 @@ namespace madness {
 
     ThreadPool* ThreadPool::instance_ptr = 0;
     double ThreadPool::await_timeout = 900.0;
+    thread_local unsigned int ThreadPool::steal_seed = 0;
 #if HAVE_INTEL_TBB
     tbb::task_scheduler_init* ThreadPool::tbb_scheduler = 0;
 #endif
@@ -338,12 +339,14 @@ namespace madness {
 #endif
     // The constructor is private to enforce the singleton model
     ThreadPool::ThreadPool(int nthread) :
-            threads(nullptr), main_thread(), nthreads(nthread), finish(false)
+            threads(nullptr), main_thread(), deques(nullptr), nthreads(nthread),
+            finish(false), work_stealing(false)
     {
         nfinished = 0;
         instance_ptr = this;
         if (nthreads < 0) nthreads = default_nthread();
         MADNESS_ASSERT(nthreads >= 0);
+        NUMA::initialize(nthreads);
 
         const int rc = pthread_setspecific(ThreadBase::thread_key,
                 static_cast<void*>(&main_thread));
@@ -393,11 +396,24 @@ namespace madness {
         }
 #else
 
+        const char* mad_task_queue = getenv("MAD_TASK_QUEUE");
+        if (mad_task_queue) {
+            if (strcmp(mad_task_queue, "steal") == 0)
+                work_stealing = true;
+            else if (strcmp(mad_task_queue, "shared") != 0 &&
+                     SafeMPI::COMM_WORLD.Get_rank() == 0)
+                std::cout << "!!MADNESS WARNING: Invalid task queue.\n"
+                          << "!!MADNESS WARNING: MAD_TASK_QUEUE = " << mad_task_queue << "\n";
+        }
+
         try {
-            if (nthreads > 0)
+            if (nthreads > 0) {
                 threads = new ThreadPoolThread[nthreads];
-            else
+                deques = new WSDeque<PoolTaskInterface*>[nthreads];
+            }
+            else {
                 threads = 0;
+            }
         }
         catch (...) {
             MADNESS_EXCEPTION("memory allocation failed", 0);
@@ -439,12 +455,26 @@ namespace madness {
     void ThreadPool::thread_main(ThreadPoolThread* const thread) {
         PROFILE_MEMBER_FUNC(ThreadPool);
         thread->set_affinity(2, thread->get_pool_thread_index());
+        NUMA::bind_pool_thread(thread->get_pool_thread_index(), nthreads,
+                               ThreadBase::bind[2]);
 
 #if !HAVE_PARSEC
 #define MULTITASK
 #ifdef  MULTITASK
+        const int index = thread->get_pool_thread_index();
+        MutexWaiter waiter;
         while (!finish) {
-            run_tasks(true, thread);
+            if (work_stealing) {
+                // Cannot block on the shared queue since work may appear
+                // in any deque, so back off instead
+                if (run_tasks_stealing(index, thread))
+                    waiter.reset();
+                else
+                    waiter.wait();
+            }
+            else {
+                run_tasks(true, thread);
+            }
         }
 #else
         while (!finish) {
@@ -524,13 +554,73 @@ namespace madness {
 #endif
     }
 
+    bool ThreadPool::run_tasks_stealing(const int index, ThreadPoolThread* const this_thread) {
+#if HAVE_INTEL_TBB
+        MADNESS_EXCEPTION("run_tasks_stealing should not be called when using Intel TBB", 1);
+#else
+        // High-priority, multi-threaded and externally submitted tasks
+        if (!queue.empty() && run_tasks(false, this_thread))
+            return true;
+
+        PoolTaskInterface* task = nullptr;
+        if (index >= 0 && deques[index].pop(task)) {
+            run_one(task, this_thread);
+            return true;
+        }
+
+        if (nthreads == 0) return false;
+
+        // On a NUMA node first look for victims on our own domain, whose
+        // tasks most likely touched memory local to us, then anywhere
+        const int domain = NUMA::this_thread_domain();
+        const int nattempts = (domain >= 0) ? 2*nsteal_attempts : nsteal_attempts;
+
+        // xorshift ... seeded so that threads start on different victims
+        unsigned int x = steal_seed;
+        if (x == 0) x = 2654435761u*(unsigned int)(index + 2);
+        for (int attempt=0; attempt<nattempts; ++attempt) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            const int victim = x % nthreads;
+            if (attempt < nsteal_attempts && domain >= 0 &&
+                NUMA::pool_thread_domain(victim) != domain) continue;
+            if (victim != index && deques[victim].steal(task)) {
+                steal_seed = x;
+                if (index >= 0) deques[index].count_steal();
+                run_one(task, this_thread);
+                return true;
+            }
+        }
+        steal_seed = x;
+        return false;
+#endif
+    }
+
+    void ThreadPool::set_work_stealing(bool enable) {
+#if !HAVE_INTEL_TBB && !HAVE_PARSEC
+        ThreadPool* const pool = instance();
+        if (pool->work_stealing == enable) return;
+        pool->work_stealing = enable;
+        // Wake up threads blocked on the shared queue so that they
+        // notice the change.
+        if (enable) {
+            for (int i=0; i<pool->nthreads; ++i)
+                add(new PoolTaskNull);
+        }
+#endif
+    }
+
     void ThreadPool::end() {
 #if !HAVE_INTEL_TBB
         if (!instance_ptr) return;
         instance()->finish = true;
 #if !HAVE_PARSEC
-        for (int i=0; i<instance()->nthreads; ++i) {
-            add(new PoolTaskNull);
+        // Work-stealing threads never block so do not need waking
+        if (!instance()->work_stealing) {
+            for (int i=0; i<instance()->nthreads; ++i) {
+                add(new PoolTaskNull);
+            }
         }
         while (instance_ptr->nfinished != instance_ptr->nthreads);
 #else  /* HAVE_PARSEC */
@@ -558,4 +648,19 @@ namespace madness {
         return instance()->queue.get_stats();
     }
 
+    WSStats ThreadPool::get_ws_stats() {
+        WSStats total;
+        const ThreadPool* const pool = instance();
+        if (pool->deques) {
+            for (int i=0; i<pool->nthreads; ++i) {
+                const WSStats& stats = pool->deques[i].get_stats();
+                total.npush += stats.npush;
+                total.npop += stats.npop;
+                total.nsteal += stats.nsteal;
+                total.ngrow += stats.ngrow;
+            }
+        }
+        return total;
+    }
+
 } // namespace madness
@@ -39,6 +39,9 @@
 */
 
 #include <madness/world/dqueue.h>
+#include <madness/world/wsdeque.h>
+#include <madness/world/worldnuma.h>
+#include <madness/world/worldtrace.h>
 #include <madness/world/function_traits.h>
 #include <vector>
 #include <cstddef>
@@ -916,6 +919,8 @@ namespace madness {
             // A downside is this does not preserve any relationships between thread
             // numbering and the architecture ... more work ahead.
             int nthread = get_nthread();
+            const bool tracing = Tracer::enabled();
+            if (tracing) Tracer::record(Tracer::TASK_BEGIN, typeid(*this).name());
             if (nthread == 1) {
 #ifdef MADNESS_TASK_PROFILING
                 task_event_->start(id_, nthread, submit_time_);
@@ -924,6 +929,7 @@ namespace madness {
 #ifdef MADNESS_TASK_PROFILING
                 task_event_->stop();
 #endif // MADNESS_TASK_PROFILING
+                if (tracing) Tracer::record(Tracer::TASK_END, typeid(*this).name());
                 return true;
             }
             else {
@@ -937,6 +943,7 @@ namespace madness {
 #endif // MADNESS_TASK_PROFILING
 
                 run(TaskThreadEnv(nthread, id, barrier));
+                if (tracing) Tracer::record(Tracer::TASK_END, typeid(*this).name());
 
 #ifdef MADNESS_TASK_PROFILING
                 const bool cleanup = barrier->enter(id);
@@ -1143,6 +1150,20 @@ namespace madness {
 
     /// A singleton pool of threads for dynamic execution of tasks.
 
+    /// Two schedulers are available and may be selected at runtime (see
+    /// \c set_work_stealing() or the environment variable
+    /// `MAD_TASK_QUEUE`, which may be `shared` (default) or `steal`).
+    /// - shared: all tasks go through one \c DQueue guarded by a single
+    ///   lock and workers pop them in batches of up to \c nmax.
+    /// - steal: each pool thread owns a \c WSDeque.  Tasks submitted
+    ///   by a pool thread are pushed onto its own deque and popped LIFO;
+    ///   idle threads steal the oldest task from a randomly chosen victim.
+    ///   The shared queue is retained for tasks submitted by threads
+    ///   outside the pool (main, RMI server), for multi-threaded tasks,
+    ///   and for high-priority tasks which are still pushed onto its front
+    ///   and are always looked for first.  On a NUMA node (see \c NUMA)
+    ///   thieves first try victims on their own domain.
+    ///
     /// \attention You must instantiate the pool while running with just one
     /// thread.
     class ThreadPool {
@@ -1153,14 +1174,18 @@ namespace madness {
         ThreadPoolThread *threads; ///< Array of threads.
         ThreadPoolThread main_thread; ///< Placeholder for main thread tls.
         DQueue<PoolTaskInterface*> queue; ///< Queue of tasks.
+        WSDeque<PoolTaskInterface*>* deques; ///< Per-thread work-stealing deques.
         int nthreads; ///< Number of threads.
         volatile bool finish; ///< Set to true when time to stop.
+        volatile bool work_stealing; ///< Set to true to use the per-thread deques.
         AtomicInt nfinished; ///< Thread pool exit counter.
 
         // Static data
         static ThreadPool* instance_ptr; ///< Singleton pointer.
         static const int nmax = 128; ///< Number of task a worker thread will pop from the task queue
+        static const int nsteal_attempts = 4; ///< Number of random victims tried per steal round
         static double await_timeout; ///< Waiter timeout.
+        static thread_local unsigned int steal_seed; ///< Per-thread state for victim selection.
 
 #if defined(HAVE_IBMBGQ) and defined(HPM)
         static unsigned int main_hpmctx; ///< HPM context for main thread.
@@ -1251,6 +1276,37 @@ namespace madness {
 #endif
         }
 
+        /// Run one task, or one batch from the shared queue, in work-stealing mode.
+
+        /// The shared queue is checked first (it holds high-priority tasks
+        /// and tasks from outside the pool), then the thread's own deque,
+        /// then up to \c nsteal_attempts randomly chosen victims.  Never blocks.
+        /// \param[in] index Index of the calling pool thread, or -1 if
+        ///     the caller is not in the pool and so owns no deque.
+        /// \param[in,out] this_thread Thread data (used only by the profiler).
+        /// \return True if a task was run.
+        bool run_tasks_stealing(const int index, ThreadPoolThread* const this_thread);
+
+        /// Run a single task popped from a deque.
+
+        /// \param[in,out] task The task.
+        /// \param[in,out] this_thread Thread data (used only by the profiler).
+        static void run_one(PoolTaskInterface* task, ThreadPoolThread* const this_thread) {
+#ifdef MADNESS_TASK_PROFILING
+            profiling::TaskEventList* event_list =
+                    this_thread->profiler().new_list(1);
+            task->set_event(event_list->event());
+#endif // MADNESS_TASK_PROFILING
+            if (task->run_multi_threaded())
+                delete task;
+        }
+
+        /// Index of the calling thread in the pool or -1 if not a pool thread.
+        static int pool_thread_index() {
+            const ThreadBase* thread = ThreadBase::this_thread();
+            return thread ? thread->get_pool_thread_index() : -1;
+        }
+
         /// \todo Brief description needed.
 
         /// \todo Description needed.
@@ -1308,6 +1364,8 @@ namespace madness {
 #ifdef MADNESS_TASK_PROFILING
             task->submit();
 #endif // MADNESS_TASK_PROFILING
+            if (task && Tracer::enabled())
+                Tracer::record(Tracer::TASK_SPAWN, typeid(*task).name());
 
             //////////// Parsec Related Begin ////////////////////
             /* Initialize the execution context and give it to the scheduler*/
@@ -1325,14 +1383,23 @@ namespace madness {
             }
 #else
             if (!task) MADNESS_EXCEPTION("ThreadPool: inserting a NULL task pointer", 1);
+            ThreadPool* const pool = instance();
             int task_threads = task->get_nthread();
             // Currently multithreaded tasks must be shoved on the end of the q
             // to avoid a race condition as multithreaded task is starting up
             if (task->is_high_priority() && (task_threads == 1)) {
-                instance()->queue.push_front(task);
+                pool->queue.push_front(task);
+            }
+            else if (pool->work_stealing && (task_threads == 1)) {
+                // Only pool threads own a deque; everyone else uses the shared queue
+                const int index = pool_thread_index();
+                if (index >= 0)
+                    pool->deques[index].push(task);
+                else
+                    pool->queue.push_back(task);
             }
             else {
-                instance()->queue.push_back(task, task_threads);
+                pool->queue.push_back(task, task_threads);
             }
 #endif // HAVE_INTEL_TBB
         }
@@ -1389,7 +1456,10 @@ namespace madness {
             ThreadPoolThread* const thread = nullptr;
 #endif // MADNESS_TASK_PROFILING
 
-            return instance()->run_tasks(false, thread);
+            ThreadPool* const pool = instance();
+            if (pool->work_stealing)
+                return pool->run_tasks_stealing(pool_thread_index(), thread);
+            return pool->run_tasks(false, thread);
 #endif // HAVE_INTEL_TBB
         }
 
@@ -1402,9 +1472,17 @@ namespace madness {
 
         /// Returns the number of tasks in the queue.
 
+        /// In work-stealing mode this includes the tasks in all of the
+        /// per-thread deques and so is only approximate.
         /// \return The number of tasks in the queue.
         static std::size_t queue_size() {
-            return instance()->queue.size();
+            const ThreadPool* const pool = instance();
+            std::size_t n = pool->queue.size();
+            if (pool->deques) {
+                for (int i=0; i<pool->nthreads; ++i)
+                    n += pool->deques[i].size();
+            }
+            return n;
         }
 
         /// Returns queue statistics.
@@ -1412,6 +1490,27 @@ namespace madness {
         /// \return Queue statistics.
         static const DQStats& get_stats();
 
+        /// Returns work-stealing statistics summed over the pool threads.
+
+        /// \return Work-stealing statistics.
+        static WSStats get_ws_stats();
+
+        /// Select the work-stealing (true) or the shared-queue (false) scheduler.
+
+        /// May be called at any time after \c begin() but the switch is
+        /// only clean if the pool is idle (e.g., just after a fence) since
+        /// tasks already in the per-thread deques are only drained while
+        /// work stealing is enabled.
+        /// \param[in] enable True to enable work stealing.
+        static void set_work_stealing(bool enable);
+
+        /// Returns true if the work-stealing scheduler is in use.
+
+        /// \return True if work stealing is enabled.
+        static bool get_work_stealing() {
+            return instance()->work_stealing;
+        }
+
         /// Gracefully wait for a condition to become true, executing any tasks in the queue.
 
         /// Probe should be an object that, when called, returns the status.
@@ -1479,6 +1578,7 @@ namespace madness {
             tbb_scheduler->terminate();
             delete(tbb_scheduler);
 #endif
+            delete [] deques;
         }
     };
 
@@ -41,6 +41,7 @@
 #include <madness/world/worldam.h>
 #include <madness/world/world_task_queue.h>
 #include <madness/world/worldgop.h>
+#include <madness/world/worldtrace.h>
 #include <cstdlib>
 #include <sstream>
 
@@ -220,6 +221,17 @@ namespace madness {
     void finalize() {
         World::default_world->gop.fence();
 
+        // Write the event trace requested by MAD_TRACE_NAME
+        const char* mad_trace_name = getenv("MAD_TRACE_NAME");
+        if (mad_trace_name) {
+            const int rank = SafeMPI::COMM_WORLD.Get_rank();
+            std::stringstream file_name;
+            file_name << mad_trace_name << "_" << rank;
+            Tracer::disable();
+            if (!Tracer::dump(file_name.str().c_str(), rank))
+                std::cerr << "!!MADNESS WARNING: failed to write trace " << file_name.str() << "\n";
+        }
+
         // Destroy the default world
         delete World::default_world;
         World::default_world = nullptr;
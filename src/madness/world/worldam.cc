@@ -32,11 +32,140 @@
 #include <madness/world/worldam.h>
 #include <madness/world/MADworld.h>
 #include <madness/world/worldmpi.h>
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 namespace madness {
 
+    WorldAmInterface::AmBatch* WorldAmInterface::batches = nullptr;
+    std::size_t WorldAmInterface::batch_limit = 0;
+    std::size_t WorldAmInterface::batch_max = 0;
+    double WorldAmInterface::batch_age = 0.0;
+    AtomicInt WorldAmInterface::nbatch;
+
+    void WorldAmInterface::init_batches() {
+        // Only with more than one process is the RMI server running
+        if (batches || SafeMPI::COMM_WORLD.Get_size() == 1) return;
+
+        // Largest message (bytes, including its header) to aggregate ... 0 disables aggregation
+        long limit = 1024;
+        const char* mad_aggregate = getenv("MAD_AM_AGGREGATE");
+        if (mad_aggregate) {
+            std::stringstream ss(mad_aggregate);
+            ss >> limit;
+        }
+        if (limit <= 0) return;
+
+        // Max. time (us) a message may wait before being sent
+        long age = 100;
+        const char* mad_aggregate_age = getenv("MAD_AM_AGGREGATE_AGE");
+        if (mad_aggregate_age) {
+            std::stringstream ss(mad_aggregate_age);
+            ss >> age;
+        }
+
+        batch_max = RMI::max_msg_len() - sizeof(AmArg);
+        batch_limit = std::min(std::size_t(limit), batch_max/4);
+        batch_age = std::max(age, 1l)*1e-6;
+        nbatch = 0;
+
+        // Never freed since messages may be in flight until RMI::end()
+        batches = new AmBatch[SafeMPI::COMM_WORLD.Get_size()];
+        RMI::set_poll_callback(&WorldAmInterface::batch_poll);
+    }
+
+    AmArg* WorldAmInterface::batch_detach(AmBatch& b, ProcessID dest, RMI::Request& req) {
+        AmArg* buf = b.buf;
+        buf->set_size(b.used);
+        req = RMI::isend(buf, b.used+sizeof(AmArg), dest, batch_handler, RMI::ATTR_ORDERED);
+        b.buf = 0;
+        b.used = 0;
+        nbatch--;
+        return buf;
+    }
+
+    void WorldAmInterface::batch_send(ProcessID dest, AmArg* arg) {
+        const std::size_t nbyte = arg->size()+sizeof(AmArg);
+        const std::size_t n = sizeof(AmArg)*((nbyte+sizeof(AmArg)-1)/sizeof(AmArg));
+        AmBatch& b = batches[dest];
+        AmArg* full = 0;
+        RMI::Request req;
+
+        b.lock();
+        if (b.buf && b.used+n > b.cap) {
+            if (b.cap < batch_max) {
+                // Grow geometrically up to the size of the RMI receive buffers
+                b.cap = std::min(std::max(2*b.cap, b.used+n), batch_max);
+                AmArg* buf = alloc_am_arg(b.cap);
+                memcpy(buf->buf(), b.buf->buf(), b.used);
+                free_am_arg(b.buf);
+                b.buf = buf;
+            }
+            if (b.used+n > b.cap) full = batch_detach(b, dest, req);
+        }
+        if (!b.buf) {
+            b.cap = std::max(b.cap, std::max(n, std::size_t(4096)));
+            b.buf = alloc_am_arg(b.cap);
+            b.start = wall_time();
+            nbatch++;
+        }
+        memcpy(b.buf->buf()+b.used, arg, nbyte);
+        b.used += n;
+        b.unlock();
+
+        free_am_arg(arg);
+        if (full) park(full, req);
+    }
+
+    void WorldAmInterface::batch_flush(ProcessID dest) {
+        AmBatch& b = batches[dest];
+        AmArg* full = 0;
+        RMI::Request req;
+
+        b.lock();
+        if (b.buf) full = batch_detach(b, dest, req);
+        b.unlock();
+
+        if (full) park(full, req);
+    }
+
+    void WorldAmInterface::batch_poll() {
+        if (nbatch == 0) return;
+
+        // Rate limited since scanning all processes is not free
+        static double last = 0.0;
+        const double now = wall_time();
+        if (now - last < 0.5*batch_age) return;
+        last = now;
+
+        // The server must not block so batches in use are left for next time
+        const int nproc = SafeMPI::COMM_WORLD.Get_size();
+        for (ProcessID p=0; p<nproc && nbatch; ++p) {
+            AmBatch& b = batches[p];
+            if (b.buf && (now - b.start) > batch_age && b.try_lock()) {
+                if (b.buf) {
+                    RMI::Request req;
+                    AmArg* full = batch_detach(b, p, req);
+                    RMI::send_req.push_back(std::unique_ptr<RMISendReq>(new SendReq(full, req)));
+                }
+                b.unlock();
+            }
+        }
+    }
 
+    void WorldAmInterface::batch_handler(void *buf, std::size_t nbyte) {
+        const AmArg* batch = static_cast<AmArg*>(buf);
+        MADNESS_ASSERT(batch->size() + sizeof(AmArg) == nbyte);
+        unsigned char* p = batch->buf();
+        unsigned char* end = p + batch->size();
+        while (p < end) {
+            AmArg* arg = reinterpret_cast<AmArg*>(p);
+            const std::size_t n = arg->size()+sizeof(AmArg);
+            handler(arg, n);
+            p += sizeof(AmArg)*((n+sizeof(AmArg)-1)/sizeof(AmArg));
+        }
+    }
 
     WorldAmInterface::WorldAmInterface(World& world)
             : nsend(DEFAULT_NSEND)
@@ -75,6 +204,8 @@ namespace madness {
                                                      &fred[0], SafeMPI::COMM_WORLD.Get_group(),
                                                      &map_to_comm_world[0]);
 
+        init_batches();
+
         // for (int i=0; i<nproc; ++i) {
         //     std::cout << "map " << i << " " << map_to_comm_world[i] << std::endl;
         // }
@@ -250,6 +250,84 @@ namespace madness {
 
         std::vector<int> map_to_comm_world; ///< Maps rank in current MPI communicator to SafeMPI::COMM_WORLD
 
+        /// Small ordered AM waiting to be sent to one process as a single RMI message
+
+        /// The buffer is an AmArg header followed by complete copies of the
+        /// aggregated messages, each padded to a multiple of sizeof(AmArg).
+        /// The batches are shared by all worlds and indexed by rank in
+        /// SafeMPI::COMM_WORLD.
+        struct AmBatch : public SPINLOCK_TYPE {
+            AmArg* buf;                     ///< Messages not yet sent (null if none)
+            std::size_t used;               ///< Bytes used after the header
+            std::size_t cap;                ///< Bytes available after the header
+            double start;                   ///< Time the first message was added
+            AmBatch() : buf(0), used(0), cap(0), start(0.0) {}
+        };
+
+        static AmBatch* batches;            ///< Per destination batches (null if not aggregating)
+        static std::size_t batch_limit;     ///< Largest AM (incl. header) that is aggregated
+        static std::size_t batch_max;       ///< Largest batch payload (MAD_BUFFER_SIZE less the header)
+        static double batch_age;            ///< Max. time in seconds a message waits in a batch
+        static AtomicInt nbatch;            ///< No. of non-empty batches
+
+        static void init_batches();
+
+        /// Sends the batch to dest and returns its buffer ... assumes batch lock held
+        static AmArg* batch_detach(AmBatch& b, ProcessID dest, RMI::Request& req);
+
+        /// Adds an AM to the batch for dest, sending the batch if full
+        void batch_send(ProcessID dest, AmArg* arg);
+
+        /// Sends any messages waiting for dest
+        void batch_flush(ProcessID dest);
+
+        /// Called by the RMI server while polling to send batches that are too old
+        static void batch_poll();
+
+        /// Unpacks an incoming batch into individual messages
+        static void batch_handler(void *buf, std::size_t nbyte);
+
+        /// Returns the index of a send buffer that is free and locked by the caller
+        int get_free_send_req() {
+            // Find a free buffer oldest first (in order to assist
+            // with flow control).  Exit loop with a lock on buffer.
+
+            // This design will need nsend >= nthreads
+            int i=-1;
+            while (i == -1) {
+                lock();   // << Protect cur_msg
+                if (send_req[cur_msg].try_lock()) { // << matching unlock by the caller
+                    i = cur_msg;
+                    cur_msg = (cur_msg + 1) % nsend;
+                }
+                unlock(); // << Protect cur_msg
+            }
+
+            // If the buffer is still in-use wait for it to complete
+            while (!send_req[i].TestAndFree()) {
+                // If the oldest message has still not completed then
+                // there is likely severe network or end-point
+                // congestion, so pause for 100us in a rather
+                // arbitrary attempt to decrease the injection rate.
+                // Both the server thread and this call to Test()
+                // should ensure progress.
+                myusleep(100);
+            }
+            return i;
+        }
+
+        /// Retains a sent buffer until its send request completes
+        void park(AmArg* arg, const RMI::Request& req) {
+            if (RMI::get_this_thread_is_server()) {
+                RMI::send_req.push_back(std::unique_ptr<RMISendReq>(new SendReq(arg, req)));
+            }
+            else {
+                const int i = get_free_send_req();
+                send_req[i].set(arg, req);
+                send_req[i].unlock(); // << matches try_lock in get_free_send_req
+            }
+        }
+
         /// This handles all incoming RMI messages for all instances
         static void handler(void *buf, std::size_t nbyte) {
             // It will be singled threaded since only the RMI receiver
@@ -270,8 +348,15 @@ namespace madness {
 
         virtual ~WorldAmInterface();
 
-        /// Currently a noop
-        void fence() {}
+        /// Sends all aggregated messages
+
+        /// Called by WorldGopInterface::fence() so that no message is
+        /// left waiting in a batch while the fence counts messages.
+        void fence() {
+            if (batches && nbatch) {
+                for (int p=0; p<SafeMPI::COMM_WORLD.Get_size(); ++p) batch_flush(p);
+            }
+        }
 
         /// Sends a managed non-blocking active message
         void send(ProcessID dest, am_handlerT op, const AmArg* arg,
@@ -294,6 +379,18 @@ namespace madness {
             // Map dest from world's communicator to comm_world
             dest = map_to_comm_world[dest];
 
+            // Small ordered messages from worker threads are aggregated
+            // per destination and sent together.  Any other ordered
+            // message must first flush the batch to keep the order.
+            if (batches && attr == RMI::ATTR_ORDERED) {
+                if (arg->size()+sizeof(AmArg) <= batch_limit && !RMI::get_this_thread_is_server()) {
+                    lock(); nsent++; unlock();
+                    batch_send(dest, const_cast<AmArg*>(arg));
+                    return;
+                }
+                batch_flush(dest);
+            }
+
             // Remaining code refactored to avoid blocking with lock
             // and to enable finer grained calls into MPI send
 
@@ -319,36 +416,12 @@ namespace madness {
             }
 
 
-            // Find a free buffer oldest first (in order to assist
-            // with flow control).  Exit loop with a lock on buffer.
-
-            // This design will need nsend >= nthreads
-            int i=-1;
-            while (i == -1) {
-                lock();   // << Protect cur_msg and nsent;
-                if (send_req[cur_msg].try_lock()) { // << matching unlock at end of routine
-                    i = cur_msg;
-                    cur_msg = (cur_msg + 1) % nsend;
-                    nsent++;
-                }
-                unlock(); // << Protect cur_msg and nsent;
-            }                
-
-
-            // If the buffer is still in-use wait for it to complete
-            while (!send_req[i].TestAndFree()) {
-                // If the oldest message has still not completed then
-                // there is likely severe network or end-point
-                // congestion, so pause for 100us in a rather
-                // arbitrary attempt to decrease the injection rate.
-                // Both the server thread and this call to Test()
-                // should ensure progress.
-                myusleep(100);
-            }
+            lock(); nsent++; unlock();
+            const int i = get_free_send_req(); // << locks send_req[i]
 
             // Buffer is now free but still locked by me
             send_req[i].set((AmArg*)(arg), RMI::isend(arg, arg->size()+sizeof(AmArg), dest, handler, attr));
-            send_req[i].unlock(); // << matches try_lock above
+            send_req[i].unlock(); // << matches try_lock in get_free_send_req
         }
 
         /// Frees as many send buffers as possible, returning the number that are free
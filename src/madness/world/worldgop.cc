@@ -31,6 +31,7 @@
 
 #include <madness/world/worldgop.h>
 #include <madness/world/MADworld.h>
+#include <madness/world/worldtrace.h>
 #ifdef MADNESS_HAS_GOOGLE_PERF_MINIMAL
 #include <gperftools/malloc_extension.h>
 #endif
@@ -48,6 +49,7 @@ namespace madness {
     /// flight.
     void WorldGopInterface::fence() {
         PROFILE_MEMBER_FUNC(WorldGopInterface);
+        Tracer::record(Tracer::FENCE_BEGIN);
         unsigned long nsent_prev=0, nrecv_prev=1; // invalid initial condition
         SafeMPI::Request req0, req1;
         ProcessID parent, child0, child1;
@@ -70,6 +72,7 @@ namespace madness {
             uint64_t ntask1, nsent1, nrecv1, ntask2, nsent2, nrecv2;
             do {
                 world_.taskq.fence();
+                world_.am.fence(); // send aggregated messages
 
                 // Since the number of outstanding tasks and number of AM sent/recv
                 // don't share a critical section read each twice and ensure they
@@ -134,6 +137,7 @@ namespace madness {
         MallocExtension::instance()->ReleaseFreeMemory();
 //        print("clearing memory");
 #endif
+        Tracer::record(Tracer::FENCE_END, nullptr, npass);
     }
 
 
@@ -38,7 +38,9 @@
 /// If you can recall the Intel hypercubes, their comm lib used GOP as
 /// the abbreviation.
 
+#include <memory>
 #include <type_traits>
+#include <vector>
 #include <madness/world/worldtypes.h>
 #include <madness/world/buffer_archive.h>
 #include <madness/world/world.h>
@@ -145,6 +147,10 @@ namespace madness {
         World& world_; ///< MPI interface
         std::shared_ptr<detail::DeferredCleanup> deferred_; ///< Deferred cleanup object.
         bool debug_; ///< Debug mode
+        std::size_t nasync_; ///< Number of non-blocking reductions started
+
+        /// Inputs of at least this many bytes are reduced around a ring
+        static const std::size_t ring_reduce_bytes = 65536;
 
         friend class detail::DeferredCleanup;
 
@@ -159,6 +165,46 @@ namespace madness {
         struct AllReduceTag { };
         struct GroupAllReduceTag { };
 
+        /// Key of a non-blocking reduction, numbered in the order they are started
+        class AsyncReduceKey {
+            std::size_t n_;
+        public:
+            AsyncReduceKey() : n_(0) { }
+            explicit AsyncReduceKey(std::size_t n) : n_(n) { }
+            bool operator==(const AsyncReduceKey& other) const { return n_ == other.n_; }
+            hashT hash() const { return hash_value(n_); }
+            template <typename Archive>
+            void serialize(const Archive& ar) { ar & n_; }
+        };
+
+        /// Elementwise reduction of vectors in the form expected by all_reduce
+        template <typename T, class opT>
+        class VectorReduceOp {
+            opT op_;
+        public:
+            typedef std::vector<T> result_type;
+            typedef std::vector<T> argument_type;
+
+            VectorReduceOp(const opT& op) : op_(op) { }
+
+            result_type operator()() const { return result_type(); }
+
+            void operator()(result_type& result, const result_type& value) const {
+                if (result.empty()) {
+                    result = value;
+                }
+                else {
+                    MADNESS_ASSERT(result.size() == value.size());
+                    for (std::size_t i=0; i<result.size(); ++i) result[i] = op_(result[i], value[i]);
+                }
+            }
+        };
+
+        template <typename T>
+        static T first_element(const std::vector<T>& v) {
+            return v.front();
+        }
+
 
         /// Delayed send callback object
 
@@ -612,12 +658,120 @@ namespace madness {
             return Future<result_type>::default_initializer();
         }
 
+        /// Allreduce by recursive doubling, for short inputs
+
+        /// With P a power of two each process swaps its whole buffer with
+        /// the process whose rank differs in one bit, for log2(P) steps.
+        /// Otherwise the first 2*(P - P2) processes, where P2 is the largest
+        /// power of two below P, first pair up so that P2 take part and the
+        /// others receive the result at the end.  Partners combine as
+        /// op(lower rank, higher rank) so all processes get identical bits.
+        template <typename T, class opT>
+        void reduce_doubling(T* buf, size_t nelem, opT op) {
+            const ProcessID me = world_.rank(), nproc = world_.size();
+            const Tag tag = world_.mpi.unique_tag();
+            const int nbyte = nelem*sizeof(T);
+            std::unique_ptr<T[]> tmp(new T[nelem]);
+            SafeMPI::Request req0, req1;
+
+            ProcessID p2 = 1;
+            while (2*p2 <= nproc) p2 *= 2;
+            const ProcessID rem = nproc - p2;
+
+            // Fold the extra processes into their odd neighbours
+            ProcessID newme = -1;
+            if (me < 2*rem) {
+                if (me%2 == 0) {
+                    req0 = world_.mpi.Isend(buf, nbyte, MPI_BYTE, me+1, tag);
+                    World::await(req0);
+                }
+                else {
+                    req0 = world_.mpi.Irecv(tmp.get(), nbyte, MPI_BYTE, me-1, tag);
+                    World::await(req0);
+                    for (size_t i=0; i<nelem; ++i) buf[i] = op(tmp[i], buf[i]);
+                    newme = me/2;
+                }
+            }
+            else {
+                newme = me - rem;
+            }
+
+            if (newme != -1) {
+                for (ProcessID mask=1; mask<p2; mask*=2) {
+                    const ProcessID newpartner = newme ^ mask;
+                    const ProcessID partner = (newpartner < rem) ? 2*newpartner + 1 : newpartner + rem;
+                    req0 = world_.mpi.Irecv(tmp.get(), nbyte, MPI_BYTE, partner, tag);
+                    req1 = world_.mpi.Isend(buf, nbyte, MPI_BYTE, partner, tag);
+                    World::await(req0);
+                    World::await(req1);
+                    if (partner < me)
+                        for (size_t i=0; i<nelem; ++i) buf[i] = op(tmp[i], buf[i]);
+                    else
+                        for (size_t i=0; i<nelem; ++i) buf[i] = op(buf[i], tmp[i]);
+                }
+            }
+
+            // Hand the result back to the folded processes
+            if (me < 2*rem) {
+                if (me%2 == 0)
+                    req0 = world_.mpi.Irecv(buf, nbyte, MPI_BYTE, me+1, tag);
+                else
+                    req0 = world_.mpi.Isend(buf, nbyte, MPI_BYTE, me-1, tag);
+                World::await(req0);
+            }
+        }
+
+        /// Allreduce by a ring reduce-scatter and a ring allgather, for long inputs
+
+        /// The buffer is cut into P chunks.  In each of P-1 steps every
+        /// process passes one chunk to its right neighbour while combining
+        /// the chunk arriving from its left, so that each chunk ends up fully
+        /// reduced on one process; P-1 more steps pass the reduced chunks
+        /// around.  Each process moves 2(P-1)/P of the buffer in total,
+        /// independent of P, against log2(P) whole buffers for the tree.
+        /// Each chunk is reduced on a single process, so the result is
+        /// bitwise identical everywhere.
+        template <typename T, class opT>
+        void reduce_ring(T* buf, size_t nelem, opT op) {
+            const ProcessID me = world_.rank(), nproc = world_.size();
+            const ProcessID left = (me + nproc - 1) % nproc, right = (me + 1) % nproc;
+            const Tag tag = world_.mpi.unique_tag();
+            std::unique_ptr<T[]> tmp(new T[nelem/nproc + 1]);
+            SafeMPI::Request req0, req1;
+
+            // Chunk c is [lo(c), lo(c+1))
+            auto lo = [nelem, nproc](ProcessID c) { return (nelem*c)/nproc; };
+            auto nbyte = [&lo](ProcessID c) { return int((lo(c+1) - lo(c))*sizeof(T)); };
+
+            // Reduce-scatter: afterwards this process owns chunk (me+1)%nproc
+            for (ProcessID step=0; step<nproc-1; ++step) {
+                const ProcessID csend = (me - step + nproc) % nproc;
+                const ProcessID crecv = (me - step - 1 + 2*nproc) % nproc;
+                req0 = world_.mpi.Irecv(tmp.get(), nbyte(crecv), MPI_BYTE, left, tag);
+                req1 = world_.mpi.Isend(buf + lo(csend), nbyte(csend), MPI_BYTE, right, tag);
+                World::await(req0);
+                World::await(req1);
+                T* p = buf + lo(crecv);
+                for (size_t i=0; i<lo(crecv+1)-lo(crecv); ++i) p[i] = op(p[i], tmp[i]);
+            }
+
+            // Allgather of the reduced chunks
+            for (ProcessID step=0; step<nproc-1; ++step) {
+                const ProcessID csend = (me + 1 - step + nproc) % nproc;
+                const ProcessID crecv = (me - step + nproc) % nproc;
+                req0 = world_.mpi.Irecv(buf + lo(crecv), nbyte(crecv), MPI_BYTE, left, tag);
+                req1 = world_.mpi.Isend(buf + lo(csend), nbyte(csend), MPI_BYTE, right, tag);
+                World::await(req0);
+                World::await(req1);
+            }
+        }
+
 
     public:
 
         // In the World constructor can ONLY rely on MPI and MPI being initialized
         WorldGopInterface(World& world) :
-            world_(world), deferred_(new detail::DeferredCleanup()), debug_(false)
+            world_(world), deferred_(new detail::DeferredCleanup()), debug_(false), nasync_(0)
         { }
 
         ~WorldGopInterface() {
@@ -708,38 +862,43 @@ namespace madness {
 
         /// Inplace global reduction (like MPI all_reduce) while still processing AM & tasks
 
-        /// Optimizations can be added for long messages and to reduce the memory footprint
+        /// Inputs shorter than 64 KB (or than one element per process) are
+        /// reduced by recursive doubling, which takes log2(P) steps; longer
+        /// ones by a ring reduce-scatter and allgather, which moves about
+        /// twice the buffer per process whatever P is.  All processes end up
+        /// with bitwise identical results.
         template <typename T, class opT>
         void reduce(T* buf, size_t nelem, opT op) {
-            SafeMPI::Request req0, req1;
-            ProcessID parent, child0, child1;
-            world_.mpi.binary_tree_info(0, parent, child0, child1);
-            Tag gsum_tag = world_.mpi.unique_tag();
-
-            T* buf0 = new T[nelem];
-            T* buf1 = new T[nelem];
-
-            if (child0 != -1) req0 = world_.mpi.Irecv(buf0, nelem*sizeof(T), MPI_BYTE, child0, gsum_tag);
-            if (child1 != -1) req1 = world_.mpi.Irecv(buf1, nelem*sizeof(T), MPI_BYTE, child1, gsum_tag);
+            if (world_.size() == 1 || nelem == 0) return;
+            if (nelem*sizeof(T) < ring_reduce_bytes || nelem < size_t(world_.size()))
+                reduce_doubling(buf, nelem, op);
+            else
+                reduce_ring(buf, nelem, op);
+        }
 
-            if (child0 != -1) {
-                World::await(req0);
-                for (long i=0; i<(long)nelem; ++i) buf[i] = op(buf[i],buf0[i]);
-            }
-            if (child1 != -1) {
-                World::await(req1);
-                for (long i=0; i<(long)nelem; ++i) buf[i] = op(buf[i],buf1[i]);
-            }
+        /// Non-blocking elementwise global reduction of a vector
 
-            delete [] buf0;
-            delete [] buf1;
+        /// Returns at once with a future that is assigned the reduced vector
+        /// on every process, so the reduction overlaps with other tasks.  The
+        /// data moves as active messages up and down a binary tree.  Every
+        /// process must start its non-blocking reductions in the same order,
+        /// from the main thread, with vectors of the same length.
+        template <typename T, class opT>
+        Future< std::vector<T> > reduce_async(const std::vector<T>& v, opT op) {
+            return all_reduce(AsyncReduceKey(nasync_++), v, VectorReduceOp<T,opT>(op));
+        }
 
-            if (parent != -1) {
-                req0 = world_.mpi.Isend(buf, nelem*sizeof(T), MPI_BYTE, parent, gsum_tag);
-                World::await(req0);
-            }
+        /// Non-blocking elementwise global sum of a vector, see reduce_async
+        template <typename T>
+        Future< std::vector<T> > sum_async(const std::vector<T>& v) {
+            return reduce_async(v, WorldSumOp<T>());
+        }
 
-            broadcast(buf, nelem, 0);
+        /// Non-blocking global sum of a single value, see reduce_async
+        template <typename T>
+        Future<T> sum_async(const T& a) {
+            return world_.taskq.add(&WorldGopInterface::template first_element<T>,
+                                    sum_async(std::vector<T>(1, a)), TaskAttributes::hipri());
         }
 
         /// Inplace global sum while still processing AM & tasks
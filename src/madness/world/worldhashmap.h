@@ -46,6 +46,8 @@
 #include <madness/world/worldmutex.h>
 #include <madness/world/madness_exception.h>
 #include <madness/world/worldhash.h>
+#include <algorithm>
+#include <atomic>
 #include <new>
 #include <stdio.h>
 #include <map>
@@ -59,9 +61,14 @@ namespace madness {
 
     namespace Hash_private {
 
-        // A hashtable is an array of nbin bins.
-        // Each bin is a linked list of entries protected by a spinlock.
-        // Each entry holds a key+value pair, a read-write mutex, and a link to the next entry.
+        // A hashtable is a list of tables of bins, each new table being
+        // several times larger than the last, and inserts go into the
+        // newest.  Each bin is a linked list of entries whose links are
+        // changed only under the bin's spinlock but may be followed
+        // without it.  Each entry holds a key+value pair, a read-write
+        // mutex, and a link to the next entry.  Entries never move, and
+        // an erased entry is freed only once no reader can be walking
+        // over it.
 
         template <typename keyT, typename valueT>
         class entry : public madness::MutexReaderWriter {
@@ -69,10 +76,12 @@ namespace madness {
             typedef std::pair<const keyT, valueT> datumT;
             datumT datum;
 
-            class entry<keyT,valueT> * volatile next;
+            std::atomic<entry<keyT,valueT>*> next;
+            std::atomic<bool> dead;             // Set when the entry is erased
+            entry<keyT,valueT>* retired;        // Next erased entry waiting to be freed
 
             entry(const datumT& datum, entry<keyT,valueT>* next)
-                    : datum(datum), next(next) {}
+                    : datum(datum), next(next), dead(false), retired(0) {}
         };
 
         template <class keyT, class valueT>
@@ -84,104 +93,147 @@ namespace madness {
             // perhaps better to just use more bins
         public:
 
-            entryT* volatile p;
-            int volatile ninbin;
+            std::atomic<entryT*> p;
+            std::atomic<int> ninbin;
+            entryT* retired;    // Erased entries not yet freed, guarded by the spinlock
 
-            bin() : p(0),ninbin(0) {}
+            bin() : p(0), ninbin(0), retired(0) {}
 
             ~bin() {
                 clear();
             }
 
+            using madness::Spinlock::lock;
+            using madness::Spinlock::unlock;
+
+            /// Frees all entries ... must not run concurrently with other accesses
             void clear() {
                 lock();             // BEGIN CRITICAL SECTION
-                while (p) {
-                    entryT* n=p->next;
-                    delete p;
-                    p=n;
-                    ninbin--;
+                entryT* t = p;
+                while (t) {
+                    entryT* n = t->next;
+                    delete t;
+                    t = n;
                 }
-                MADNESS_ASSERT(ninbin == 0);
+                p = 0;
+                ninbin = 0;
+                free_retired();
                 unlock();           // END CRITICAL SECTION
             }
 
+            /// Returns the entry with the key or zero, without taking the spinlock
+
+            /// The caller must either hold the spinlock or be counted as a
+            /// reader of the bin so that no entry it walks over is freed.
+            entryT* match(const keyT& key) const {
+                for (entryT* t=p; t; t=t->next)
+                    if (t->datum.first == key) return t;
+                return 0;
+            }
+
+            /// Returns the entry with the key locked in lockmode or zero, without taking the spinlock
+
+            /// The caller must be counted as a reader of the bin.
             entryT* find(const keyT& key, const int lockmode) const {
-                bool gotlock;
-                entryT* result;
                 madness::MutexWaiter waiter;
-                do {
-                    lock();             // BEGIN CRITICAL SECTION
-                    result = match(key);
-                    if (result) {
-                        gotlock = result->try_lock(lockmode);
+                while (true) {
+                    entryT* result = match(key);
+                    if (!result) return 0;
+                    if (result->try_lock(lockmode)) {
+                        if (!result->dead) return result;
+                        result->unlock(lockmode); // Erased meanwhile ... look again
                     }
                     else {
-                        gotlock = true;
+                        waiter.wait();
                     }
-                    unlock();           // END CRITICAL SECTION
-                    if (!gotlock) waiter.wait(); //cpu_relax();
                 }
-                while (!gotlock);
-
-                return result;
             }
 
-            std::pair<entryT*,bool> insert(const datumT& datum, int lockmode) {
-                bool gotlock;
-                entryT* result;
-                bool notfound;
-                madness::MutexWaiter waiter;
-                do {
-                    lock();             // BEGIN CRITICAL SECTION
-                    result = match(datum.first);
-                    notfound = !result;
-                    if (notfound) {
-                        result = p = new entryT(datum,p);
-                        ++ninbin;
-                    }
-                    gotlock = result->try_lock(lockmode);
-                    unlock();           // END CRITICAL SECTION
-                    if (!gotlock) waiter.wait(); //cpu_relax();
-                }
-                while (!gotlock);
-
-                return std::pair<entryT*,bool>(result,notfound);
+            /// Links a new entry at the head ... the caller holds the spinlock
+            void link(entryT* t) {
+                t->next = p.load();
+                p = t;
+                ++ninbin;
             }
 
-            bool del(const keyT& key, int lockmode) {
-                bool status = false;
-                lock();             // BEGIN CRITICAL SECTION
-                for (entryT *t=p,*prev=0; t; prev=t,t=t->next) {
+            /// Unlinks the entry with the key and queues it to be freed ... the caller holds the spinlock
+
+            /// The entry is unlocked from lockmode. Returns true if an entry was found.
+            bool unlink(const keyT& key, int lockmode) {
+                entryT* prev = 0;
+                for (entryT* t=p; t; prev=t, t=t->next) {
                     if (t->datum.first == key) {
+                        t->dead = true;
                         if (prev) {
-                            prev->next = t->next;
+                            prev->next = t->next.load();
                         }
                         else {
-                            p = t->next;
+                            p = t->next.load();
                         }
-                        t->unlock(lockmode);
-                        delete t;
                         --ninbin;
-                        status = true;
-                        break;
+                        t->unlock(lockmode);
+                        t->retired = retired;
+                        retired = t;
+                        return true;
                     }
                 }
-                unlock();           // END CRITICAL SECTION
-                return status;
+                return false;
+            }
+
+            /// Frees erased entries ... the caller holds the spinlock and knows there are no readers
+            void free_retired() {
+                while (retired) {
+                    entryT* n = retired->retired;
+                    delete retired;
+                    retired = n;
+                }
             }
 
             std::size_t size() const {
                 return ninbin;
             };
+        };
 
-        private:
-            entryT* match(const keyT& key) const {
-                entryT* t;
-                for (t=p; t; t=t->next)
-                    if (t->datum.first == key) break;
-                return t;
+        /// One table of bins with counts of the readers and entries of each stripe of bins
+        template <class keyT, class valueT>
+        class table : private NO_DEFAULTS {
+        public:
+            typedef bin<keyT,valueT> binT;
+            static const int NSTRIPE = 64;
+
+            struct stripe {
+                std::atomic<long> nreader; // Threads walking a bin of the stripe
+                std::atomic<long> nentry;  // Entries in the bins of the stripe
+                char pad[64 - 2*sizeof(std::atomic<long>)];
+                stripe() : nreader(0), nentry(0) {}
+            };
+
+            /// Counts the calling thread as a reader of a stripe while in scope
+            class reader {
+                std::atomic<long>& n;
+            public:
+                reader(stripe& s) : n(s.nreader) { ++n; }
+                ~reader() { --n; }
+            };
+
+            const std::size_t nbins;
+            binT* const bins;
+            stripe stripes[NSTRIPE];
+
+            table(std::size_t nbins) : nbins(nbins), bins(new binT[nbins]) {}
+
+            ~table() {
+                delete [] bins;
+            }
+
+            stripe& stripe_of(std::size_t b) {
+                return stripes[b%NSTRIPE];
             }
 
+            void clear() {
+                for (std::size_t i=0; i<nbins; ++i) bins[i].clear();
+                for (int i=0; i<NSTRIPE; ++i) stripes[i].nentry = 0;
+            }
         };
 
         /// iterator for hash
@@ -201,21 +253,31 @@ namespace madness {
 
         private:
             hashT* h;               // Associated hash table
-            int bin;                // Current bin
+            int level;              // Current table
+            long bin;               // Current bin in the table
             entryT* entry;          // Current entry in bin ... zero means at end
 
             template <class otherHashT>
             friend class HashIterator;
 
+            /// Moves to the next bin, and table if needed, returning false at the end
+            bool next_bin() {
+                if (++bin == long(h->tables[level]->nbins)) {
+                    if (level+1 >= h->nlevel) return false;
+                    ++level;
+                    bin = 0;
+                }
+                return true;
+            }
+
             /// If the entry is null (end of current bin) finds next non-empty bin
             void next_non_null_entry() {
                 while (!entry) {
-                    ++bin;
-                    if ((unsigned) bin == h->nbins) {
+                    if (!next_bin()) {
                         entry = 0;
                         return;
                     }
-                    entry = h->bins[bin].p;
+                    entry = h->tables[level]->bins[bin].p;
                 }
                 return;
             }
@@ -223,21 +285,21 @@ namespace madness {
         public:
 
             /// Makes invalid iterator
-            HashIterator() : h(0), bin(-1), entry(0) {}
+            HashIterator() : h(0), level(0), bin(-1), entry(0) {}
 
             /// Makes begin/end iterator
             HashIterator(hashT* h, bool begin)
-                    : h(h), bin(-1), entry(0) {
+                    : h(h), level(0), bin(-1), entry(0) {
                 if (begin) next_non_null_entry();
             }
 
             /// Makes iterator to specific entry
-            HashIterator(hashT* h, int bin, entryT* entry)
-                    : h(h), bin(bin), entry(entry) {}
+            HashIterator(hashT* h, int level, long bin, entryT* entry)
+                    : h(h), level(level), bin(bin), entry(entry) {}
 
             /// Copy constructor
             HashIterator(const HashIterator& other)
-                    : h(other.h), bin(other.bin), entry(other.entry) {}
+                    : h(other.h), level(other.level), bin(other.bin), entry(other.entry) {}
 
             /// Implicit conversion of another hash type to this hash type
 
@@ -245,7 +307,7 @@ namespace madness {
             /// types.
             template <class otherHashT>
             HashIterator(const HashIterator<otherHashT>& other)
-                    : h(other.h), bin(other.bin), entry(other.entry) {}
+                    : h(other.h), level(other.level), bin(other.bin), entry(other.entry) {}
 
             HashIterator& operator++() {
                 if (!entry) return *this;
@@ -286,16 +348,15 @@ namespace madness {
                 // If here, will point to first entry in
                 // a bin ... determine which bin contains
                 // our end point.
-                while (unsigned(n) >= h->bins[bin].size()) {
-                    n -= h->bins[bin].size();
-                    ++bin;
-                    if (unsigned(bin) == h->nbins) {
+                while (unsigned(n) >= h->tables[level]->bins[bin].size()) {
+                    n -= h->tables[level]->bins[bin].size();
+                    if (!next_bin()) {
                         entry = 0;
                         return; // end
                     }
                 }
 
-                entry = h->bins[bin].p;
+                entry = h->tables[level]->bins[bin].p;
                 MADNESS_ASSERT(entry);
 
                 // Linear increment to target
@@ -392,6 +453,15 @@ namespace madness {
 
     } // End of namespace Hash_private
 
+    /// A concurrent hash map that grows as entries are added
+
+    /// Entries are never moved once inserted.  When the newest table of
+    /// bins averages more than \c MAXLOAD entries per bin a table \c GROWTH
+    /// times larger is added, and further inserts go there, so the chains
+    /// stay short without stopping other threads to rehash.  Lookups search
+    /// the tables from the newest (and largest) back, following the bin
+    /// chains without taking the bin spinlock; clear() folds the tables
+    /// back into one.
     template < class keyT, class valueT, class hashfunT = Hash<keyT> >
     class ConcurrentHashMap {
     public:
@@ -399,6 +469,7 @@ namespace madness {
         typedef std::pair<const keyT,valueT> datumT;
         typedef Hash_private::entry<keyT,valueT> entryT;
         typedef Hash_private::bin<keyT,valueT> binT;
+        typedef Hash_private::table<keyT,valueT> tableT;
         typedef Hash_private::HashIterator<hashT> iterator;
         typedef Hash_private::HashIterator<const hashT> const_iterator;
         typedef Hash_private::HashAccessor<hashT,entryT::WRITELOCK> accessor;
@@ -408,23 +479,27 @@ namespace madness {
         friend class Hash_private::HashIterator<const hashT>;
 
     protected:
-        const size_t nbins;         // Number of bins
-        binT* bins;                 // Array of bins
+        static const int MAXLEVEL = 16;     // Most tables of bins
+        static const std::size_t MAXLOAD = 4; // Mean entries per bin that triggers growth
+        static const std::size_t GROWTH = 4;  // Ratio of the sizes of successive tables
+
+        tableT* tables[MAXLEVEL];   // Tables of bins, oldest first
+        std::atomic<int> nlevel;    // Number of tables
 
     private:
         hashfunT hashfun;
+        Spinlock growlock;          // Held while adding a table
 
-        //unsigned int hash(const keyT& key) const {return hashfunT::hash(key)%nbins;}
-
-        static int nbins_prime(int n) {
-            static const int primes[] = {11, 23, 31, 41, 53, 61, 71, 83, 101,
+        static std::size_t nbins_prime(std::size_t n) {
+            static const std::size_t primes[] = {11, 23, 31, 41, 53, 61, 71, 83, 101,
                 131, 181, 239, 293, 359, 421, 557, 673, 821, 953, 1021, 1231,
                 1531, 1747, 2069, 2543, 3011, 4003, 5011, 6073, 7013, 8053,
                 9029, 9907, 17401, 27479, 37847, 48623, 59377, 70667, 81839,
                 93199, 104759, 224759, 350411, 479951, 611969, 746791, 882391,
                 1299743, 2750171, 4256257, 5800159, 7368811, 8960477, 10570871,
-                12195269, 13834133};
-            static const int nprimes = sizeof(primes)/sizeof(int);
+                12195269, 13834133, 27668293, 55336537, 110673083, 221346149,
+                442692373, 885384523, 1770769031};
+            static const int nprimes = sizeof(primes)/sizeof(std::size_t);
             // n is a user provided estimate of the no. of elements to be put
             // in the table.  Want to make the number of bins a prime number
             // larger than this.
@@ -432,25 +507,128 @@ namespace madness {
             return primes[nprimes-1];
         }
 
-        unsigned int hash_to_bin(const keyT& key) const {
-            return hashfun(key)%nbins;
+        /// Adds a table larger than t unless t is no longer the newest or another thread is adding one
+        void grow(const tableT* t) {
+            if (!growlock.try_lock()) return;
+            const int n = nlevel;
+            if (tables[n-1] == t && n < MAXLEVEL) {
+                tables[n] = new tableT(nbins_prime(GROWTH*t->nbins));
+                nlevel = n+1;
+            }
+            growlock.unlock();
+        }
+
+        /// Finds the entry with the key locked in lockmode without taking bin locks
+        entryT* find_entry(std::size_t hv, const keyT& key, int lockmode, int& level, long& b) const {
+            for (level=nlevel-1; level>=0; --level) {
+                tableT* t = tables[level];
+                b = hv%t->nbins;
+                typename tableT::reader guard(t->stripe_of(b));
+                entryT* entry = t->bins[b].find(key,lockmode);
+                if (entry) return entry;
+            }
+            return 0;
+        }
+
+        /// Finds or inserts the datum, returning its entry locked in lockmode
+
+        /// Sets inserted to true if the datum was inserted.  The newest bin
+        /// stays locked while the older ones are searched so that two threads
+        /// cannot both insert the same key.
+        entryT* insert_entry(const datumT& datum, int lockmode, bool& inserted, int& level, long& b) {
+            const std::size_t hv = hashfun(datum.first);
+            entryT* spare = 0;
+            madness::MutexWaiter waiter;
+            while (true) {
+                entryT* entry = find_entry(hv, datum.first, lockmode, level, b);
+                if (entry) {
+                    delete spare;
+                    inserted = false;
+                    return entry;
+                }
+
+                if (!spare) spare = new entryT(datum,0);
+                const int n = nlevel;
+                tableT* t = tables[n-1];
+                binT& newest = t->bins[hv%t->nbins];
+                newest.lock();      // BEGIN CRITICAL SECTION
+                if (nlevel != n) {  // A table was added meanwhile
+                    newest.unlock();
+                    continue;
+                }
+                bool gotlock = true;
+                for (int l=n-1; l>=0 && !entry; --l) {
+                    binT& older = tables[l]->bins[hv%tables[l]->nbins];
+                    if (l != n-1) older.lock();
+                    entry = older.match(datum.first);
+                    if (entry) {
+                        gotlock = entry->try_lock(lockmode);
+                        level = l;
+                        b = hv%tables[l]->nbins;
+                    }
+                    if (l != n-1) older.unlock();
+                }
+                if (!entry) {
+                    spare->try_lock(lockmode); // Cannot fail as no other thread can see it yet
+                    newest.link(spare);
+                    entry = spare;
+                    level = n-1;
+                    b = hv%t->nbins;
+                }
+                newest.unlock();    // END CRITICAL SECTION
+
+                if (entry == spare) {
+                    if (++t->stripe_of(b).nentry*std::min<std::size_t>(tableT::NSTRIPE, t->nbins) > MAXLOAD*t->nbins)
+                        grow(t);
+                    inserted = true;
+                    return entry;
+                }
+                if (gotlock) {
+                    delete spare;
+                    inserted = false;
+                    return entry;
+                }
+                waiter.wait();
+            }
+        }
+
+        /// Erases the entry with the key, which the caller holds in lockmode
+        bool erase_entry(const keyT& key, int lockmode) {
+            const std::size_t hv = hashfun(key);
+            for (int level=nlevel-1; level>=0; --level) {
+                tableT* t = tables[level];
+                const std::size_t b = hv%t->nbins;
+                binT& bin = t->bins[b];
+                bin.lock();         // BEGIN CRITICAL SECTION
+                const bool found = bin.unlink(key,lockmode);
+                if (found) {
+                    --t->stripe_of(b).nentry;
+                    // Readers count themselves before reading a link so none
+                    // that starts now can reach the entries unlinked above
+                    if (t->stripe_of(b).nreader == 0) bin.free_retired();
+                }
+                bin.unlock();       // END CRITICAL SECTION
+                if (found) return true;
+            }
+            return false;
         }
 
     public:
         ConcurrentHashMap(int n=1021, const hashfunT& hf = hashfunT())
-                : nbins(hashT::nbins_prime(n))
-                , bins(new binT[nbins])
-                , hashfun(hf) {}
+                : nlevel(1)
+                , hashfun(hf) {
+            tables[0] = new tableT(nbins_prime(n));
+        }
 
         ConcurrentHashMap(const  hashT& h)
-                : nbins(h.nbins)
-                , bins(new binT[nbins])
+                : nlevel(1)
                 , hashfun(h.hashfun) {
+            tables[0] = new tableT(nbins_prime(std::max(h.size(), h.tables[0]->nbins)));
             *this = h;
         }
 
         virtual ~ConcurrentHashMap() {
-            delete [] bins;
+            for (int i=0; i<nlevel; ++i) delete tables[i];
         }
 
         hashT& operator=(const  hashT& h) {
@@ -465,27 +643,31 @@ namespace madness {
         }
 
         std::pair<iterator,bool> insert(const datumT& datum) {
-            int bin = hash_to_bin(datum.first);
-            std::pair<entryT*,bool> result = bins[bin].insert(datum,entryT::NOLOCK);
-            return std::pair<iterator,bool>(iterator(this,bin,result.first),result.second);
+            bool inserted;
+            int level;
+            long b;
+            entryT* entry = insert_entry(datum, entryT::NOLOCK, inserted, level, b);
+            return std::pair<iterator,bool>(iterator(this,level,b,entry),inserted);
         }
 
         /// Returns true if new pair was inserted; false if key is already in the map and the datum was not inserted
         bool insert(accessor& result, const datumT& datum) {
             result.release();
-            int bin = hash_to_bin(datum.first);
-            std::pair<entryT*,bool> r = bins[bin].insert(datum,entryT::WRITELOCK);
-            result.set(r.first);
-            return r.second;
+            bool inserted;
+            int level;
+            long b;
+            result.set(insert_entry(datum, entryT::WRITELOCK, inserted, level, b));
+            return inserted;
         }
 
         /// Returns true if new pair was inserted; false if key is already in the map and the datum was not inserted
         bool insert(const_accessor& result, const datumT& datum) {
             result.release();
-            int bin = hash_to_bin(datum.first);
-            std::pair<entryT*,bool> r = bins[bin].insert(datum,entryT::READLOCK);
-            result.set(r.first);
-            return r.second;
+            bool inserted;
+            int level;
+            long b;
+            result.set(insert_entry(datum, entryT::READLOCK, inserted, level, b));
+            return inserted;
         }
 
         /// Returns true if new pair was inserted; false if key is already in the map
@@ -499,7 +681,7 @@ namespace madness {
         }
 
         std::size_t erase(const keyT& key) {
-            if (bins[hash_to_bin(key)].del(key,entryT::NOLOCK)) return 1;
+            if (erase_entry(key,entryT::NOLOCK)) return 1;
             else return 0;
         }
 
@@ -509,34 +691,37 @@ namespace madness {
         }
 
         void erase(accessor& item) {
-            bins[hash_to_bin(item->first)].del(item->first,entryT::WRITELOCK);
+            erase_entry(item->first,entryT::WRITELOCK);
             item.unset();
         }
 
         void erase(const_accessor& item) {
             item.convert_read_lock_to_write_lock();
-            bins[hash_to_bin(item->first)].del(item->first,entryT::WRITELOCK);
+            erase_entry(item->first,entryT::WRITELOCK);
             item.unset();
         }
 
         iterator find(const keyT& key) {
-            int bin = hash_to_bin(key);
-            entryT* entry = bins[bin].find(key,entryT::NOLOCK);
+            int level;
+            long b;
+            entryT* entry = find_entry(hashfun(key), key, entryT::NOLOCK, level, b);
             if (!entry) return end();
-            else return iterator(this,bin,entry);
+            else return iterator(this,level,b,entry);
         }
 
         const_iterator find(const keyT& key) const {
-            int bin = hash_to_bin(key);
-            const entryT* entry = bins[bin].find(key,entryT::NOLOCK);
+            int level;
+            long b;
+            const entryT* entry = find_entry(hashfun(key), key, entryT::NOLOCK, level, b);
             if (!entry) return end();
-            else return const_iterator(this,bin,entry);
+            else return const_iterator(this,level,b,entry);
         }
 
         bool find(accessor& result, const keyT& key) {
             result.release();
-            int bin = hash_to_bin(key);
-            entryT* entry = bins[bin].find(key,entryT::WRITELOCK);
+            int level;
+            long b;
+            entryT* entry = find_entry(hashfun(key), key, entryT::WRITELOCK, level, b);
             bool foundit = entry;
             if (foundit) result.set(entry);
             return foundit;
@@ -544,20 +729,41 @@ namespace madness {
 
         bool find(const_accessor& result, const keyT& key) const {
             result.release();
-            int bin = hash_to_bin(key);
-            entryT* entry = bins[bin].find(key,entryT::READLOCK);
+            int level;
+            long b;
+            entryT* entry = find_entry(hashfun(key), key, entryT::READLOCK, level, b);
             bool foundit = entry;
             if (foundit) result.set(entry);
             return foundit;
         }
 
+        /// Removes all entries and folds the tables into one the size of the newest
+
+        /// Not safe against concurrent access.
         void clear() {
-            for (unsigned int i=0; i<nbins; ++i) bins[i].clear();
+            const int n = nlevel;
+            if (n > 1) {
+                const std::size_t nb = tables[n-1]->nbins;
+                for (int i=0; i<n; ++i) delete tables[i];
+                tables[0] = new tableT(nb);
+                nlevel = 1;
+            }
+            else {
+                tables[0]->clear();
+            }
         }
 
         size_t size() const {
             size_t sum = 0;
-            for (size_t i=0; i<nbins; ++i) sum += bins[i].size();
+            for (int l=0; l<nlevel; ++l)
+                for (size_t i=0; i<tables[l]->nbins; ++i) sum += tables[l]->bins[i].size();
+            return sum;
+        }
+
+        /// Total number of bins in all tables
+        size_t nbins() const {
+            size_t sum = 0;
+            for (int l=0; l<nlevel; ++l) sum += tables[l]->nbins;
             return sum;
         }
 
@@ -593,11 +799,14 @@ namespace madness {
         hashfunT& get_hash() const { return hashfun; }
 
         void print_stats() const {
-            for (unsigned int i=0; i<nbins; ++i) {
-                if (i && (i%10)==0) printf("\n");
-                printf("%8d", int(bins[i].size()));
+            for (int l=0; l<nlevel; ++l) {
+                printf("table %d with %lu bins\n", l, (unsigned long) tables[l]->nbins);
+                for (unsigned int i=0; i<tables[l]->nbins; ++i) {
+                    if (i && (i%10)==0) printf("\n");
+                    printf("%8d", int(tables[l]->bins[i].size()));
+                }
+                printf("\n");
             }
-            printf("\n");
         }
     };
 }
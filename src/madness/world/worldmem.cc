@@ -33,6 +33,7 @@
 */
 
 #include <madness/world/worldmem.h>
+#include <madness/world/worldslab.h>
 #include <cstdlib>
 //#include <cstdio>
 #include <climits>
@@ -59,7 +60,7 @@
  */
 
 
-static madness::WorldMemInfo stats = {0, 0, 0, 0, 0, 0, ULONG_MAX, false};
+static madness::WorldMemInfo stats = {0, 0, 0, 0, 0, 0, ULONG_MAX, false, 0, 0, 0, 0};
 
 namespace madness {
     WorldMemInfo* world_mem_info() {
@@ -86,6 +87,14 @@ namespace madness {
             std::cout << "WorldMemInfo: deleting " << p << " " << size << "\n";
     }
 
+    void WorldMemInfo::update_slab_stats() {
+        const SlabStats slab = SlabAllocator::get_stats();
+        slab_num_alloc = slab.nalloc;
+        slab_num_hit = slab.nhit;
+        slab_cur_bytes = slab.bytes_in_use;
+        slab_cached_bytes = slab.bytes_cached;
+    }
+
     void WorldMemInfo::print() const {
         std::cout.flush();
         std::cout << "\n    MADNESS memory statistics\n";
@@ -98,6 +107,11 @@ namespace madness {
             << cur_num_frags << " " << std::setw(12) << max_num_frags << "\n";
         std::cout << "  cur and max bytes allocated " << std::setw(12)
             << cur_num_bytes << " " << std::setw(12) << max_num_bytes << "\n";
+        const SlabStats slab = SlabAllocator::get_stats();
+        std::cout << "    slab allocations and hits " << std::setw(12)
+            << slab.nalloc << " " << std::setw(12) << slab.nhit << "\n";
+        std::cout << " slab bytes in use and cached " << std::setw(12)
+            << slab.bytes_in_use << " " << std::setw(12) << slab.bytes_cached << "\n";
     }
 
     void WorldMemInfo::reset() {
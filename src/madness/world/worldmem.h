@@ -89,6 +89,13 @@ namespace madness {
         unsigned long max_num_bytes;   ///< Lifetime maximum number of allocated bytes
         unsigned long max_mem_limit;   ///< if size+cur_num_bytes>max_mem_limit new will throw MadnessException
         bool trace;
+        unsigned long slab_num_alloc;  ///< Blocks allocated from the tensor size classes (see SlabAllocator)
+        unsigned long slab_num_hit;    ///< ... of which were satisfied from a free list
+        long slab_cur_bytes;           ///< Bytes currently in use from the size classes
+        unsigned long slab_cached_bytes; ///< Bytes held in the size-class free lists
+
+        /// Refreshes the slab_* statistics from the size-class allocator
+        void update_slab_stats();
 
         /// Prints memory use statistics to std::cout
         void print() const;
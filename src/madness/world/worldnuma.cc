@@ -0,0 +1,159 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#include <madness/world/worldnuma.h>
+#include <madness/world/madness_exception.h>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#ifdef HAVE_HWLOC
+#include <hwloc.h>
+#if HWLOC_API_VERSION < 0x00010b00
+#define HWLOC_OBJ_NUMANODE HWLOC_OBJ_NODE
+#endif
+#endif
+
+/// \file worldnuma.cc
+/// \brief NUMA-aware placement of pool threads and of large memory blocks
+
+namespace madness {
+
+    int NUMA::ndomain = 1;
+    bool NUMA::enabled = false;
+    std::size_t NUMA::threshold = std::numeric_limits<std::size_t>::max();
+    std::vector<int> NUMA::pool_domain;
+    thread_local int NUMA::domain = -1;
+
+#ifdef HAVE_HWLOC
+
+    // The topology is never destroyed since blocks bound to a domain
+    // may be freed by static destructors after the pool has gone.
+    static hwloc_topology_t topology;
+
+    // Domain whose cpuset includes the cpu binding of the calling thread, or -1
+    static int domain_of_this_thread() {
+        hwloc_bitmap_t set = hwloc_bitmap_alloc();
+        int result = -1;
+        if (hwloc_get_cpubind(topology, set, HWLOC_CPUBIND_THREAD) == 0) {
+            for (int i=0; i<NUMA::num_domains(); ++i) {
+                hwloc_obj_t node = hwloc_get_obj_by_type(topology, HWLOC_OBJ_NUMANODE, i);
+                if (node && hwloc_bitmap_isincluded(set, node->cpuset)) {
+                    result = i;
+                    break;
+                }
+            }
+        }
+        hwloc_bitmap_free(set);
+        return result;
+    }
+
+    void NUMA::initialize(int nthread) {
+        pool_domain.assign(nthread > 0 ? nthread : 0, -1);
+
+        const char* mad_numa = getenv("MAD_NUMA");
+        if (mad_numa && (strcmp(mad_numa, "0") == 0 || strcmp(mad_numa, "off") == 0))
+            return;
+
+        if (hwloc_topology_init(&topology) != 0 || hwloc_topology_load(topology) != 0) {
+            std::printf("!!MADNESS WARNING: hwloc could not load the topology ... NUMA placement disabled\n");
+            return;
+        }
+
+        const int n = hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_NUMANODE);
+        if (n <= 1) return; // Nothing to do on a uniform memory node
+        ndomain = n;
+        enabled = true;
+
+        threshold = 262144;
+        const char* cthreshold = getenv("MAD_NUMA_ALLOC_THRESHOLD");
+        if (cthreshold) {
+            long t;
+            if (sscanf(cthreshold, "%ld", &t) != 1 || t < 0)
+                MADNESS_EXCEPTION("MAD_NUMA_ALLOC_THRESHOLD is not a non-negative integer", 0);
+            threshold = t;
+        }
+
+        domain = domain_of_this_thread();
+    }
+
+    void NUMA::bind_pool_thread(int ind, int nthread, bool bound) {
+        if (!enabled) return;
+
+        if (bound) {
+            domain = domain_of_this_thread();
+        }
+        else {
+            domain = int((long(ind)*ndomain)/nthread);
+            hwloc_obj_t node = hwloc_get_obj_by_type(topology, HWLOC_OBJ_NUMANODE, domain);
+            if (!node || hwloc_set_cpubind(topology, node->cpuset, HWLOC_CPUBIND_THREAD) != 0) {
+                std::printf("!!MADNESS WARNING: could not bind pool thread %d to NUMA domain %d\n", ind, domain);
+                domain = -1;
+            }
+        }
+        if (ind >= 0 && ind < int(pool_domain.size())) pool_domain[ind] = domain;
+    }
+
+    void* NUMA::allocate_bound(std::size_t nbytes) {
+        hwloc_obj_t node = hwloc_get_obj_by_type(topology, HWLOC_OBJ_NUMANODE, domain);
+        if (!node) return nullptr;
+#if HWLOC_API_VERSION >= 0x00020000
+        return hwloc_alloc_membind(topology, nbytes, node->nodeset,
+                                   HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+#else
+        return hwloc_alloc_membind_nodeset(topology, nbytes, node->nodeset,
+                                           HWLOC_MEMBIND_BIND, 0);
+#endif
+    }
+
+    void NUMA::free_bound(void* p, std::size_t nbytes) {
+        hwloc_free(topology, p, nbytes);
+    }
+
+#else
+
+    void NUMA::initialize(int nthread) {
+        pool_domain.assign(nthread > 0 ? nthread : 0, -1);
+    }
+
+    void NUMA::bind_pool_thread(int, int, bool) {}
+
+    void* NUMA::allocate_bound(std::size_t) {
+        return nullptr;
+    }
+
+    void NUMA::free_bound(void* p, std::size_t) {
+        free(p);
+    }
+
+#endif // HAVE_HWLOC
+
+} // namespace madness
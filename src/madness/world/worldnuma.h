@@ -0,0 +1,176 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_WORLD_WORLDNUMA_H__INCLUDED
+#define MADNESS_WORLD_WORLDNUMA_H__INCLUDED
+
+#include <madness/madness_config.h>
+#include <madness/world/posixmem.h>
+#include <cstddef>
+#include <cstdlib>
+#include <vector>
+
+/// \file worldnuma.h
+/// \brief NUMA-aware placement of pool threads and of large memory blocks
+
+namespace madness {
+
+    /// NUMA topology and placement (a no-op unless built with hwloc)
+
+    /// At startup the \c ThreadPool calls \c initialize() to discover the
+    /// NUMA domains of the node.  Pool thread \c i of \c n is then placed
+    /// on domain `i*ndomain/n` (threads are spread over the domains in
+    /// contiguous blocks) and floats over all of the CPUs of that domain,
+    /// unless pool threads were explicitly bound with `MAD_BIND`, in which
+    /// case the domain of the bound CPU is recorded instead.
+    ///
+    /// Memory blocks of at least \c alloc_threshold() bytes requested
+    /// through \c allocate() are bound to the domain of the calling thread.
+    /// Smaller blocks come from \c posix_memalign and rely on the
+    /// first-touch policy of the OS (the pool thread is already running on
+    /// its own domain when it zeroes or fills the block).
+    ///
+    /// Environment variables:
+    /// - `MAD_NUMA` : set to 0 to disable NUMA placement (default is
+    ///   enabled if there is more than one domain).
+    /// - `MAD_NUMA_ALLOC_THRESHOLD` : smallest block (bytes) allocated
+    ///   directly on the domain of the caller (default 262144).
+    class NUMA {
+        static int ndomain; ///< Number of NUMA domains (1 if unknown).
+        static bool enabled; ///< True if placing threads and memory.
+        static std::size_t threshold; ///< Smallest block bound to a domain.
+        static std::vector<int> pool_domain; ///< Domain of each pool thread.
+        static thread_local int domain; ///< Domain of the calling thread or -1.
+
+        /// Allocate a block bound to the domain of the calling thread.
+
+        /// \param[in] nbytes The size of the block.
+        /// \return The block, or \c nullptr if the allocation failed.
+        static void* allocate_bound(std::size_t nbytes);
+
+        /// Free a block from \c allocate_bound().
+
+        /// \param[in] p The block.
+        /// \param[in] nbytes The size of the block.
+        static void free_bound(void* p, std::size_t nbytes);
+
+    public:
+        /// Frees a block from \c allocate() ... suitable for \c std::shared_ptr
+        struct Deleter {
+            std::size_t nbytes; ///< Size of the block.
+            bool bound; ///< True if the block is bound to a domain.
+
+            Deleter(std::size_t nbytes, bool bound) : nbytes(nbytes), bound(bound) {}
+
+            void operator()(void* p) const {
+                NUMA::deallocate(p, nbytes, bound);
+            }
+        };
+
+        /// Discover the topology and read the environment.
+
+        /// Called by the \c ThreadPool constructor from the main thread
+        /// before any pool thread is started.
+        /// \param[in] nthread The number of pool threads.
+        static void initialize(int nthread);
+
+        /// Returns true if NUMA placement is in use.
+        static bool is_enabled() {
+            return enabled;
+        }
+
+        /// Returns the number of NUMA domains (1 if unknown).
+        static int num_domains() {
+            return ndomain;
+        }
+
+        /// Returns the smallest block that \c allocate() binds to a domain.
+        static std::size_t alloc_threshold() {
+            return threshold;
+        }
+
+        /// Returns the domain of the calling thread or -1 if unknown.
+        static int this_thread_domain() {
+            return domain;
+        }
+
+        /// Returns the domain of a pool thread or -1 if unknown.
+
+        /// \param[in] ind Index of the thread in the pool.
+        /// \return The domain of the thread.
+        static int pool_thread_domain(int ind) {
+            return (ind >= 0 && ind < int(pool_domain.size())) ? pool_domain[ind] : -1;
+        }
+
+        /// Place the calling pool thread on its domain.
+
+        /// Called by each pool thread before it runs any task.
+        /// \param[in] ind Index of the calling thread in the pool.
+        /// \param[in] nthread Number of threads in the pool.
+        /// \param[in] bound True if the thread was already bound by `MAD_BIND`.
+        static void bind_pool_thread(int ind, int nthread, bool bound);
+
+        /// Allocate an aligned block, on the domain of the caller if it is large.
+
+        /// \param[in] nbytes The size of the block.
+        /// \param[in] alignment The alignment (a power of two multiple of `sizeof(void*)`).
+        /// \param[out] bound Set true if the block was bound to a domain.
+        /// \return The block, or \c nullptr if the allocation failed.
+        static void* allocate(std::size_t nbytes, std::size_t alignment, bool& bound) {
+            bound = false;
+            if (nbytes >= threshold && domain >= 0) {
+                void* p = allocate_bound(nbytes);
+                if (p) {
+                    bound = true;
+                    return p;
+                }
+            }
+            void* p = nullptr;
+            if (posix_memalign(&p, alignment, nbytes)) return nullptr;
+            return p;
+        }
+
+        /// Free a block from \c allocate().
+
+        /// \param[in] p The block.
+        /// \param[in] nbytes The size of the block.
+        /// \param[in] bound The value of \c bound returned by \c allocate().
+        static void deallocate(void* p, std::size_t nbytes, bool bound) {
+            if (bound)
+                free_bound(p, nbytes);
+            else
+                free(p);
+        }
+    };
+
+} // namespace madness
+
+#endif // MADNESS_WORLD_WORLDNUMA_H__INCLUDED
@@ -34,6 +34,7 @@
 #include <madness/world/worldrmi.h>
 #include <madness/world/posixmem.h>
 #include <madness/world/timers.h>
+#include <madness/world/worldtrace.h>
 #include <iostream>
 #include <algorithm>
 #include <utility>
@@ -51,6 +52,8 @@ namespace madness {
 
     thread_local bool RMI::is_server_thread = false;
 
+    volatile RMI::poll_callbackT RMI::poll_callback = nullptr;
+
 #if HAVE_INTEL_TBB
     tbb::task* RMI::tbb_rmi_parent_task = nullptr;
 #endif
@@ -75,6 +78,7 @@ namespace madness {
 	  narrived = SafeMPI::Request::Testsome(maxq_, recv_req.get(), ind.get(), status.get());
           if (narrived) break;
 	  ++iterations;
+          if (poll_callback) poll_callback();
           clear_send_req();
 	  myusleep(RMI::testsome_backoff_us);
         }
@@ -113,6 +117,7 @@ namespace madness {
                                   << std::endl;
 
                     if (is_ordered(attr)) ++(recv_counters[src]);
+                    Tracer::record(Tracer::AM_RECV, nullptr, len, src);
                     func(recv_buf[i], len);
                     post_recv_buf(i);
                 }
@@ -156,6 +161,7 @@ namespace madness {
                                   << std::endl;
 
                     ++(recv_counters[src]);
+                    Tracer::record(Tracer::AM_RECV, nullptr, q[m].len, src);
                     q[m].func(recv_buf[q[m].i], q[m].len);
                     post_recv_buf(q[m].i);
                 }
@@ -175,6 +181,7 @@ namespace madness {
 
             post_pending_huge_msg();
 
+            if (poll_callback) poll_callback();
             clear_send_req();
         }
     }
@@ -187,16 +194,20 @@ namespace madness {
             const size_t nbyte = std::get<1>(hugemsg);
             const int tag = std::get<2>(hugemsg);
             hugeq.pop_front();
-            if (posix_memalign(&recv_buf[nrecv_], ALIGNMENT, nbyte))
-                MADNESS_EXCEPTION("RMI: failed allocating huge message", 1);
+            Tracer::record(Tracer::HUGE_RECV, nullptr, nbyte, src);
+            if (nbyte > huge_buf_len_) {
+                free(huge_buf_);
+                huge_buf_ = nullptr;
+                huge_buf_len_ = 0;
+                if (posix_memalign(&huge_buf_, ALIGNMENT, nbyte))
+                    MADNESS_EXCEPTION("RMI: failed allocating huge message", 1);
+                huge_buf_len_ = nbyte;
+            }
+            // The sender posted the payload as soon as it sent the request,
+            // so no acknowledgement is needed ... MPI matches the payload
+            // by source and tag and delivers straight into this buffer.
+            recv_buf[nrecv_] = huge_buf_;
             recv_req[nrecv_] = comm.Irecv(recv_buf[nrecv_], nbyte, MPI_BYTE, src, tag);
-            int nada=0;
-            // make unique tags to ensure that ack msgs do not collide with normal recv msgs
-#ifdef MADNESS_USE_BSEND_ACKS
-            comm.Bsend(&nada, sizeof(nada), MPI_BYTE, src, tag + unique_tag_period());
-#else
-            comm.Send(&nada, sizeof(nada), MPI_BYTE, src, tag + unique_tag_period());
-#endif // MADNESS_USE_BSEND_ACKS
         }
     }
 
@@ -205,7 +216,13 @@ namespace madness {
             recv_req[i] = comm.Irecv(recv_buf[i], max_msg_len_, MPI_BYTE, MPI_ANY_SOURCE, SafeMPI::RMI_TAG);
         }
         else if (i == (int)nrecv_) {
-            free(recv_buf[i]);
+            // Keep the buffer for the next huge message unless it is
+            // unreasonably large
+            if (huge_buf_len_ > HUGE_BUF_RETAIN*max_msg_len_) {
+                free(huge_buf_);
+                huge_buf_ = nullptr;
+                huge_buf_len_ = 0;
+            }
             recv_buf[i] = 0;
             post_pending_huge_msg();
         }
@@ -237,6 +254,8 @@ namespace madness {
             , nrecv_(DEFAULT_NRECV)
             , maxq_(DEFAULT_NRECV + 1)
             , recv_buf()
+            , huge_buf_(nullptr)
+            , huge_buf_len_(0)
             , recv_req()
             , status()
             , ind()
@@ -339,14 +358,12 @@ namespace madness {
         const size_t nbyte = info[nword+1];
         const int tag = info[nword+2];
 
-        // extra dose of paranoia: assert that we never process so many huge messages
+        // extra dose of paranoia: assert that we never queue so many huge messages
         // that the tag wraparound somewhere becomes possible ...
-        // the worst case is where only one node sends huge messages to every node in the communicator
-        // AND it has enough threads to use up all tags
+        // senders no longer wait for the receiver so nothing else bounds the
+        // number of huge messages in flight
         // NB list::size() is O(1) in c++11, but O(N) in older libstdc++
-        MADNESS_ASSERT(ThreadPool::size() < RMI::RmiTask::unique_tag_period() ||
-                       RMI::task_ptr->hugeq.size() <
-                       std::size_t(RMI::RmiTask::unique_tag_period() / RMI::task_ptr->comm.Get_size()));
+        MADNESS_ASSERT(RMI::task_ptr->hugeq.size() < std::size_t(RMI::RmiTask::unique_tag_period()));
         RMI::task_ptr->hugeq.push_back(std::make_tuple(src, nbyte, tag));
         RMI::task_ptr->post_pending_huge_msg();
     }
@@ -418,25 +435,20 @@ namespace madness {
         int tag = SafeMPI::RMI_TAG;
         static std::size_t numsent = 0; // for tracking synchronous sends
 
-        if (nbyte > max_msg_len_) {
-            // Huge message protocol ... send message to dest indicating size and origin of huge message.
-            // Remote end posts a buffer then acks the request.  This end can then send.
-            const int nword = HEADER_LEN/sizeof(size_t);
-            size_t info[nword+3];
+        // Huge message protocol ... send message to dest indicating size and origin of huge message,
+        // then post the payload under a unique tag.  The remote end posts a buffer when it gets to the
+        // request and MPI's own rendezvous moves the data directly into it, so the caller does not
+        // wait for the remote end ... it only holds on to buf until the returned request completes.
+        const bool huge = nbyte > max_msg_len_;
+        const int nword = HEADER_LEN/sizeof(size_t);
+        size_t info[nword+3];
+        Request req_info;
+        if (huge) {
             info[nword  ] = rank;
             info[nword+1] = nbyte;
             tag = unique_tag();
             info[nword+2] = tag;
-
-            int ack;
-            // make unique tags to ensure that ack msgs do not collide with normal recv msgs
-            Request req_ack = comm.Irecv(&ack, sizeof(ack), MPI_BYTE, dest, tag + unique_tag_period());
-            Request req_send = isend(info, sizeof(info), dest, RMI::RmiTask::huge_msg_handler, ATTR_UNORDERED);
-
-            MutexWaiter waiter;
-            while (!req_send.Test()) waiter.wait();
-            waiter.reset();
-            while (!req_ack.Test()) waiter.wait();
+            Tracer::record(Tracer::HUGE_SEND, nullptr, nbyte, dest);
         }
         else if (nbyte < HEADER_LEN) {
             MADNESS_EXCEPTION("RMI::isend --- your buffer is too small to hold the header", static_cast<int>(nbyte));
@@ -456,6 +468,22 @@ namespace madness {
         // we presently always get the lock
         lock();
 
+        if (huge) {
+            // The request takes the counter just before the payload so that
+            // the remote end posts buffers for one process's huge messages
+            // in the order it can process them ... otherwise an ordered
+            // payload could occupy the huge buffer waiting for an earlier
+            // one that is queued behind it.
+            attrT info_attr = attr;
+            if (is_ordered(attr)) info_attr |= ((send_counters[dest]++)<<16);
+            header* h = (header*)(info);
+            h->func = RMI::RmiTask::huge_msg_handler;
+            h->attr = info_attr;
+            ++(RMI::stats.nmsg_sent);
+            RMI::stats.nbyte_sent += sizeof(info);
+            req_info = comm.Isend(info, sizeof(info), MPI_BYTE, dest, SafeMPI::RMI_TAG);
+        }
+
         // If ordering need the mutex to enclose sending the message
         // otherwise there is a livelock scenario due to a starved thread
         // holding an early counter.
@@ -484,6 +512,14 @@ namespace madness {
 
         unlock();
 
+        Tracer::record(Tracer::AM_SEND, nullptr, nbyte, dest);
+
+        if (huge) {
+            // The request is small enough to go eagerly, so this only waits for info to be copied out
+            MutexWaiter waiter;
+            while (!req_info.Test()) waiter.wait();
+        }
+
         return result;
     }
 
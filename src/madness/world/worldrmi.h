@@ -167,8 +167,19 @@ namespace madness {
 
         static std::list< std::unique_ptr<RMISendReq> > send_req; // List of outstanding world active messages sent by the server
 
+        typedef void (*poll_callbackT)();
+
+        /// Sets a function the server thread calls while polling for messages
+
+        /// Used by WorldAmInterface to send aggregated messages that have
+        /// waited too long.  The function runs on the server thread and so
+        /// must not block.
+        static void set_poll_callback(poll_callbackT f) { poll_callback = f; }
+
     private:
 
+        static volatile poll_callbackT poll_callback;
+
         static void clear_send_req() {
             //std::cout << "clearing server messages " << pthread_self() << std::endl;
             stats.max_serv_send_q = std::max(stats.max_serv_send_q,uint64_t(send_req.size()));
@@ -211,6 +222,8 @@ namespace madness {
             long nssend_;
             std::size_t maxq_;
             std::unique_ptr<void*[]> recv_buf; // Will be at least ALIGNMENT aligned ... +1 for huge messages
+            void* huge_buf_;            // Reused buffer for huge messages (recv_buf[nrecv_] when in use)
+            std::size_t huge_buf_len_;  // Capacity of huge_buf_ in bytes
             std::unique_ptr<SafeMPI::Request[]> recv_req;
 
             std::unique_ptr<SafeMPI::Status[]> status;
@@ -279,7 +292,7 @@ namespace madness {
             /// @returns new tag to be used in messaging
             int unique_tag() const;
             /// the period of tags returned by unique_tag()
-            /// @warning this bounds how many huge messages each RmiTask will be able to process
+            /// @warning this bounds how many huge messages each RmiTask may have in flight to one process
             static constexpr int unique_tag_period() { return 2048; }
 
         }; // class RmiTask
@@ -294,6 +307,7 @@ namespace madness {
 
         static const size_t DEFAULT_MAX_MSG_LEN = 3*512*1024;  //!< the default size of recv buffers, in bytes; the actual size can be configured by the user via envvar MAD_BUFFER_SIZE
         static const int DEFAULT_NRECV = 128;  //!< the default # of recv buffers; the actual number can be configured by the user via envvar MAD_RECV_BUFFERS
+        static const int HUGE_BUF_RETAIN = 16; //!< huge message buffers up to this many times max_msg_len() are kept for reuse
 
         // Not allowed
         RMI(const RMI&);
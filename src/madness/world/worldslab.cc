@@ -0,0 +1,253 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#include <madness/world/worldslab.h>
+#include <madness/world/worldmutex.h>
+#include <cstdlib>
+#include <cstring>
+
+/// \file worldslab.cc
+/// \brief Implements SlabAllocator, a thread-caching size-class allocator for tensor storage
+
+namespace madness {
+
+    namespace {
+
+        // Singly-linked list threaded through the first word of each free block
+        struct FreeList {
+            void* head;
+            int count;
+
+            FreeList() : head(nullptr), count(0) {}
+
+            void push(void* p) {
+                *static_cast<void**>(p) = head;
+                head = p;
+                ++count;
+            }
+
+            void* pop() {
+                void* p = head;
+                if (p) {
+                    head = *static_cast<void**>(p);
+                    --count;
+                }
+                return p;
+            }
+        };
+
+        // Per-thread free lists and counters.  Counters are only written by
+        // the owner but may be read by anyone, hence the relaxed atomics.
+        struct ThreadCache {
+            FreeList lists[SlabAllocator::MAXCLASS];
+            std::atomic<unsigned long> nalloc;
+            std::atomic<unsigned long> nhit;
+            std::atomic<unsigned long> nfresh;
+            std::atomic<long> bytes_in_use;
+            std::atomic<long> bytes_cached;
+            ThreadCache* next;
+
+            ThreadCache() : nalloc(0), nhit(0), nfresh(0), bytes_in_use(0),
+                            bytes_cached(0), next(nullptr) {}
+
+            static void add(std::atomic<unsigned long>& counter, unsigned long n) {
+                counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            }
+
+            static void add(std::atomic<long>& counter, long n) {
+                counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            }
+        };
+
+        // Global depot shared by all threads, one lock per class
+        struct Depot {
+            Mutex mutex;
+            FreeList list;
+        };
+
+        // Never destroyed since static tensors may be freed very late
+        Depot* const depot = new Depot[SlabAllocator::MAXCLASS];
+        Mutex* const registry_mutex = new Mutex; // Guards size registration and the list of caches
+        ThreadCache* caches = nullptr;
+        thread_local ThreadCache* this_cache = nullptr;
+
+        ThreadCache* get_cache() {
+            ThreadCache* cache = this_cache;
+            if (!cache) {
+                // Caches live until the process exits so that the statistics
+                // (and any blocks still cached) of finished threads are kept
+                cache = new ThreadCache;
+                ScopedMutex<Mutex> lock(*registry_mutex);
+                cache->next = caches;
+                caches = cache;
+                this_cache = cache;
+            }
+            return cache;
+        }
+
+        bool slab_enabled() {
+            const char* mad_slab = getenv("MAD_SLAB");
+            return !(mad_slab && (strcmp(mad_slab, "0") == 0 || strcmp(mad_slab, "off") == 0));
+        }
+
+    } // namespace
+
+    std::size_t SlabAllocator::sizes[SlabAllocator::MAXCLASS];
+    std::atomic<int> SlabAllocator::nclass(0);
+    bool SlabAllocator::enabled = slab_enabled();
+
+    void* SlabAllocator::allocate_unpooled(std::size_t nbytes) {
+        void* p = nullptr;
+        if (posix_memalign(&p, ALIGNMENT, nbytes)) return nullptr;
+        return p;
+    }
+
+    int SlabAllocator::register_size(std::size_t nbytes) {
+        int cls = size_class(nbytes);
+        if (cls >= 0 || !enabled) return cls;
+        // Blocks must be able to hold the free-list link
+        if (nbytes < sizeof(void*) || nbytes > MAXSIZE) return -1;
+        if (NUMA::is_enabled() && nbytes >= NUMA::alloc_threshold()) return -1;
+
+        ScopedMutex<Mutex> lock(*registry_mutex);
+        cls = size_class(nbytes); // Another thread may have beaten us to it
+        if (cls >= 0) return cls;
+        const int n = nclass.load(std::memory_order_relaxed);
+        if (n == MAXCLASS) return -1;
+        sizes[n] = nbytes;
+        nclass.store(n + 1, std::memory_order_release);
+        return n;
+    }
+
+    void* SlabAllocator::allocate_class(int cls) {
+        ThreadCache* cache = get_cache();
+        FreeList& list = cache->lists[cls];
+        const long nbytes = sizes[cls];
+
+        void* p = list.pop();
+        if (!p) {
+            // Refill half a cache from the depot
+            Depot& d = depot[cls];
+            int nmoved = 0;
+            {
+                ScopedMutex<Mutex> lock(d.mutex);
+                while (nmoved < MAXCACHE/2 && d.list.head) {
+                    list.push(d.list.pop());
+                    ++nmoved;
+                }
+            }
+            ThreadCache::add(cache->bytes_cached, nmoved*nbytes);
+            p = list.pop();
+        }
+
+        ThreadCache::add(cache->nalloc, 1ul);
+        if (p) {
+            ThreadCache::add(cache->nhit, 1ul);
+            ThreadCache::add(cache->bytes_cached, -nbytes);
+        }
+        else if (std::size_t(nbytes) <= MAXCHUNK) {
+            // Carve small blocks from one chunk so that they are handed out
+            // in address order rather than scattered over the heap
+            const int nblock = MAXCACHE/2;
+            char* chunk = static_cast<char*>(allocate_unpooled(nblock*nbytes));
+            if (!chunk) return nullptr;
+            for (int i=nblock-1; i>0; --i) list.push(chunk + i*nbytes);
+            ThreadCache::add(cache->bytes_cached, (nblock-1)*nbytes);
+            ThreadCache::add(cache->nfresh, (unsigned long) nblock);
+            p = chunk;
+        }
+        else {
+            p = allocate_unpooled(nbytes);
+            if (!p) return nullptr;
+            ThreadCache::add(cache->nfresh, 1ul);
+        }
+        ThreadCache::add(cache->bytes_in_use, nbytes);
+        return p;
+    }
+
+    void SlabAllocator::deallocate_class(void* p, int cls) {
+        ThreadCache* cache = get_cache();
+        FreeList& list = cache->lists[cls];
+        const long nbytes = sizes[cls];
+
+        list.push(p);
+        ThreadCache::add(cache->bytes_in_use, -nbytes);
+        ThreadCache::add(cache->bytes_cached, nbytes);
+
+        if (list.count > MAXCACHE) {
+            // Spill half to the depot so that producer/consumer thread
+            // pairs do not grow their caches without bound
+            FreeList spill;
+            while (list.count > MAXCACHE/2) spill.push(list.pop());
+            ThreadCache::add(cache->bytes_cached, -spill.count*nbytes);
+            Depot& d = depot[cls];
+            ScopedMutex<Mutex> lock(d.mutex);
+            while (spill.head) d.list.push(spill.pop());
+        }
+    }
+
+    void SlabAllocator::trim() {
+        const int n = nclass.load(std::memory_order_acquire);
+        for (int i=0; i<n; ++i) {
+            if (sizes[i] <= MAXCHUNK) continue; // Blocks are not individually freeable
+            FreeList list;
+            {
+                ScopedMutex<Mutex> lock(depot[i].mutex);
+                list = depot[i].list;
+                depot[i].list = FreeList();
+            }
+            while (list.head) free(list.pop());
+        }
+    }
+
+    SlabStats SlabAllocator::get_stats() {
+        SlabStats stats;
+        long cached = 0;
+        {
+            ScopedMutex<Mutex> lock(*registry_mutex);
+            for (const ThreadCache* cache=caches; cache; cache=cache->next) {
+                stats.nalloc += cache->nalloc.load(std::memory_order_relaxed);
+                stats.nhit += cache->nhit.load(std::memory_order_relaxed);
+                stats.nfresh += cache->nfresh.load(std::memory_order_relaxed);
+                stats.bytes_in_use += cache->bytes_in_use.load(std::memory_order_relaxed);
+                cached += cache->bytes_cached.load(std::memory_order_relaxed);
+            }
+        }
+        const int n = nclass.load(std::memory_order_acquire);
+        for (int i=0; i<n; ++i) {
+            ScopedMutex<Mutex> lock(depot[i].mutex);
+            cached += long(depot[i].list.count)*long(sizes[i]);
+        }
+        stats.bytes_cached = (cached > 0) ? cached : 0;
+        return stats;
+    }
+
+} // namespace madness
@@ -0,0 +1,202 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_WORLD_WORLDSLAB_H__INCLUDED
+#define MADNESS_WORLD_WORLDSLAB_H__INCLUDED
+
+#include <madness/madness_config.h>
+#include <madness/world/worldnuma.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/// \file worldslab.h
+/// \brief Implements SlabAllocator, a thread-caching size-class allocator for tensor storage
+
+namespace madness {
+
+    /// Size-class allocator statistics
+    struct SlabStats {
+        unsigned long nalloc;       ///< #blocks allocated from a size class
+        unsigned long nhit;         ///< #allocations satisfied from a free list
+        unsigned long nfresh;       ///< #blocks obtained from the system
+        long bytes_in_use;          ///< Bytes currently handed out
+        unsigned long bytes_cached; ///< Bytes held in free lists
+
+        SlabStats()
+                : nalloc(0), nhit(0), nfresh(0), bytes_in_use(0), bytes_cached(0) {}
+    };
+
+
+    /// A thread-caching allocator for a small set of fixed block sizes
+
+    /// Almost every tensor in an MRA calculation is k^NDIM or (2k)^NDIM
+    /// elements, so rather than going to \c posix_memalign for each one
+    /// the sizes are registered (e.g., by \c FunctionCommonData) as size
+    /// classes.  Each thread keeps a free list per class; freed blocks go
+    /// onto the list of the freeing thread and, once that holds more than
+    /// \c MAXCACHE blocks, half are moved to a global depot from which
+    /// threads that run dry refill.  Blocks are never returned to the
+    /// system except by \c trim().  Sizes above \c MAXSIZE are not pooled.
+    /// Fresh blocks of at most \c MAXCHUNK bytes (e.g., future and task
+    /// objects) are carved \c MAXCACHE/2 at a time from one contiguous
+    /// chunk so that objects allocated together stay together in memory;
+    /// these are never returned to the system.
+    ///
+    /// Requests for unregistered sizes fall through to \c NUMA::allocate().
+    /// Sizes at or above \c NUMA::alloc_threshold() are not pooled when
+    /// NUMA placement is in use since recycled blocks would lose their
+    /// placement.  Set the environment variable `MAD_SLAB=0` to disable.
+    class SlabAllocator {
+    public:
+        static const int MAXCLASS = 32; ///< Maximum number of size classes
+        static const int MAXCACHE = 64; ///< Blocks per class per thread before spilling to the depot
+        static const std::size_t ALIGNMENT = 64; ///< Alignment of all pooled blocks
+        static const std::size_t MAXSIZE = 1ul<<22; ///< Largest block size that is pooled
+        static const std::size_t MAXCHUNK = 1024; ///< Largest block size carved from contiguous chunks
+
+        /// Frees a block from \c allocate() ... suitable for \c std::shared_ptr
+        struct Deleter {
+            std::size_t nbytes; ///< Size of the block.
+            int cls; ///< Size class or -1 if not pooled.
+            bool bound; ///< True if the block is bound to a NUMA domain.
+
+            Deleter() : nbytes(0), cls(-1), bound(false) {}
+
+            void operator()(void* p) const {
+                if (cls >= 0)
+                    SlabAllocator::deallocate_class(p, cls);
+                else
+                    NUMA::deallocate(p, nbytes, bound);
+            }
+        };
+
+        /// Standard allocator drawing from the size classes
+
+        /// Intended for fixed-size objects such as \c std::shared_ptr
+        /// control blocks; the size is registered on first use.  Sizes
+        /// are rounded up to a multiple of \c GRANULE so that a family of
+        /// similar types (e.g., \c FutureImpl<T>) shares a few classes.
+        template <typename U, std::size_t GRANULE = 1>
+        struct Allocator {
+            typedef U value_type;
+
+            template <typename V>
+            struct rebind { typedef Allocator<V,GRANULE> other; };
+
+            Allocator() {}
+
+            template <typename V>
+            Allocator(const Allocator<V,GRANULE>&) {}
+
+            static std::size_t block_size(std::size_t n) {
+                return ((n*sizeof(U) + GRANULE - 1)/GRANULE)*GRANULE;
+            }
+
+            U* allocate(std::size_t n) {
+                const std::size_t nbytes = block_size(n);
+                const int cls = register_size(nbytes);
+                void* p = (cls >= 0) ? allocate_class(cls) : allocate_unpooled(nbytes);
+                if (!p) throw std::bad_alloc();
+                return static_cast<U*>(p);
+            }
+
+            void deallocate(U* p, std::size_t n) {
+                const int cls = size_class(block_size(n));
+                if (cls >= 0)
+                    deallocate_class(p, cls);
+                else
+                    free(p);
+            }
+
+            template <typename V>
+            bool operator==(const Allocator<V,GRANULE>&) const { return true; }
+
+            template <typename V>
+            bool operator!=(const Allocator<V,GRANULE>&) const { return false; }
+        };
+
+    private:
+        static std::size_t sizes[MAXCLASS]; ///< Block size of each class
+        static std::atomic<int> nclass; ///< Number of classes published
+        static bool enabled; ///< False if disabled by `MAD_SLAB=0`
+
+        /// Allocate an aligned block that is not pooled (nullptr on failure)
+        static void* allocate_unpooled(std::size_t nbytes);
+
+    public:
+        /// Register a block size ... returns its class or -1 if not pooled
+
+        /// Registering the same size again returns the same class.  Once
+        /// registered a size class is never removed.
+        /// \param[in] nbytes The block size in bytes.
+        /// \return The size class or -1 if the size will not be pooled.
+        static int register_size(std::size_t nbytes);
+
+        /// Returns the class of a block size or -1 if it is not registered
+        static int size_class(std::size_t nbytes) {
+            const int n = nclass.load(std::memory_order_acquire);
+            for (int i=0; i<n; ++i)
+                if (sizes[i] == nbytes) return i;
+            return -1;
+        }
+
+        /// Allocate a block from a size class (nullptr on failure)
+        static void* allocate_class(int cls);
+
+        /// Return a block to its size class
+        static void deallocate_class(void* p, int cls);
+
+        /// Allocate a block, from its size class if it has one
+
+        /// \param[in] nbytes The size of the block.
+        /// \param[in] alignment The alignment (at most \c ALIGNMENT if the size is pooled).
+        /// \param[out] deleter Set to free the block.
+        /// \return The block, or \c nullptr if the allocation failed.
+        static void* allocate(std::size_t nbytes, std::size_t alignment, Deleter& deleter) {
+            deleter.nbytes = nbytes;
+            deleter.cls = enabled ? size_class(nbytes) : -1;
+            deleter.bound = false;
+            if (deleter.cls >= 0) return allocate_class(deleter.cls);
+            return NUMA::allocate(nbytes, alignment, deleter.bound);
+        }
+
+        /// Return the blocks held in the global depot to the system (except those carved from chunks)
+        static void trim();
+
+        /// Returns statistics summed over all threads
+        static SlabStats get_stats();
+    };
+
+} // namespace madness
+
+#endif // MADNESS_WORLD_WORLDSLAB_H__INCLUDED
@@ -0,0 +1,222 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#include <madness/world/worldtrace.h>
+#include <madness/world/worldmutex.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+#ifdef __GNUG__
+#include <cxxabi.h> // for abi::__cxa_demangle
+#endif
+
+/// \file worldtrace.cc
+/// \brief Implements Tracer, a low-overhead event timeline of tasks, messages and fences
+
+namespace madness {
+
+    namespace {
+
+        // Ring of events written only by its owning thread.  The owner
+        // publishes each event by advancing head; everyone else only reads.
+        struct ThreadTrace {
+            TraceEvent* events;
+            std::uint64_t mask;
+            std::atomic<std::uint64_t> head; // #events ever written
+            std::atomic<std::uint64_t> tail; // Events before this were cleared
+            std::uint32_t id;
+            ThreadTrace* next;
+
+            ThreadTrace(std::size_t n, std::uint32_t id)
+                : events(new TraceEvent[n]), mask(n-1), head(0), tail(0), id(id), next(nullptr) {}
+        };
+
+        std::size_t trace_capacity() {
+            std::size_t n = 65536;
+            const char* mad_trace_size = getenv("MAD_TRACE_SIZE");
+            if (mad_trace_size) {
+                const long m = atol(mad_trace_size);
+                if (m > 0) n = m;
+            }
+            std::size_t p = 16;
+            while (p < n) p <<= 1;
+            return p;
+        }
+
+        const std::size_t trace_size = trace_capacity();
+        const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        const std::chrono::system_clock::time_point system_epoch = std::chrono::system_clock::now();
+
+        // Buffers live until the process exits so that the events of
+        // finished threads can still be dumped
+        Mutex* const registry_mutex = new Mutex;
+        ThreadTrace* traces = nullptr;
+        std::uint32_t ntrace = 0;
+        thread_local ThreadTrace* this_trace = nullptr;
+
+        ThreadTrace* get_trace() {
+            ThreadTrace* trace = this_trace;
+            if (!trace) {
+                ScopedMutex<Mutex> lock(*registry_mutex);
+                trace = new ThreadTrace(trace_size, ntrace++);
+                trace->next = traces;
+                traces = trace;
+                this_trace = trace;
+            }
+            return trace;
+        }
+
+        bool trace_enabled() {
+            return getenv("MAD_TRACE_NAME") != nullptr;
+        }
+
+        // Record as written to the file
+        struct TraceRecord {
+            std::uint64_t time;
+            std::uint64_t arg;
+            std::uint32_t kind;
+            std::int32_t peer;
+            std::uint32_t name;  // Index into the name table or NONAME
+            std::uint32_t pad;
+        };
+
+        const std::uint32_t NONAME = 0xffffffffu;
+        const std::uint32_t TRACE_VERSION = 1;
+
+        std::string demangle(const char* name) {
+#ifdef __GNUG__
+            int status = 0;
+            char* s = abi::__cxa_demangle(name, 0, 0, &status);
+            if (s) {
+                std::string result(s);
+                free(s);
+                return result;
+            }
+#endif
+            return std::string(name);
+        }
+
+        template <typename T>
+        bool put(FILE* f, const T& value) {
+            return fwrite(&value, sizeof(T), 1, f) == 1;
+        }
+
+    } // namespace
+
+    std::atomic<bool> Tracer::on(trace_enabled());
+
+    void Tracer::append(Kind kind, const char* name, std::uint64_t arg, int peer) {
+        const std::uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - epoch).count();
+        ThreadTrace* trace = get_trace();
+        const std::uint64_t h = trace->head.load(std::memory_order_relaxed);
+        TraceEvent& e = trace->events[h & trace->mask];
+        e.time = time;
+        e.name = name;
+        e.arg = arg;
+        e.kind = kind;
+        e.peer = peer;
+        trace->head.store(h+1, std::memory_order_release);
+    }
+
+    std::size_t Tracer::capacity() {
+        return trace_size;
+    }
+
+    void Tracer::clear() {
+        ScopedMutex<Mutex> lock(*registry_mutex);
+        for (ThreadTrace* trace=traces; trace; trace=trace->next)
+            trace->tail.store(trace->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+
+    bool Tracer::dump(const char* filename, int rank) {
+        // Snapshot the buffers and build the name table
+        std::vector< std::pair<std::uint32_t, std::vector<TraceRecord> > > threads;
+        std::map<const char*, std::uint32_t> index;
+        std::vector<const char*> names;
+        {
+            ScopedMutex<Mutex> lock(*registry_mutex);
+            for (ThreadTrace* trace=traces; trace; trace=trace->next) {
+                const std::uint64_t head = trace->head.load(std::memory_order_acquire);
+                std::uint64_t first = trace->tail.load(std::memory_order_relaxed);
+                if (head - first > trace->mask + 1) first = head - (trace->mask + 1);
+
+                threads.push_back(std::make_pair(trace->id, std::vector<TraceRecord>()));
+                std::vector<TraceRecord>& records = threads.back().second;
+                records.reserve(head - first);
+                for (std::uint64_t i=first; i<head; ++i) {
+                    const TraceEvent& e = trace->events[i & trace->mask];
+                    TraceRecord r;
+                    r.time = e.time;
+                    r.arg = e.arg;
+                    r.kind = e.kind;
+                    r.peer = e.peer;
+                    r.name = NONAME;
+                    r.pad = 0;
+                    if (e.name) {
+                        auto it = index.insert(std::make_pair(e.name, std::uint32_t(names.size())));
+                        if (it.second) names.push_back(e.name);
+                        r.name = it.first->second;
+                    }
+                    records.push_back(r);
+                }
+            }
+        }
+
+        FILE* f = fopen(filename, "wb");
+        if (!f) return false;
+
+        const std::uint64_t epoch_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                system_epoch.time_since_epoch()).count();
+        bool ok = fwrite("MADTRACE", 8, 1, f) == 1;
+        ok = ok && put(f, TRACE_VERSION) && put(f, std::int32_t(rank)) && put(f, epoch_ns);
+
+        ok = ok && put(f, std::uint32_t(names.size()));
+        for (const char* name : names) {
+            const std::string s = demangle(name);
+            ok = ok && put(f, std::uint32_t(s.size()));
+            ok = ok && (s.empty() || fwrite(s.data(), s.size(), 1, f) == 1);
+        }
+
+        ok = ok && put(f, std::uint32_t(threads.size()));
+        for (const auto& t : threads) {
+            ok = ok && put(f, t.first) && put(f, std::uint64_t(t.second.size()));
+            ok = ok && (t.second.empty() ||
+                        fwrite(t.second.data(), sizeof(TraceRecord), t.second.size(), f) == t.second.size());
+        }
+
+        return (fclose(f) == 0) && ok;
+    }
+
+} // namespace madness
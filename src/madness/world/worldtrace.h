@@ -0,0 +1,132 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_WORLD_WORLDTRACE_H__INCLUDED
+#define MADNESS_WORLD_WORLDTRACE_H__INCLUDED
+
+#include <madness/madness_config.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// \file worldtrace.h
+/// \brief Implements Tracer, a low-overhead event timeline of tasks, messages and fences
+
+namespace madness {
+
+    /// One timestamped event in a trace buffer
+    struct TraceEvent {
+        std::uint64_t time;   ///< Nanoseconds since the trace epoch
+        const char* name;     ///< Static name (e.g., the mangled task type) or \c nullptr
+        std::uint64_t arg;    ///< Event argument (message size in bytes)
+        std::uint32_t kind;   ///< A \c Tracer::Kind
+        std::int32_t peer;    ///< Remote process for messages, otherwise -1
+    };
+
+
+    /// Runtime-togglable recorder of task, message and fence events
+
+    /// Each thread appends to its own ring buffer of \c capacity() events,
+    /// so recording is a clock read and a few stores with no locking or
+    /// atomic read-modify-write.  When a buffer is full the oldest events
+    /// are overwritten.  Recording is off by default and is switched on
+    /// and off with \c enable() and \c disable(); when off the cost of a
+    /// hook is a single relaxed load.
+    ///
+    /// Setting the environment variable `MAD_TRACE_NAME` enables tracing
+    /// from startup and \c finalize() writes the events of each process to
+    /// `<MAD_TRACE_NAME>_<rank>`.  `MAD_TRACE_SIZE` sets the number of
+    /// events kept per thread (default 65536).  The binary dumps are
+    /// converted to Chrome trace JSON (viewable in chrome://tracing or
+    /// Perfetto) with `bin/madtrace2json.py`.
+    class Tracer {
+    public:
+        /// Kinds of event recorded
+        enum Kind {
+            TASK_SPAWN,   ///< Task submitted to the pool
+            TASK_BEGIN,   ///< Task started running on this thread
+            TASK_END,     ///< Task finished running on this thread
+            AM_SEND,      ///< Active message sent to \c peer
+            AM_RECV,      ///< Active message from \c peer handled
+            HUGE_SEND,    ///< Huge message handshake with \c peer started
+            HUGE_RECV,    ///< Buffer posted for a huge message from \c peer
+            FENCE_BEGIN,  ///< Entered a global fence
+            FENCE_END,    ///< Left a global fence
+            NKIND
+        };
+
+    private:
+        static std::atomic<bool> on; ///< True while recording
+
+        /// Append an event to the buffer of the calling thread
+        static void append(Kind kind, const char* name, std::uint64_t arg, int peer);
+
+    public:
+        /// Start recording
+        static void enable() { on.store(true, std::memory_order_relaxed); }
+
+        /// Stop recording (recorded events are kept)
+        static void disable() { on.store(false, std::memory_order_relaxed); }
+
+        /// Returns true if events are being recorded
+        static bool enabled() { return on.load(std::memory_order_relaxed); }
+
+        /// Record an event if tracing is enabled
+
+        /// \param[in] kind The kind of event.
+        /// \param[in] name A name with static lifetime, or \c nullptr.
+        /// \param[in] arg The event argument (e.g., message size in bytes).
+        /// \param[in] peer The remote process, or -1.
+        static void record(Kind kind, const char* name = nullptr,
+                           std::uint64_t arg = 0, int peer = -1) {
+            if (enabled()) append(kind, name, arg, peer);
+        }
+
+        /// Number of events kept per thread
+        static std::size_t capacity();
+
+        /// Discard all recorded events
+        static void clear();
+
+        /// Write the recorded events of this process to a binary file
+
+        /// Threads may continue recording while the dump is written but
+        /// events recorded during the dump may be incomplete, so dump from a
+        /// quiescent point such as after a fence.
+        /// \param[in] filename The output file.
+        /// \param[in] rank The rank of this process (for cross-process alignment).
+        /// \return False if the file could not be written.
+        static bool dump(const char* filename, int rank);
+    };
+
+} // namespace madness
+
+#endif // MADNESS_WORLD_WORLDTRACE_H__INCLUDED
@@ -0,0 +1,217 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_WORLD_WSDEQUE_H__INCLUDED
+#define MADNESS_WORLD_WSDEQUE_H__INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// \file wsdeque.h
+/// \brief Implements WSDeque, the per-thread work-stealing deque used by ThreadPool
+
+namespace madness {
+
+    /// Work-stealing counters (relaxed, for diagnostics only)
+    struct WSStats {
+        uint64_t npush;         ///< #calls to push by the owner
+        uint64_t npop;          ///< #successful pops by the owner
+        uint64_t nsteal;        ///< #successful steals made by the owner from other deques
+        uint64_t ngrow;         ///< #calls to grow
+
+        WSStats()
+                : npush(0), npop(0), nsteal(0), ngrow(0) {}
+    };
+
+
+    /// A lock-free, single-owner, multi-thief deque (Chase-Lev)
+
+    /// The owning thread pushes and pops at the bottom (LIFO, which keeps
+    /// freshly spawned children hot in cache) while any other thread may
+    /// steal from the top (oldest first, which tends to hand out the
+    /// largest remaining subtrees).  Only the owner may call \c push()
+    /// and \c pop(); \c steal() and \c size() are safe from any thread.
+    ///
+    /// The memory orderings follow Le, Pop, Cohen and Zappa Nardelli,
+    /// "Correct and efficient work-stealing for weak memory models"
+    /// (PPoPP 2013).  The buffer grows on demand; retired buffers may
+    /// still be read by a concurrent thief so they are kept until the
+    /// deque is destroyed (the total retired memory is bounded by the
+    /// size of the current buffer).
+    ///
+    /// T must be trivially copyable and is intended to be a pointer.
+    template <typename T>
+    class WSDeque {
+        /// Circular buffer with power-of-two capacity
+        class Array {
+            const int64_t mask;
+            std::atomic<T>* const buf;
+
+            Array(const Array&);            // Verboten
+            void operator=(const Array&);   // Verboten
+
+        public:
+            explicit Array(int64_t capacity)
+                : mask(capacity-1), buf(new std::atomic<T>[capacity]) {}
+
+            ~Array() { delete [] buf; }
+
+            int64_t capacity() const { return mask+1; }
+
+            T get(int64_t i) const {
+                return buf[i & mask].load(std::memory_order_relaxed);
+            }
+
+            void put(int64_t i, T value) {
+                buf[i & mask].store(value, std::memory_order_relaxed);
+            }
+
+            /// Returns a new array of twice the capacity holding [top,bottom)
+            Array* grow(int64_t bottom, int64_t top) const {
+                Array* a = new Array(2*capacity());
+                for (int64_t i=top; i<bottom; ++i) a->put(i, get(i));
+                return a;
+            }
+        };
+
+        char pad0[64]; ///< Keep top away from whatever precedes us
+        std::atomic<int64_t> top __attribute__((aligned(64)));    ///< Steal end (thieves)
+        std::atomic<int64_t> bottom __attribute__((aligned(64))); ///< Owner end
+        std::atomic<Array*> array; ///< Current buffer
+        std::vector<Array*> retired; ///< Old buffers (owner only)
+        WSStats stats;
+
+        WSDeque(const WSDeque&);            // Verboten
+        void operator=(const WSDeque&);     // Verboten
+
+    public:
+        /// Construct with initial capacity rounded up to a power of two
+        WSDeque(size_t hint=1024)
+                : top(0), bottom(0), array(nullptr), retired(), stats()
+        {
+            int64_t capacity = 2;
+            while (capacity < int64_t(hint)) capacity <<= 1;
+            array.store(new Array(capacity), std::memory_order_relaxed);
+        }
+
+        ~WSDeque() {
+            delete array.load(std::memory_order_relaxed);
+            for (size_t i=0; i<retired.size(); ++i) delete retired[i];
+        }
+
+        /// Owner pushes a value onto the bottom
+        void push(T value) {
+            const int64_t b = bottom.load(std::memory_order_relaxed);
+            const int64_t t = top.load(std::memory_order_acquire);
+            Array* a = array.load(std::memory_order_relaxed);
+            if (b - t > a->capacity() - 1) {
+                Array* old = a;
+                a = old->grow(b, t);
+                retired.push_back(old);
+                array.store(a, std::memory_order_release);
+                ++(stats.ngrow);
+            }
+            a->put(b, value);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            ++(stats.npush);
+        }
+
+        /// Owner pops the most recently pushed value ... returns false if empty
+        bool pop(T& value) {
+            const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            Array* a = array.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top.load(std::memory_order_relaxed);
+
+            bool got = false;
+            if (t <= b) {
+                value = a->get(b);
+                got = true;
+                if (t == b) {
+                    // Last element ... race against thieves for it
+                    if (!top.compare_exchange_strong(t, t + 1,
+                            std::memory_order_seq_cst, std::memory_order_relaxed))
+                        got = false;
+                    bottom.store(b + 1, std::memory_order_relaxed);
+                }
+            }
+            else {
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            if (got) ++(stats.npop);
+            return got;
+        }
+
+        /// Any thread steals the oldest value ... returns false if empty or the race was lost
+        bool steal(T& value) {
+            int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const int64_t b = bottom.load(std::memory_order_acquire);
+            if (t < b) {
+                Array* a = array.load(std::memory_order_acquire);
+                T v = a->get(t);
+                if (!top.compare_exchange_strong(t, t + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed))
+                    return false;
+                value = v;
+                return true;
+            }
+            return false;
+        }
+
+        /// Owner records that it stole a task from another thread's deque
+        void count_steal() {
+            ++(stats.nsteal);
+        }
+
+        /// Approximate number of entries (exact if called by the owner with no thieves)
+        size_t size() const {
+            const int64_t b = bottom.load(std::memory_order_relaxed);
+            const int64_t t = top.load(std::memory_order_relaxed);
+            return (b > t) ? size_t(b - t) : 0;
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+        const WSStats& get_stats() const {
+            return stats;
+        }
+    };
+
+}
+
+#endif // MADNESS_WORLD_WSDEQUE_H__INCLUDED